@@ -0,0 +1,209 @@
+// 人脸检测后端对比：用同一批 .ddfgrec 录像依次跑各个检测后端，
+// 比较单帧检测耗时 (平均 / P50 / P99) 以及与参考后端检测结果的一致程度。
+//
+// 用法: detector_bench <录像文件>... [--backends hog,mmod,opencv_dnn] [--reference 后端]
+//                      [--max-frames N] [--threads 1,2,4] [--config config/config.json]
+//   --backends   参与比较的后端，默认 hog,mmod,opencv_dnn
+//   --reference  作为“真值”的后端，默认列表中的最后一个（通常是召回最好的）
+//   --max-frames 每段录像最多使用的帧数，0 表示全部
+//   --threads    hog 后端依次用这些 detection.threads 运行，比较扫描延迟随线程数的变化
+//
+// 召回率 = 参考后端的人脸框中被该后端检出 (IoU >= 0.5) 的比例；
+// 精确率 = 该后端的人脸框中与参考后端某个框匹配的比例。
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ConfigParser.h"
+#include "FaceDetector.h"
+#include "FrameRecorder.h"
+#include "PerformanceMonitor.h"
+
+namespace {
+using FrameBoxes = std::vector<dlib::rectangle>;
+
+struct BackendRun {
+    std::string backend;
+    std::string label;               // 表格中的名字；hog 按线程数分开时带 "xN"
+    std::vector<FrameBoxes> frames;  // 所有录像的逐帧检测结果，按回放顺序排列
+    bool ok = false;
+};
+
+double iou(const dlib::rectangle& a, const dlib::rectangle& b) {
+    const double inter = a.intersect(b).area();
+    const double uni = static_cast<double>(a.area()) + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.0;
+}
+
+// 统计 candidate 中能在 reference 里找到 IoU >= 0.5 对应框的数量（每个参考框只匹配一次）
+size_t countMatches(const FrameBoxes& candidate, const FrameBoxes& reference) {
+    std::vector<bool> used(reference.size(), false);
+    size_t matched = 0;
+    for (const auto& box : candidate) {
+        for (size_t j = 0; j < reference.size(); ++j) {
+            if (!used[j] && iou(box, reference[j]) >= 0.5) {
+                used[j] = true;
+                ++matched;
+                break;
+            }
+        }
+    }
+    return matched;
+}
+
+std::vector<std::string> splitList(const std::string& text) {
+    std::vector<std::string> items;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) items.push_back(item);
+    }
+    return items;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<std::string> recordings;
+    std::vector<std::string> backends = {"hog", "mmod", "opencv_dnn"};
+    std::string reference;
+    std::string config_path = "config/config.json";
+    size_t max_frames = 0;
+    std::vector<size_t> thread_counts;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--backends" && i + 1 < argc) {
+            backends = splitList(argv[++i]);
+        } else if (arg == "--reference" && i + 1 < argc) {
+            reference = argv[++i];
+        } else if (arg == "--max-frames" && i + 1 < argc) {
+            max_frames = static_cast<size_t>(std::max(0, std::stoi(argv[++i])));
+        } else if (arg == "--threads" && i + 1 < argc) {
+            for (const auto& item : splitList(argv[++i])) {
+                thread_counts.push_back(static_cast<size_t>(std::max(0, std::stoi(item))));
+            }
+        } else if (arg == "--config" && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (arg.rfind("--", 0) == 0) {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return 1;
+        } else {
+            recordings.push_back(arg);
+        }
+    }
+    if (recordings.empty() || backends.empty()) {
+        std::cerr << "用法: " << argv[0] << " <录像文件>... [--backends hog,mmod,opencv_dnn] [--reference 后端]"
+                  << " [--max-frames N] [--threads 1,2,4] [--config 配置文件]" << std::endl;
+        return 1;
+    }
+    if (reference.empty()) reference = backends.back();
+
+    ConfigParser config;
+    if (!config.load(config_path)) {
+        return 1;
+    }
+    const DetectionOptions base_options = DetectionOptions::fromConfig(config);
+    auto& monitor = PerformanceMonitor::getInstance();
+
+    // 要跑的 (后端, 线程数)；只有 hog 的扫描是多线程的
+    std::vector<std::pair<std::string, size_t>> variants;
+    for (const auto& backend : backends) {
+        if (backend == "hog" && !thread_counts.empty()) {
+            for (size_t threads : thread_counts) variants.emplace_back(backend, threads);
+        } else {
+            variants.emplace_back(backend, base_options.threads);
+        }
+    }
+
+    std::vector<BackendRun> runs;
+    for (const auto& [backend, threads] : variants) {
+        BackendRun run;
+        run.backend = backend;
+        run.label = backend;
+        if (backend == "hog" && !thread_counts.empty()) run.label += " x" + std::to_string(threads);
+        DetectionOptions options = base_options;
+        options.backend = backend;
+        options.threads = threads;
+
+        std::unique_ptr<FaceDetector> detector;
+        try {
+            detector = createFaceDetector(options);
+        } catch (const std::exception& e) {
+            std::cerr << "Skipping backend " << run.label << ": " << e.what() << std::endl;
+            runs.push_back(std::move(run));
+            continue;
+        }
+
+        std::cout << "Running backend " << run.label << "..." << std::endl;
+        const std::string task = "检测后端 " + run.label;
+        for (const auto& path : recordings) {
+            FrameReplaySource source(path, false);
+            if (!source.isOpened()) {
+                return 1;
+            }
+            cv::Mat frame;
+            long long timestamp_ns = 0;
+            for (size_t n = 0; (max_frames == 0 || n < max_frames) && source.read(frame, timestamp_ns); ++n) {
+                const auto start = PerformanceMonitor::Clock::now();
+                run.frames.push_back(detector->detect(frame));
+                monitor.recordDuration(task, PerformanceMonitor::Clock::now() - start);
+            }
+        }
+        run.ok = true;
+        runs.push_back(std::move(run));
+    }
+
+    const BackendRun* reference_run = nullptr;
+    for (const auto& run : runs) {
+        if (!reference_run && run.ok && run.backend == reference) reference_run = &run;
+    }
+
+    // --- 汇总 ---
+    const auto summaries = monitor.getTaskSummaries();
+    std::cout << "\n--- Detector Backend Comparison (reference: " << reference << ") ---\n";
+    std::cout << std::left << std::setw(14) << "Backend" << std::right << std::setw(8) << "Frames"
+              << std::setw(10) << "Avg ms" << std::setw(10) << "P50 ms" << std::setw(10) << "P99 ms"
+              << std::setw(12) << "Faces/frm" << std::setw(10) << "Recall" << std::setw(11) << "Precision" << "\n";
+    std::cout << std::fixed << std::setprecision(2);
+    for (const auto& run : runs) {
+        std::cout << std::left << std::setw(14) << run.label << std::right;
+        if (!run.ok) {
+            std::cout << "  (unavailable)\n";
+            continue;
+        }
+        PerformanceMonitor::TaskSummary timing;
+        for (const auto& summary : summaries) {
+            if (summary.name == "检测后端 " + run.label) timing = summary;
+        }
+
+        size_t faces = 0, matched_reference = 0, matched_own = 0, reference_faces = 0;
+        for (size_t f = 0; f < run.frames.size(); ++f) {
+            faces += run.frames[f].size();
+            if (reference_run) {
+                reference_faces += reference_run->frames[f].size();
+                matched_reference += countMatches(reference_run->frames[f], run.frames[f]);
+                matched_own += countMatches(run.frames[f], reference_run->frames[f]);
+            }
+        }
+        const double per_frame = run.frames.empty() ? 0.0 : static_cast<double>(faces) / run.frames.size();
+        std::cout << std::setw(8) << run.frames.size() << std::setw(10) << timing.avg_ms << std::setw(10)
+                  << timing.p50_ms << std::setw(10) << timing.p99_ms << std::setw(12) << per_frame;
+        if (reference_run && reference_faces > 0) {
+            std::cout << std::setw(10) << static_cast<double>(matched_reference) / reference_faces;
+        } else {
+            std::cout << std::setw(10) << "-";
+        }
+        if (reference_run && faces > 0) {
+            std::cout << std::setw(11) << static_cast<double>(matched_own) / faces;
+        } else {
+            std::cout << std::setw(11) << "-";
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::defaultfloat << std::endl;
+    return 0;
+}
@@ -0,0 +1,436 @@
+// 批量人脸特征提取 / 检索工具：遍历大规模图片目录或图片列表，
+// 并行完成解码、检测、对齐和特征提取，把每张人脸的特征（或人脸库中的最近匹配）流式写出。
+//
+// 用法: face_index (--input <目录> | --list <列表文件>) --output <输出文件> [选项]
+//   --mode embed|match   输出特征向量（默认）或人脸库中的最近匹配
+//   --format csv|bin     输出格式，bin 仅用于 embed 模式（默认 csv）
+//   --workers N          工作线程数（默认 CPU 核数）
+//   --config 路径        配置文件（默认 config/config.json）
+//   --resume             从上次中断的位置继续
+//
+// 内存占用有界：输入按需遍历，在途图片数不超过 workers*8。
+// 断点续传：每处理完一批图片，把已完成的输入数和输出文件偏移写入 <输出文件>.progress；
+// --resume 时把输出截断到该偏移，再跳过已完成的输入，保证每张图片恰好输出一次。
+//
+// CSV 列: path,face,left,top,right,bottom,d0..d127          (embed)
+//         path,face,left,top,right,bottom,name,distance     (match)
+// bin 记录: uint32 路径长度 | 路径 | int32 人脸序号 | int32 x4 人脸框 | uint32 维数 | float x 维数
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dlib/opencv.h>
+
+#include "ConfigParser.h"
+#include "FaceDetector.h"
+#include "FaceRecognition.hpp"
+#include "PerformanceMonitor.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+struct Options {
+    std::string input_dir;
+    std::string list_path;
+    std::string output_path;
+    std::string mode = "embed";
+    std::string format = "csv";
+    std::string config_path = "config/config.json";
+    size_t workers = 0;
+    bool resume = false;
+};
+
+struct FaceRecord {
+    dlib::rectangle rect;
+    dlib::matrix<float, 0, 1> descriptor;
+    FaceRecognition::MatchResult match;
+};
+
+struct ImageResult {
+    std::string path;
+    std::vector<FaceRecord> faces;
+};
+
+// 已完成进度，写在 <输出文件>.progress
+struct Progress {
+    size_t inputs_done = 0;
+    std::uintmax_t output_bytes = 0;
+    std::string last_path;
+};
+
+const size_t kCheckpointInterval = 256;
+
+bool isImageFile(const fs::path& path) {
+    std::string ext = path.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp";
+}
+
+// CSV 字段：加引号，内部的引号写成两个（RFC 4180），路径和姓名里的逗号、引号不会错列
+std::string csvField(const std::string& text) {
+    std::string field = "\"";
+    for (const char c : text) {
+        if (c == '"') field += '"';
+        field += c;
+    }
+    return field + '"';
+}
+
+// 按需产生输入路径，不把整个目录读进内存
+class InputStream {
+public:
+    explicit InputStream(const Options& options) {
+        if (!options.list_path.empty()) {
+            list_.open(options.list_path);
+            ok_ = list_.is_open();
+        } else {
+            std::error_code ec;
+            dir_ = fs::recursive_directory_iterator(options.input_dir,
+                                                    fs::directory_options::skip_permission_denied, ec);
+            ok_ = !ec;
+            use_dir_ = true;
+        }
+    }
+
+    bool ok() const { return ok_; }
+
+    bool next(std::string& path) {
+        if (!use_dir_) {
+            while (std::getline(list_, path)) {
+                if (!path.empty()) return true;
+            }
+            return false;
+        }
+        std::error_code ec;
+        for (; dir_ != fs::recursive_directory_iterator(); dir_.increment(ec)) {
+            if (dir_->is_regular_file(ec) && isImageFile(dir_->path())) {
+                path = dir_->path().string();
+                dir_.increment(ec);
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    bool ok_ = false;
+    bool use_dir_ = false;
+    std::ifstream list_;
+    fs::recursive_directory_iterator dir_;
+};
+
+template <typename T>
+void writePod(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void writeResult(std::ofstream& out, const Options& options, const ImageResult& result) {
+    for (size_t i = 0; i < result.faces.size(); ++i) {
+        const FaceRecord& face = result.faces[i];
+        if (options.format == "bin") {
+            writePod(out, static_cast<uint32_t>(result.path.size()));
+            out.write(result.path.data(), result.path.size());
+            writePod(out, static_cast<int32_t>(i));
+            writePod(out, static_cast<int32_t>(face.rect.left()));
+            writePod(out, static_cast<int32_t>(face.rect.top()));
+            writePod(out, static_cast<int32_t>(face.rect.right()));
+            writePod(out, static_cast<int32_t>(face.rect.bottom()));
+            writePod(out, static_cast<uint32_t>(face.descriptor.size()));
+            out.write(reinterpret_cast<const char*>(&face.descriptor(0)), face.descriptor.size() * sizeof(float));
+            continue;
+        }
+
+        out << csvField(result.path) << ',' << i << ',' << face.rect.left() << ',' << face.rect.top() << ','
+            << face.rect.right() << ',' << face.rect.bottom();
+        if (options.mode == "match") {
+            out << ',' << csvField(face.match.name) << ',' << face.match.distance;
+        } else {
+            for (long d = 0; d < face.descriptor.size(); ++d) out << ',' << face.descriptor(d);
+        }
+        out << '\n';
+    }
+}
+
+bool loadProgress(const std::string& path, Progress& progress) {
+    std::ifstream in(path);
+    if (!(in >> progress.inputs_done >> progress.output_bytes)) return false;
+    in.ignore();
+    std::getline(in, progress.last_path);
+    return true;
+}
+
+void saveProgress(const std::string& path, const Progress& progress) {
+    // 先写临时文件再改名，中断时不会留下半个进度文件
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream out(tmp, std::ios::trunc);
+        out << progress.inputs_done << ' ' << progress.output_bytes << '\n' << progress.last_path << '\n';
+    }
+    fs::rename(tmp, path);
+}
+
+bool parseArgs(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string { return (i + 1 < argc) ? argv[++i] : ""; };
+        if (arg == "--input") options.input_dir = value();
+        else if (arg == "--list") options.list_path = value();
+        else if (arg == "--output") options.output_path = value();
+        else if (arg == "--mode") options.mode = value();
+        else if (arg == "--format") options.format = value();
+        else if (arg == "--config") options.config_path = value();
+        else if (arg == "--workers") {
+            const std::string text = value();
+            try {
+                options.workers = static_cast<size_t>(std::max(0, std::stoi(text)));
+            } catch (const std::exception&) {
+                std::cerr << "--workers 需要一个整数: " << text << std::endl;
+                return false;
+            }
+        }
+        else if (arg == "--resume") options.resume = true;
+        else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return false;
+        }
+    }
+    if ((options.input_dir.empty() == options.list_path.empty()) || options.output_path.empty()) {
+        std::cerr << "用法: face_index (--input <目录> | --list <列表文件>) --output <输出文件> "
+                     "[--mode embed|match] [--format csv|bin] [--workers N] [--config 路径] [--resume]" << std::endl;
+        return false;
+    }
+    if (options.mode != "embed" && options.mode != "match") {
+        std::cerr << "--mode 只能是 embed 或 match" << std::endl;
+        return false;
+    }
+    if (options.format != "csv" && (options.format != "bin" || options.mode != "embed")) {
+        std::cerr << "--format bin 只支持 embed 模式" << std::endl;
+        return false;
+    }
+    if (options.workers == 0) {
+        options.workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return true;
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseArgs(argc, argv, options)) {
+        return 1;
+    }
+
+    ConfigParser config;
+    if (!config.load(options.config_path)) {
+        return 1;
+    }
+
+    try {
+        FaceRecognition face_recognizer(config);
+
+        InputStream inputs(options);
+        if (!inputs.ok()) {
+            std::cerr << "无法打开输入: " << (options.list_path.empty() ? options.input_dir : options.list_path) << std::endl;
+            return 1;
+        }
+
+        // --- 断点续传：截断输出到上次检查点并跳过已完成的输入 ---
+        const std::string progress_path = options.output_path + ".progress";
+        Progress progress;
+        const bool resuming = options.resume && loadProgress(progress_path, progress) && fs::exists(options.output_path);
+        if (resuming) {
+            std::string path;
+            for (size_t i = 0; i < progress.inputs_done; ++i) {
+                if (!inputs.next(path)) break;
+            }
+            if (progress.inputs_done > 0 && path != progress.last_path) {
+                std::cerr << "输入与上次运行不一致（期望 " << progress.last_path << "，实际 " << path
+                          << "），无法续传。" << std::endl;
+                return 1;
+            }
+            fs::resize_file(options.output_path, progress.output_bytes);
+            std::cout << "Resuming after " << progress.inputs_done << " inputs." << std::endl;
+        } else {
+            progress = Progress();
+        }
+
+        const auto open_mode = std::ios::binary | (resuming ? std::ios::app : std::ios::trunc);
+        std::ofstream out(options.output_path, open_mode);
+        if (!out.is_open()) {
+            std::cerr << "无法写入输出文件: " << options.output_path << std::endl;
+            return 1;
+        }
+        if (!resuming && options.format == "csv") {
+            out << "path,face,left,top,right,bottom";
+            if (options.mode == "match") {
+                out << ",name,distance";
+            } else {
+                for (int d = 0; d < 128; ++d) out << ",d" << d;
+            }
+            out << '\n';
+        }
+
+        // --- 生产者 -> 工作线程 -> 按序写出 ---
+        std::mutex mutex;
+        std::condition_variable work_available;
+        std::condition_variable result_available;
+        std::condition_variable window_available;
+        std::deque<std::pair<size_t, std::string>> work;
+        std::map<size_t, ImageResult> results;
+        size_t next_to_write = 0;
+        size_t produced = 0;
+        bool input_done = false;
+        const size_t window = options.workers * 8;  // 在途图片上限，决定内存上界
+
+        // 已经按图片并行，单张图片的检测不再开多线程
+        DetectionOptions detection = DetectionOptions::fromConfig(config);
+        detection.threads = 1;
+
+        // 检测器在启动线程前创建，后端名或模型路径配置错误时由下面的 catch 报告
+        std::vector<std::unique_ptr<FaceDetector>> detectors;
+        for (size_t w = 0; w < options.workers; ++w) {
+            detectors.push_back(createFaceDetector(detection));
+        }
+
+        std::vector<std::thread> workers;
+        for (size_t w = 0; w < options.workers; ++w) {
+            workers.emplace_back([&, w] {
+                FaceDetector* detector = detectors[w].get();
+                const auto& sp = face_recognizer.getShapePredictor();
+                while (true) {
+                    std::pair<size_t, std::string> item;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex);
+                        work_available.wait(lock, [&] { return input_done || !work.empty(); });
+                        if (work.empty()) return;
+                        item = std::move(work.front());
+                        work.pop_front();
+                    }
+
+                    ImageResult result;
+                    result.path = item.second;
+                    try {
+                        cv::Mat frame;
+                        {
+                            PM_SCOPED(图片解码);
+                            frame = cv::imread(item.second, cv::IMREAD_COLOR);
+                        }
+                        if (frame.empty()) throw std::runtime_error("cannot decode image");
+                        dlib::cv_image<dlib::bgr_pixel> img(frame);
+                        std::vector<dlib::rectangle> faces;
+                        {
+                            PM_SCOPED(人脸检测);
+                            faces = detector->detect(frame);
+                        }
+                        for (const auto& rect : faces) {
+                            FaceRecord face;
+                            face.rect = rect;
+                            dlib::matrix<dlib::rgb_pixel> chip;
+                            {
+                                PM_SCOPED(人脸芯片提取);
+                                auto shape = sp(img, rect);
+                                dlib::extract_image_chip(img, dlib::get_face_chip_details(shape, 150, 0.25), chip);
+                            }
+                            {
+                                PM_SCOPED(核心人脸识别);
+                                face.descriptor = face_recognizer.computeDescriptor(chip);
+                            }
+                            if (options.mode == "match") {
+                                face.match = face_recognizer.findBestMatch(face.descriptor);
+                            }
+                            result.faces.push_back(std::move(face));
+                        }
+                    } catch (const std::exception& e) {
+                        std::cerr << "Skipping " << item.second << ": " << e.what() << std::endl;
+                    }
+
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        results.emplace(item.first, std::move(result));
+                    }
+                    result_available.notify_one();
+                }
+            });
+        }
+
+        // 写出线程：按输入顺序写，并定期保存检查点
+        size_t written_faces = 0;
+        std::thread writer([&] {
+            while (true) {
+                ImageResult result;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    result_available.wait(lock, [&] {
+                        return results.count(next_to_write) > 0 || (input_done && next_to_write == produced);
+                    });
+                    auto it = results.find(next_to_write);
+                    if (it == results.end()) break;
+                    result = std::move(it->second);
+                    results.erase(it);
+                    ++next_to_write;
+                }
+                window_available.notify_one();
+
+                writeResult(out, options, result);
+                written_faces += result.faces.size();
+                progress.inputs_done++;
+                progress.last_path = result.path;
+                if (progress.inputs_done % kCheckpointInterval == 0) {
+                    out.flush();
+                    progress.output_bytes = fs::file_size(options.output_path);
+                    saveProgress(progress_path, progress);
+                    std::cout << "Processed " << progress.inputs_done << " inputs, " << written_faces
+                              << " faces this run." << std::endl;
+                }
+            }
+        });
+
+        const auto start_time = PerformanceMonitor::Clock::now();
+        std::string path;
+        while (inputs.next(path)) {
+            std::unique_lock<std::mutex> lock(mutex);
+            window_available.wait(lock, [&] { return produced - next_to_write < window; });
+            work.emplace_back(produced++, path);
+            lock.unlock();
+            work_available.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            input_done = true;
+        }
+        work_available.notify_all();
+        result_available.notify_all();
+
+        for (auto& worker : workers) worker.join();
+        result_available.notify_all();
+        writer.join();
+
+        out.flush();
+        progress.output_bytes = fs::file_size(options.output_path);
+        saveProgress(progress_path, progress);
+
+        const double elapsed_s = std::chrono::duration<double>(PerformanceMonitor::Clock::now() - start_time).count();
+        std::cout << "Done: " << produced << " images, " << written_faces << " faces in " << elapsed_s << " s";
+        if (elapsed_s > 0) std::cout << " (" << produced / elapsed_s << " images/s)";
+        std::cout << "." << std::endl;
+        PerformanceMonitor::getInstance().printReport();
+    } catch (const std::exception& e) {
+        std::cerr << "批量处理失败: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
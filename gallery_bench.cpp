@@ -0,0 +1,252 @@
+// 人脸库检索基准：比较 float / int8 / fp16 存储和 PCA 两阶段检索的内存占用、单次检索耗时，
+// 以及最近邻（召回）、阈值判定与 float 全量扫描的一致程度；并比较逐个检索与矩阵乘法批量检索
+// （nearestBatch）随每批查询数和人脸库规模的变化。
+//
+// 用法: gallery_bench [--sizes 10000,100000,1000000] [--queries 500] [--rerank 8]
+//                     [--batches 1,4,16,64] [--pca 16,32] [--pca-candidates 100]
+//                     [--library 特征.bin] [--threshold 0.4] [--seed 1]
+//   --sizes      人脸库规模列表
+//   --queries    每个规模的查询次数；查询为库中随机条目加噪声，另有一半为库外随机特征
+//   --rerank     量化存储的精排候选数；另外总会跑一组 rerank 0（不精排、不保留浮点副本）
+//   --batches    批量检索对比中每批的查询数（float 存储）
+//   --pca        PCA 粗筛的维数列表（float 存储），--pca-candidates 为粗筛保留的候选数
+//   --library    用 face_index --format bin 导出的真实特征代替合成特征（规模不超过文件中的特征数）
+//   --threshold  判定阈值（与 face_match_threshold 含义相同）
+//
+// 合成特征是 128 维单位高斯向量，各方向方差相同，PCA 在它上面几乎没有效果；
+// 评估 PCA 的召回请用 --library 提供真实特征。扫描耗时只与规模和存储格式有关。
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "FaceGallery.h"
+#include "PerformanceMonitor.h"
+
+namespace {
+using Descriptor = dlib::matrix<float,0,1>;
+
+Descriptor randomDescriptor(std::mt19937& rng) {
+    std::normal_distribution<float> normal(0.f, 1.f);
+    Descriptor desc(128);
+    for (long i = 0; i < desc.size(); ++i) desc(i) = normal(rng);
+    return desc / dlib::length(desc);
+}
+
+std::vector<size_t> parseList(const std::string& text) {
+    std::vector<size_t> sizes;
+    std::stringstream ss(text);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) sizes.push_back(static_cast<size_t>(std::stoull(item)));
+    }
+    return sizes;
+}
+
+// 读取 face_index 的 bin 输出：uint32 路径长度 | 路径 | int32 人脸序号 | int32 x4 人脸框 | uint32 维数 | float x 维数
+std::vector<Descriptor> readDescriptors(const std::string& path) {
+    std::vector<Descriptor> descriptors;
+    std::ifstream in(path, std::ios::binary);
+    uint32_t length = 0;
+    while (in.read(reinterpret_cast<char*>(&length), sizeof(length))) {
+        in.ignore(length + 5 * sizeof(int32_t));
+        uint32_t dim = 0;
+        if (!in.read(reinterpret_cast<char*>(&dim), sizeof(dim)) || dim == 0) break;
+        Descriptor desc(dim);
+        if (!in.read(reinterpret_cast<char*>(&desc(0)), dim * sizeof(float))) break;
+        descriptors.push_back(desc);
+    }
+    return descriptors;
+}
+
+struct Mode {
+    std::string label;
+    GalleryOptions options;
+};
+} // namespace
+
+int main(int argc, char** argv) {
+    std::vector<size_t> sizes = {10000, 100000, 1000000};
+    std::vector<size_t> batches = {1, 4, 16, 64};
+    std::vector<size_t> pca_dims = {16, 32};
+    int pca_candidates = 100;
+    std::string library_path;
+    size_t query_count = 500;
+    int rerank = 8;
+    double threshold = 0.4;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes = parseList(argv[++i]);
+        } else if (arg == "--batches" && i + 1 < argc) {
+            batches = parseList(argv[++i]);
+        } else if (arg == "--pca" && i + 1 < argc) {
+            pca_dims = parseList(argv[++i]);
+        } else if (arg == "--pca-candidates" && i + 1 < argc) {
+            pca_candidates = std::max(1, std::stoi(argv[++i]));
+        } else if (arg == "--library" && i + 1 < argc) {
+            library_path = argv[++i];
+        } else if (arg == "--queries" && i + 1 < argc) {
+            query_count = static_cast<size_t>(std::max(1, std::stoi(argv[++i])));
+        } else if (arg == "--rerank" && i + 1 < argc) {
+            rerank = std::max(0, std::stoi(argv[++i]));
+        } else if (arg == "--threshold" && i + 1 < argc) {
+            threshold = std::stod(argv[++i]);
+        } else if (arg == "--seed" && i + 1 < argc) {
+            seed = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else {
+            std::cerr << "用法: " << argv[0] << " [--sizes N,N,...] [--queries N] [--rerank K]"
+                      << " [--batches N,N,...] [--pca D,D,...] [--pca-candidates N] [--library 特征.bin]"
+                      << " [--threshold T] [--seed S]" << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<Mode> modes;
+    for (const std::string storage : {"float", "int8", "fp16"}) {
+        Mode mode;
+        mode.options.storage = storage;
+        mode.options.rerank = storage == "float" ? 0 : rerank;
+        mode.label = storage == "float" ? storage : storage + "/rerank" + std::to_string(rerank);
+        modes.push_back(mode);
+        if (storage != "float" && rerank > 0) {
+            mode.options.rerank = 0;
+            mode.label = storage + "/rerank0";
+            modes.push_back(mode);
+        }
+    }
+    for (size_t dims : pca_dims) {
+        Mode mode;
+        mode.options.pca_dims = static_cast<int>(dims);
+        mode.options.pca_candidates = pca_candidates;
+        mode.label = "float/pca" + std::to_string(dims);
+        modes.push_back(mode);
+    }
+
+    std::vector<Descriptor> real;
+    if (!library_path.empty()) {
+        real = readDescriptors(library_path);
+        if (real.empty()) {
+            std::cerr << "No descriptors read from " << library_path << std::endl;
+            return 1;
+        }
+        std::cout << "Loaded " << real.size() << " descriptors from " << library_path << std::endl;
+    }
+
+    auto& monitor = PerformanceMonitor::getInstance();
+    for (size_t size : sizes) {
+        std::mt19937 rng(seed);
+        std::vector<Descriptor> library;
+        if (!real.empty()) {
+            size = std::min(size, real.size());
+            library.assign(real.begin(), real.begin() + size);
+        } else {
+            library.resize(size);
+            for (auto& desc : library) desc = randomDescriptor(rng);
+        }
+
+        // 一半查询是库中条目加噪声（距离约 0.3，落在阈值附近），一半是库外人员
+        std::normal_distribution<float> noise(0.f, 0.027f);
+        std::uniform_int_distribution<size_t> pick(0, size - 1);
+        std::vector<Descriptor> queries(query_count);
+        for (size_t q = 0; q < query_count; ++q) {
+            if (q % 2 == 0) {
+                queries[q] = library[pick(rng)];
+                for (long k = 0; k < queries[q].size(); ++k) queries[q](k) += noise(rng);
+            } else if (size + q / 2 < real.size()) {
+                queries[q] = real[size + q / 2];  // 不在库中的真实人脸
+            } else {
+                queries[q] = randomDescriptor(rng);
+            }
+        }
+
+        std::cout << "\n--- Gallery size " << size << " ---\n";
+        std::cout << std::left << std::setw(16) << "Storage" << std::right << std::setw(12) << "Memory MB"
+                  << std::setw(10) << "Avg us" << std::setw(10) << "P99 us" << std::setw(10) << "Top-1"
+                  << std::setw(11) << "Decision" << std::setw(10) << "Index ms" << "\n";
+
+        std::vector<FaceGallery::Hit> reference;
+        for (const auto& mode : modes) {
+            FaceGallery gallery(mode.options);
+            for (size_t i = 0; i < size; ++i) gallery.add(std::to_string(i), library[i]);
+            const auto index_start = PerformanceMonitor::Clock::now();
+            gallery.buildIndex();
+            const double index_ms =
+                std::chrono::duration<double, std::milli>(PerformanceMonitor::Clock::now() - index_start).count();
+
+            const std::string task = "人脸库检索 " + mode.label + " " + std::to_string(size);
+            std::vector<FaceGallery::Hit> hits(query_count);
+            for (size_t q = 0; q < query_count; ++q) {
+                const auto start = PerformanceMonitor::Clock::now();
+                hits[q] = gallery.nearest(queries[q]);
+                monitor.recordDuration(task, PerformanceMonitor::Clock::now() - start);
+            }
+            if (reference.empty()) reference = hits;
+
+            size_t same_index = 0, same_decision = 0;
+            for (size_t q = 0; q < query_count; ++q) {
+                same_index += hits[q].index == reference[q].index;
+                same_decision += (hits[q].distance <= threshold) == (reference[q].distance <= threshold);
+            }
+            PerformanceMonitor::TaskSummary timing;
+            for (const auto& summary : monitor.getTaskSummaries()) {
+                if (summary.name == task) timing = summary;
+            }
+            std::cout << std::left << std::setw(16) << mode.label << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(12) << gallery.memoryBytes() / (1024.0 * 1024.0)
+                      << std::setw(10) << timing.avg_ms * 1000.0 << std::setw(10) << timing.p99_ms * 1000.0
+                      << std::setprecision(4) << std::setw(10) << static_cast<double>(same_index) / query_count
+                      << std::setw(11) << static_cast<double>(same_decision) / query_count;
+            if (gallery.hasIndex()) {
+                std::cout << std::setprecision(1) << std::setw(10) << index_ms;
+            } else {
+                std::cout << std::setw(10) << "-";
+            }
+            std::cout << "\n";
+        }
+
+        // 逐个检索 vs 矩阵乘法批量检索：同一组查询按 batch 切分，比较每个查询的平均耗时
+        FaceGallery gallery;
+        for (size_t i = 0; i < size; ++i) gallery.add(std::to_string(i), library[i]);
+        std::cout << std::left << std::setw(16) << "Batch" << std::right << std::setw(12) << "Loop us/q"
+                  << std::setw(12) << "GEMM us/q" << std::setw(10) << "Speedup" << std::setw(10) << "Same" << "\n";
+        for (size_t batch : batches) {
+            if (batch == 0) continue;
+            std::vector<FaceGallery::Hit> loop_hits, gemm_hits;
+            PerformanceMonitor::Clock::duration loop_time{}, gemm_time{};
+            for (size_t begin = 0; begin < query_count; begin += batch) {
+                const std::vector<Descriptor> chunk(queries.begin() + begin,
+                                                    queries.begin() + std::min(query_count, begin + batch));
+                auto start = PerformanceMonitor::Clock::now();
+                for (const auto& query : chunk) loop_hits.push_back(gallery.nearest(query));
+                loop_time += PerformanceMonitor::Clock::now() - start;
+
+                start = PerformanceMonitor::Clock::now();
+                const auto hits = gallery.nearestBatch(chunk);
+                gemm_time += PerformanceMonitor::Clock::now() - start;
+                gemm_hits.insert(gemm_hits.end(), hits.begin(), hits.end());
+            }
+            size_t same = 0;
+            for (size_t q = 0; q < query_count; ++q) {
+                same += loop_hits[q].index == gemm_hits[q].index &&
+                        std::abs(loop_hits[q].distance - gemm_hits[q].distance) < 1e-5;
+            }
+            const double loop_us = std::chrono::duration<double, std::micro>(loop_time).count() / query_count;
+            const double gemm_us = std::chrono::duration<double, std::micro>(gemm_time).count() / query_count;
+            std::cout << std::left << std::setw(16) << batch << std::right << std::fixed << std::setprecision(1)
+                      << std::setw(12) << loop_us << std::setw(12) << gemm_us << std::setprecision(2)
+                      << std::setw(10) << (gemm_us > 0 ? loop_us / gemm_us : 0.0) << std::setprecision(4)
+                      << std::setw(10) << static_cast<double>(same) / query_count << "\n";
+        }
+    }
+    std::cout << std::defaultfloat << std::endl;
+    return 0;
+}
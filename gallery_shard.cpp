@@ -0,0 +1,102 @@
+// 人脸库分片服务：持有人脸库的一部分，通过 TCP 回答 top-k 检索（协议见 include/GalleryShard.h）。
+// 协调方在 config.json 的 gallery.shards 中列出各分片的地址，FaceRecognition 把查询并行发给所有分片并合并结果。
+//
+// 用法: gallery_shard [--config 路径] [--csv 特征.csv] [--port N] [--bind 地址]
+//   --config  配置文件（默认 config/config.json），使用其中的 gallery.*（存储格式、索引、名单）
+//   --csv     本分片的特征 CSV（每行 "姓名,v1 v2 ..."），默认 face_lib.csv_path
+//   --port    监听端口，默认 shard.port（0 表示由系统分配，启动后打印实际端口）
+//   --bind    监听地址，默认 shard.bind 或 127.0.0.1
+//
+// 分片只加载特征，不加载模型；按身份把总库拆成若干 CSV（同一人的参考特征放在同一个分片），
+// 每个分片进程用自己的 CSV 启动。Ctrl+C 退出时打印检索耗时统计。
+
+#include <csignal>
+#include <iostream>
+#include <string>
+
+#include "ConfigParser.h"
+#include "FaceGallery.h"
+#include "GalleryShard.h"
+#include "PerformanceMonitor.h"
+
+namespace {
+GalleryShardServer* g_server = nullptr;
+
+void signalHandler(int) {
+    if (g_server) g_server->stop();
+}
+} // namespace
+
+int main(int argc, char** argv) {
+    std::string config_path = "config/config.json";
+    std::string csv_path;
+    std::string bind_address;
+    int port = -1;
+    const auto usage = [&argv]() {
+        std::cerr << "用法: " << argv[0] << " [--config 路径] [--csv 特征.csv] [--port N] [--bind 地址]" << std::endl;
+        return 1;
+    };
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--config" && i + 1 < argc) {
+            config_path = argv[++i];
+        } else if (arg == "--csv" && i + 1 < argc) {
+            csv_path = argv[++i];
+        } else if (arg == "--port" && i + 1 < argc) {
+            const std::string text = argv[++i];
+            size_t used = 0;
+            try {
+                port = std::stoi(text, &used);
+            } catch (const std::exception&) {
+                used = 0;
+            }
+            if (used == 0 || used != text.size() || port < 0 || port > 65535) {
+                std::cerr << "--port 需要 0 到 65535 之间的整数: " << text << std::endl;
+                return usage();
+            }
+        } else if (arg == "--bind" && i + 1 < argc) {
+            bind_address = argv[++i];
+        } else {
+            return usage();
+        }
+    }
+
+    ConfigParser config;
+    if (!config.load(config_path)) {
+        std::cerr << "错误: 无法加载配置文件 " << config_path << std::endl;
+        return 1;
+    }
+    if (csv_path.empty()) csv_path = config.get<std::string>("face_lib.csv_path", "");
+    if (port < 0) port = config.get<int>("shard.port", 0);
+    if (port < 0 || port > 65535) {
+        std::cerr << "错误: shard.port 超出 0 到 65535 的范围: " << port << std::endl;
+        return 1;
+    }
+    if (bind_address.empty()) bind_address = config.get<std::string>("shard.bind", "127.0.0.1");
+
+    try {
+        FaceGallery gallery(GalleryOptions::fromConfig(config));
+        const size_t count = gallery.loadCsv(csv_path);
+        if (count == 0) {
+            std::cerr << "错误: 没有从 " << csv_path << " 读到特征" << std::endl;
+            return 1;
+        }
+        gallery.buildIndex();
+        gallery.loadWatchlists(config.get<json>("gallery.watchlists", json::object()));
+
+        GalleryShardServer server(gallery, port, bind_address);
+        g_server = &server;
+        std::signal(SIGINT, signalHandler);
+        std::signal(SIGTERM, signalHandler);
+        std::cout << "Gallery shard serving " << count << " references of " << gallery.identityCount()
+                  << " people on " << bind_address << ":" << server.port() << std::endl;
+        server.serve();
+        g_server = nullptr;
+    } catch (const std::exception& e) {
+        std::cerr << "错误: " << e.what() << std::endl;
+        return 1;
+    }
+
+    PerformanceMonitor::getInstance().printReport();
+    return 0;
+}
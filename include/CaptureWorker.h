@@ -0,0 +1,105 @@
+#ifndef CAPTURE_WORKER_H
+#define CAPTURE_WORKER_H
+
+#include "FramePipeline.h"
+#include "FrameRecorder.h"
+#include "FrameSource.h"
+#include "MotionGate.h"
+#include "PerformanceMonitor.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ConfigParser;
+class FaceRecognition;
+
+// 一路视频源的配置，对应 config.json 中 sources 数组的一项
+struct SourceConfig {
+    std::string name;             // 源名称，用于日志和统计
+    std::string type = "camera";  // camera | file | replay
+    int device = 0;               // type=camera 时的设备编号
+    std::string path;             // type=file / replay 时的文件路径
+    std::string topic;            // 推流路径，例如 /webcam
+    bool realtime = true;         // replay 是否按录制速度回放
+    bool loop = false;            // replay 是否循环
+    std::string record_path;      // 非空时把原始帧录制到该文件
+    int record_jpeg_quality = 90;
+    PipelineOptions pipeline;     // 检测和质量门控，来自全局 detection.* / quality.*
+    MotionGateOptions motion;     // 运动门控，静止画面跳过人脸检测
+    std::vector<DetectionRegion> regions;  // 检测区域，为空时检测整帧
+    std::vector<std::string> watchlists;   // 只匹配这些关注名单（gallery.watchlists）中的人，为空时匹配全库
+};
+
+// 读取所有视频源配置。没有 sources 数组时退回旧的单摄像头配置（/webcam，replay.*、record.*）。
+// 视频源引用了 gallery.watchlists 中没有定义的名单时抛出 std::runtime_error
+std::vector<SourceConfig> loadSourceConfigs(const ConfigParser& config);
+
+// 按配置打开视频源
+std::unique_ptr<FrameSource> openFrameSource(const SourceConfig& source_config);
+
+// 一路视频源的采集与处理：
+// 采集线程不断读帧（可选录制），处理线程取最新一帧做检测识别并推流。
+// 摄像头源在处理跟不上时丢弃旧帧，保证延迟不累积；文件和回放源不丢帧。
+// 所有 CaptureWorker 共享同一个 FaceRecognition（模型和人脸库只有一份）。
+class CaptureWorker {
+public:
+    using PublishFn = std::function<void(const std::string& topic, const std::vector<uchar>& jpeg)>;
+
+    // 配置了 record_path 但录像文件打不开时抛出 std::runtime_error
+    CaptureWorker(const SourceConfig& source_config, std::unique_ptr<FrameSource> source,
+                  FaceRecognition& recognizer, PublishFn publish);
+    ~CaptureWorker();
+
+    CaptureWorker(const CaptureWorker&) = delete;
+    CaptureWorker& operator=(const CaptureWorker&) = delete;
+
+    void start();
+    void stop();
+
+    // 源已读完且所有帧都已处理
+    bool finished() const { return finished_; }
+    // 是否已经发布过至少一帧
+    bool hasPublished() const { return frames_processed_ > 0; }
+
+    size_t framesProcessed() const { return frames_processed_; }
+    size_t framesDropped() const { return frames_dropped_; }
+    // 因画面静止而跳过检测的帧数
+    size_t framesSkipped() const { return frames_skipped_; }
+    const std::string& name() const { return config_.name; }
+
+private:
+    void captureLoop();
+    void processLoop();
+
+    SourceConfig config_;
+    std::unique_ptr<FrameSource> source_;
+    std::unique_ptr<FrameRecorder> recorder_;
+    FramePipeline pipeline_;
+    std::unique_ptr<MotionGate> motion_gate_;  // 未启用时为空
+    PublishFn publish_;
+    bool drop_stale_frames_;
+
+    // 采集线程与处理线程之间的单帧信箱
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    cv::Mat pending_frame_;
+    bool has_pending_ = false;
+    bool source_done_ = false;
+    bool stopping_ = false;
+
+    std::thread capture_thread_;
+    std::thread process_thread_;
+    std::atomic<bool> finished_{false};
+    std::atomic<size_t> frames_processed_{0};
+    std::atomic<size_t> frames_dropped_{0};
+    std::atomic<size_t> frames_skipped_{0};
+    PerformanceMonitor::TimePoint start_time_;
+};
+
+#endif // CAPTURE_WORKER_H
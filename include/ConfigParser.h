@@ -2,20 +2,41 @@
 #define CONFIG_PARSER_H
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 #include "nlohmann/json.hpp" // 引入json解析库
 
 using json = nlohmann::json;
 
+// 顶层常用配置项，在 load() 时解析一次，之后直接读字段
+struct Settings {
+    bool use_camera = true;             // false 时离线处理 video_path
+    std::string video_path;
+    double face_match_threshold = 0.6;
+    bool debug_mode = false;            // 启动时打印全部配置
+    int frame_sample_interval = 1;
+};
+
 class ConfigParser {
 public:
-    // 加载并解析配置文件
+    // 加载并解析配置文件。按已知配置项的表校验：类型不符（例如把布尔值写成 "true"）和未知的键
+    // 都会逐条报错（见 errors()）并返回 false，而不是在读取时悄悄退回默认值
     bool load(const std::string& config_path);
 
-    // 获取指定配置项的值 (模板函数，支持string, bool, double, int等)
+    // 从字符串加载（测试和工具使用），校验规则同 load
+    bool loadFromString(const std::string& text);
+
+    // 获取指定配置项的值 (模板函数，支持string, bool, double, int, json等)。
+    // 键用点号分隔（"gallery.storage"）；只是一次哈希查找，不抛异常，缺失时返回默认值
     template<typename T>
     T get(const std::string& key, const T& default_value = T{}) const;
 
+    // load() 时解析好的顶层配置
+    const Settings& settings() const { return settings_; }
+
+    // 上一次加载发现的问题，每条形如 "use_camera: expected bool, got string \"true\""
+    const std::vector<std::string>& errors() const { return errors_; }
+
     // 打印所有配置项
     void printAll() const;
 
@@ -24,7 +45,13 @@ public:
 
 
 private:
+    // 校验并展开 config_data_，填充 values_ 和 settings_
+    bool index();
+
     json config_data_;
+    std::unordered_map<std::string, json> values_;  // 点号路径 -> 配置值（含中间的对象）
+    Settings settings_;
+    std::vector<std::string> errors_;
 };
 
 #endif // CONFIG_PARSER_H
@@ -0,0 +1,28 @@
+#ifndef DETECTION_REGION_H
+#define DETECTION_REGION_H
+
+#include "ConfigParser.h"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 人脸检测感兴趣区域 (ROI)，对应 config.json 中 sources[i].roi 的一项：
+//   {"rect": [x, y, w, h]}                      矩形
+//   {"polygon": [[x, y], [x, y], [x, y], ...]}  多边形（至少 3 个点）
+// 坐标是相对帧宽高的比例 (0-1)，与摄像头分辨率无关。
+// 检测只在区域外接矩形裁出的子图上进行；多边形区域再按人脸框中心是否落在多边形内过滤。
+struct DetectionRegion {
+    cv::Rect2f rect;                  // 外接矩形（比例坐标）
+    std::vector<cv::Point2f> polygon; // 为空表示纯矩形区域
+
+    // 区域在给定帧尺寸下的像素外接矩形（已裁剪到帧内）
+    cv::Rect pixelRect(const cv::Size& frame_size) const;
+
+    // 像素坐标点是否在区域内
+    bool contains(const cv::Point2f& point, const cv::Size& frame_size) const;
+
+    // 解析 roi 数组，格式错误的项打印警告后忽略
+    static std::vector<DetectionRegion> parseList(const json& list);
+};
+
+#endif // DETECTION_REGION_H
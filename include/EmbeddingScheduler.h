@@ -0,0 +1,66 @@
+#ifndef EMBEDDING_SCHEDULER_H
+#define EMBEDDING_SCHEDULER_H
+
+#include <dlib/matrix.h>
+#include <dlib/pixel.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class InferenceContextPool;
+
+// 跨视频流的动态批处理：所有调用方（多路摄像头、同一帧内的多张人脸）提交的人脸芯片进入同一个队列，
+// 工作线程在凑满 max_batch_size 或最早的请求等待超过 max_delay 时，取出一批做一次批量前向，
+// 结果通过 future 返回给各自的调用方。
+//
+// 批越大吞吐越高，但单张人脸的延迟也越高；两个参数都可以在 config.json 的 inference.batching 中调整。
+// 批大小、排队时间和批量前向耗时会记入 PerformanceMonitor。
+class EmbeddingScheduler {
+public:
+    using Chip = dlib::matrix<dlib::rgb_pixel>;
+    using Descriptor = dlib::matrix<float, 0, 1>;
+
+    struct Options {
+        size_t max_batch_size = 8;
+        std::chrono::microseconds max_delay{5000};
+        size_t workers = 1;  // 工作线程数，每个线程从推理池借一个上下文
+    };
+
+    EmbeddingScheduler(InferenceContextPool& pool, const Options& options);
+    ~EmbeddingScheduler();
+
+    EmbeddingScheduler(const EmbeddingScheduler&) = delete;
+    EmbeddingScheduler& operator=(const EmbeddingScheduler&) = delete;
+
+    // 提交一张人脸芯片，返回其特征的 future
+    std::future<Descriptor> submit(Chip chip);
+
+    const Options& options() const { return options_; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Request {
+        Chip chip;
+        std::promise<Descriptor> promise;
+        Clock::time_point enqueued;
+    };
+
+    void workerLoop();
+
+    InferenceContextPool& pool_;
+    Options options_;
+
+    std::mutex mutex_;
+    std::condition_variable queue_changed_;
+    std::deque<Request> queue_;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+#endif // EMBEDDING_SCHEDULER_H
@@ -0,0 +1,130 @@
+#ifndef ENROLLMENT_SERVICE_H
+#define ENROLLMENT_SERVICE_H
+
+#include "FaceDetector.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ConfigParser;
+class FaceRecognition;
+
+// 在线登记选项，对应 config.json 中的 enrollment.*
+struct EnrollmentOptions {
+    bool enabled = false;
+    std::string path = "/enroll";       // 推流端口上的登记路径
+    size_t max_body_bytes = 8u << 20;   // 请求体上限（图片）
+    size_t max_pending = 64;            // 排队中的请求上限，超过时返回 503
+    double compact_ratio = 0.2;         // 墓碑占人脸库的比例超过它时在后台压缩
+    DetectionOptions detection;         // 登记图片上的人脸检测，与实时流水线相同
+
+    static EnrollmentOptions fromConfig(const ConfigParser& config);
+};
+
+// 在线登记：不重启、不重建人脸库即可加入、替换或删除人员。
+// 请求只在调用线程上解析并排队（推流的监听线程不被阻塞），后台线程逐个完成
+// 解码 -> 检测（必须恰好一张人脸）-> 对齐 -> 特征提取，再写入正在使用的人脸库；
+// 写入时只短暂独占人脸库，识别照常进行。删除和替换先留下墓碑，墓碑比例超过 compact_ratio 时
+// 后台线程在人脸库副本上压缩后替换。登记结果只在内存中，需要持久化时另行写入 facelib 目录或 CSV。
+//
+// HTTP 接口（path 默认 /enroll，name 需做 URL 编码）：
+//   POST   /enroll?name=张三     请求体为 JPEG / PNG 图片，加入一张参考
+//   POST   /enroll               Content-Type: application/json，{"name": "...", "descriptor": [...]}
+//   PUT    /enroll?name=张三     同 POST，但替换此人已有的全部参考
+//   DELETE /enroll?name=张三     删除此人
+//   GET    /enroll?job=N         查询请求 N 的处理结果
+// 写操作返回 202 和 {"job": N}，之后用 GET 查询 {"job": N, "state": "queued|done|failed", "message": "..."}
+class EnrollmentService {
+public:
+    enum class JobState { Queued, Done, Failed };
+
+    struct JobStatus {
+        JobState state = JobState::Failed;
+        std::string message;
+    };
+
+    // HTTP 回复：状态码和 JSON 正文
+    struct Reply {
+        int status = 200;
+        std::string body;
+
+        const char* reason() const;  // 状态码对应的 HTTP 原因短语
+    };
+
+    // 解析后的 HTTP 请求
+    struct Request {
+        enum class Kind { Status, Image, Descriptor, Remove };
+        Kind kind = Kind::Status;
+        std::string name;
+        std::string image;               // 编码后的图片
+        std::vector<float> descriptor;
+        bool replace = false;            // PUT：替换此人已有的全部参考
+        size_t job = 0;                  // Status：要查询的请求编号
+    };
+
+    // 解析并校验一个 HTTP 请求（target 含查询串）。请求不合法时返回 false，failure 为要回复的错误；
+    // 不会因为客户端发来的内容抛出异常
+    static bool parseRequest(const EnrollmentOptions& options, const std::string& method, const std::string& target,
+                             const std::string& content_type, const std::string& body, Request& request,
+                             Reply& failure);
+
+    EnrollmentService(FaceRecognition& recognizer, const EnrollmentOptions& options);
+    ~EnrollmentService();
+
+    EnrollmentService(const EnrollmentService&) = delete;
+    EnrollmentService& operator=(const EnrollmentService&) = delete;
+
+    // 处理一个 HTTP 请求（target 含查询串），只做解析和排队；任何异常都转成错误回复
+    Reply handle(const std::string& method, const std::string& target, const std::string& content_type,
+                 const std::string& body);
+
+    // 排队一个请求，返回请求编号；队列已满时返回 0
+    size_t submitImage(const std::string& name, std::string image, bool replace);
+    size_t submitDescriptor(const std::string& name, std::vector<float> descriptor, bool replace);
+    size_t submitRemove(const std::string& name);
+
+    // 请求的处理结果；未知或太早的编号为 Failed
+    JobStatus status(size_t job) const;
+
+    // 等待队列中的请求全部处理完
+    void waitIdle();
+
+    const EnrollmentOptions& options() const { return options_; }
+
+private:
+    using Kind = Request::Kind;
+
+    struct Job : Request {
+        size_t id = 0;
+    };
+
+    size_t enqueue(Job job);
+    void workerLoop();
+
+    // 执行一个请求，返回给调用方看的结果说明；失败时抛出异常
+    std::string run(const Job& job);
+    void finish(size_t id, JobState state, const std::string& message);
+    void compactIfNeeded();
+
+    FaceRecognition& recognizer_;
+    EnrollmentOptions options_;
+    std::unique_ptr<FaceDetector> detector_;  // 只在后台线程上使用
+
+    mutable std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<Job> queue_;
+    bool busy_ = false;
+    bool stopping_ = false;
+    size_t next_id_ = 1;
+    std::unordered_map<size_t, JobStatus> statuses_;  // 最近 kKeptStatuses 个请求的结果
+    std::deque<size_t> status_order_;
+    std::thread worker_;
+};
+
+#endif // ENROLLMENT_SERVICE_H
@@ -0,0 +1,53 @@
+#ifndef FACE_CHIP_BATCH_H
+#define FACE_CHIP_BATCH_H
+
+#include <opencv2/opencv.hpp>
+#include <dlib/dnn.h>
+#include <dlib/image_transforms.h>
+#include <vector>
+
+// 直接在识别网络输入张量中构建的一批人脸芯片。
+// dlib 的做法是 extract_image_chip 逐像素经通用插值得到 150x150 的 matrix<rgb_pixel>，
+// 再由输入层 to_tensor 拷贝、减均值、转成平面布局。这里直接从 BGR 帧双线性采样，
+// 减均值后写入张量的 R/G/B 平面，省掉中间芯片和 to_tensor 那次拷贝。
+// 采样仍是逐像素的标量代码（源坐标随仿射变换变化，读取是 gather，编译器不会向量化）；
+// 每行先求出整段都在图像内的列区间，区间内不做边界判断，只有两端的像素逐点判断。
+// 结果与 extract_image_chip + to_tensor 在舍入误差内一致（源区域远大于芯片时同样先做抗混叠缩小）。
+class FaceChipBatch {
+public:
+    static constexpr long kChipSize = 150;
+
+    // 网络输入层的各通道均值（input_rgb_image_sized::get_avg_red 等）
+    struct Means {
+        float red = 0.f;
+        float green = 0.f;
+        float blue = 0.f;
+    };
+
+    explicit FaceChipBatch(const Means& means) : means_(means) {}
+
+    // 为 count 个芯片分配张量（内容未初始化）
+    void reset(size_t count);
+
+    // 从 BGR 帧中按 details 对齐采样，写入第 index 个样本
+    void write(size_t index, const cv::Mat& bgr, const dlib::chip_details& details);
+
+    // 第 index 个样本的清晰度（灰度拉普拉斯方差，与 FaceQuality 的定义一致）
+    double sharpness(size_t index) const;
+
+    // 只保留 indices 中的样本（按给定顺序）；全部保留时不做任何拷贝
+    void keep(const std::vector<size_t>& indices);
+
+    size_t size() const { return static_cast<size_t>(tensor_.num_samples()); }
+    const dlib::resizable_tensor& tensor() const { return tensor_; }
+
+    // 把第 index 个样本还原成芯片图像（调试和测试用）
+    dlib::matrix<dlib::rgb_pixel> chip(size_t index) const;
+
+private:
+    Means means_;
+    dlib::resizable_tensor tensor_;
+    cv::Mat shrunk_;  // 抗混叠缩小用的缓冲区，跨帧复用
+};
+
+#endif // FACE_CHIP_BATCH_H
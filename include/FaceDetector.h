@@ -0,0 +1,47 @@
+#ifndef FACE_DETECTOR_H
+#define FACE_DETECTOR_H
+
+#include "ConfigParser.h"
+
+#include <opencv2/opencv.hpp>
+#include <dlib/geometry/rectangle.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 人脸检测参数，对应 config.json 中的 detection.*
+struct DetectionOptions {
+    std::string backend = "hog";  // hog | mmod | opencv_dnn
+    double scale = 1.0;           // 检测分辨率相对原图的比例，0.5 表示在一半分辨率上检测
+    double adjust_threshold = 0.0; // HOG / MMOD 检测阈值偏移，越大越严格
+    size_t threads = 1;           // HOG 扫描金字塔的线程数，1 为单线程，0 表示按 CPU 核数
+
+    std::string mmod_model;       // mmod_human_face_detector.dat
+    std::string dnn_model;        // res10_300x300_ssd_iter_140000.caffemodel
+    std::string dnn_config;       // deploy.prototxt
+    double dnn_confidence = 0.5;  // SSD 置信度阈值
+    int dnn_input_size = 300;     // SSD 输入边长
+
+    static DetectionOptions fromConfig(const ConfigParser& config);
+};
+
+// 人脸检测后端接口。FaceRecognition 建库、FramePipeline 和各工具都通过它检测人脸。
+//   hog        dlib HOG（共享灰度金字塔，可多线程），最快，侧脸和小脸召回一般
+//   mmod       dlib MMOD CNN，召回最好，CPU 上最慢，可用 detection.scale 降分辨率提速
+//   opencv_dnn OpenCV DNN + ResNet-10 SSD，固定输入尺寸，耗时与分辨率基本无关
+// 实例不是线程安全的，每个线程应持有自己的检测器。
+class FaceDetector {
+public:
+    virtual ~FaceDetector() = default;
+
+    // 在 BGR 图像上检测人脸，返回输入图像坐标下的人脸框
+    virtual std::vector<dlib::rectangle> detect(const cv::Mat& bgr) = 0;
+
+    // 后端名称，与 detection.backend 取值相同
+    virtual std::string name() const = 0;
+};
+
+// 按配置创建检测器。后端名称未知或模型加载失败时抛出 std::runtime_error
+std::unique_ptr<FaceDetector> createFaceDetector(const DetectionOptions& options);
+
+#endif // FACE_DETECTOR_H
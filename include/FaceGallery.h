@@ -0,0 +1,206 @@
+#ifndef FACE_GALLERY_H
+#define FACE_GALLERY_H
+
+#include "ConfigParser.h"
+
+#include <dlib/matrix.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 人脸库检索参数，对应 config.json 中的 gallery.*
+struct GalleryOptions {
+    std::string storage = "float";  // float | int8 | fp16，扫描时使用的特征存储格式
+    int rerank = 0;                 // 量化存储时取近似距离最小的若干候选，用原始浮点特征重新计算距离。
+                                    // 大于 0 时要在量化数据之外再保留一份完整的浮点副本，内存反而比 float 存储多；
+                                    // 默认 0：不精排、不保留副本（内存最省，距离为近似值）
+    int pca_dims = 0;               // 两阶段检索：PCA 降到多少维做粗筛，0 表示关闭
+    int pca_candidates = 100;       // 粗筛保留的候选数，只对这些候选计算完整维度的距离
+    bool identity_prefilter = true; // 每人有多张参考特征时，先用各身份的质心和半径剪枝
+
+    static GalleryOptions fromConfig(const ConfigParser& config);
+};
+
+// 人脸库：每个身份（姓名）可以有多张参考特征，所有特征连续存储以便顺序扫描。
+//   float  每维 4 字节，距离精确
+//   int8   每个向量一个缩放系数，每维 1 字节；查询也量化成 int8，用整数点积估计距离
+//   fp16   每维 2 字节半精度，扫描时转回 float 计算
+// 百万级人脸库时扫描受内存带宽限制，量化把扫描的数据量降到 1/4 或 1/2；
+// 开启精排时最近邻及其距离与 float 存储一致（只要真正的最近邻落在候选之内）。
+// 一次匹配多个查询（同一帧 / 同一批的人脸）时，float 存储用预先算好的模长把
+// |q - g|^2 展开成 |q|^2 + |g|^2 - 2 q·g，全部点积由一次矩阵乘法（dlib 的 BLAS 绑定）完成。
+// 开启 PCA 粗筛时先在低维投影上扫描全部条目（投影距离是真实距离的下界），只对最近的若干候选
+// 计算完整距离；召回取决于 pca_dims 和 pca_candidates，用 gallery_bench 在实际规模上评估。
+// 身份剪枝：每个身份记录成员特征的质心和半径（成员到质心的最大距离），检索时按
+// |q - 质心| - 半径 这个下界从小到大展开身份，下界超过当前最优距离即停止，结果与全量扫描相同。
+// 关注名单：每个身份可以属于若干名单（最多 63 个，每个名单占标签掩码的一位），检索时传入名单掩码，
+// 扫描循环在计算距离的同一处跳过标签不相交的条目，一份人脸库即可服务关注不同人群的各路摄像头。
+// 不属于任何名单的身份只在不限名单（kAllWatchlists）的检索中出现。
+// 删除：remove 只把条目标成墓碑（标签清零，检索时与名单过滤一起跳过），compact 再真正移除。
+// 检索函数可被多个线程同时调用；add / remove / compact 等修改需要调用方与检索互斥。
+class FaceGallery {
+public:
+    enum class Storage { Float, Int8, Half };
+
+    struct Hit {
+        size_t index = 0;       // 最近的参考特征（条目）
+        double distance = 0.0;  // 欧氏距离
+    };
+
+    // 不限名单：检索全部条目
+    static constexpr uint64_t kAllWatchlists = ~0ull;
+
+    explicit FaceGallery(const GalleryOptions& options = {});
+
+    // 为身份 name 加入一张参考特征（同名多次加入即多张参考）。
+    // 所有特征的维数必须相同，否则抛出 std::invalid_argument
+    void add(const std::string& name, const dlib::matrix<float,0,1>& descriptor);
+
+    // 与查询特征最近的条目，只考虑属于 watchlists 中任一名单的条目；
+    // 人脸库为空或没有符合的条目时 distance 为无穷大
+    Hit nearest(const dlib::matrix<float,0,1>& query, uint64_t watchlists = kAllWatchlists) const;
+
+    // 一批查询各自的最近条目（距离为精确值）。float 存储走矩阵乘法（每人多张参考、开启身份剪枝时也一样，
+    // 对所有条目计算），按展开式取几个候选后精确重算，只有展开式的舍入误差大到把真正的最近条目挤出候选时
+    // 才会与 nearest 不同；量化存储和建了 PCA 索引时没有对应的 GEMM，逐个检索
+    std::vector<Hit> nearestBatch(const std::vector<dlib::matrix<float,0,1>>& queries,
+                                  uint64_t watchlists = kAllWatchlists) const;
+
+    // 距离最小的至多 k 个条目，按距离从小到大排列（没有符合的条目时为空）。
+    // k 为 1 时与 nearest 相同；否则在 PCA 粗筛或存储格式的近似距离上取候选，再计算距离
+    std::vector<Hit> search(const dlib::matrix<float,0,1>& query, size_t k,
+                            uint64_t watchlists = kAllWatchlists) const;
+
+    // 从 CSV 加入参考特征：每行 "姓名,v1 v2 ..."，维数不一致的行跳过；返回加入的条目数，文件不存在时为 0
+    size_t loadCsv(const std::string& path);
+
+    // 名单对应的掩码位，名单第一次出现时分配；超过 63 个名单时抛出 std::runtime_error
+    uint64_t watchlistBit(const std::string& watchlist);
+
+    // 一组名单的掩码；为空时为 kAllWatchlists，有未定义的名单时抛出 std::runtime_error
+    uint64_t watchlistMask(const std::vector<std::string>& watchlists) const;
+
+    // 把身份 name 加入名单（之后加入的参考特征同样带上标签）；没有这个身份时返回 false
+    bool addToWatchlist(const std::string& name, const std::string& watchlist);
+    size_t watchlistCount() const { return watchlists_.size(); }
+
+    // 掩码中各位对应的名单名（kAllWatchlists 时为空，即不限名单）
+    std::vector<std::string> watchlistNames(uint64_t watchlists) const;
+
+    // 按 gallery.watchlists 定义名单并给身份打上标签：名单名 -> 姓名数组，或每行一个姓名的文本文件路径。
+    // 名单中有库里没有的人时给出警告；文件打不开时抛出 std::runtime_error
+    void loadWatchlists(const json& watchlists);
+
+    // 把身份 name 的全部参考特征标成墓碑，之后的检索不再返回它们；返回标记的条目数。
+    // 身份本身（含名单关系）保留，再次 add 同名特征即恢复；compact 时才移除没有参考特征的身份
+    size_t remove(const std::string& name);
+
+    // 移除墓碑条目和没有参考特征的身份，条目下标随之改变；身份剪枝和 PCA 索引同步压缩（投影矩阵不变）
+    void compact();
+    size_t tombstoneCount() const { return tombstones_; }
+
+    // 第 index 个条目所属身份的姓名
+    const std::string& name(size_t index) const { return identities_[entry_identity_[index]]; }
+    size_t size() const { return entry_identity_.size(); }  // 含墓碑
+    bool empty() const { return entry_identity_.size() == tombstones_; }
+
+    // 身份数，以及第 identity 个身份的姓名和参考特征数
+    size_t identityCount() const { return identities_.size(); }
+    const std::string& identityName(size_t identity) const { return identities_[identity]; }
+    size_t referenceCount(size_t identity) const { return members_[identity].size(); }
+    long dimensions() const { return dim_; }
+    Storage storage() const { return storage_; }
+    size_t rerank() const { return rerank_; }
+
+    // 计算各身份的质心和半径，并学习 PCA 投影、投影全部条目（pca_dims 为 0 时不做 PCA）。
+    // 在加入全部条目之后调用；之后再加入的条目增量更新，不必重建
+    void buildIndex();
+    bool hasIndex() const { return projected_dims_ > 0 && projected_.size() == size() * projected_dims_; }
+
+    // 把 PCA 均值、投影轴和投影后的矩阵保存到文件 / 从文件加载（加载成功时同时计算身份质心）。
+    // 文件与当前人脸库（条目、顺序、pca_dims）不一致或读取失败时 loadIndex 返回 false
+    bool saveIndex(const std::string& path) const;
+    bool loadIndex(const std::string& path);
+
+    // 检索用数据占用的内存（字节），不含哈希索引
+    size_t memoryBytes() const;
+    // 其中量化存储为精排保留的浮点副本占用的字节数（float 存储或不精排时为 0）
+    size_t rerankCopyBytes() const;
+
+    static Storage parseStorage(const std::string& name);
+
+private:
+    void store(size_t index, const float* values);
+
+    // 第 index 个条目的特征（有浮点副本时为原值，否则反量化）
+    void decode(size_t index, float* out) const;
+
+    // 减去均值后投影到 PCA 轴上，输出 projected_dims_ 维
+    void project(const float* values, float* out) const;
+
+    // 人脸库内容的哈希，用来判断保存的索引是否仍然有效
+    uint64_t fingerprint() const;
+
+    void buildIdentityIndex();
+    void buildPcaIndex();
+
+    // 重新计算一个身份的质心和半径
+    void updateIdentity(size_t identity);
+
+    // 检索精排用的距离平方：有原始特征时精确，否则按存储格式近似
+    float entryDistance(size_t index, const float* query, const int8_t* query_codes, float query_scale,
+                        float query_sq_norm) const;
+
+    Hit nearestWithIndex(const float* query, const int8_t* query_codes, float query_scale,
+                         float query_sq_norm, uint64_t required) const;
+    Hit nearestByIdentity(const float* query, const int8_t* query_codes, float query_scale,
+                          float query_sq_norm, uint64_t required) const;
+
+    // 标签的最高位表示条目有效：不限名单时只要求这一位，墓碑条目的标签为 0，任何检索都跳过
+    static constexpr uint64_t kLiveBit = 1ull << 63;
+
+    // 检索时条目标签必须与之相交的掩码
+    static uint64_t requiredTags(uint64_t watchlists) {
+        return watchlists == kAllWatchlists ? kLiveBit : watchlists & ~kLiveBit;
+    }
+
+    // 条目是否参与检索，required 为 requiredTags 的结果；与距离计算放在同一个循环里
+    bool visible(size_t index, uint64_t required) const { return (entry_tags_[index] & required) != 0; }
+
+    // 近似距离的平方：按存储格式扫描第 index 个条目
+    float approxSquaredDistance(size_t index, const float* query, const int8_t* query_codes,
+                                float query_scale, float query_sq_norm) const;
+
+    Storage storage_;
+    size_t rerank_;
+    size_t pca_dims_;
+    size_t pca_candidates_;
+    bool identity_prefilter_;
+    long dim_ = 0;
+    std::vector<std::string> identities_;                  // 身份的姓名
+    std::unordered_map<std::string, size_t> identity_of_;  // 姓名 -> 身份下标
+    std::vector<uint32_t> entry_identity_;                 // 每个条目所属的身份
+    std::vector<std::vector<size_t>> members_;             // 每个身份的有效条目下标（不含墓碑）
+    std::vector<uint64_t> identity_tags_;                  // 每个身份所属名单的掩码 | kLiveBit
+    std::vector<uint64_t> entry_tags_;                     // 每个条目的标签（与所属身份相同，墓碑为 0，扫描时顺序读取）
+    size_t tombstones_ = 0;
+    std::unordered_map<std::string, int> watchlists_;      // 名单名 -> 掩码位
+
+    std::vector<float> floats_;     // float 存储，或量化存储时精排用的原始特征（rerank 为 0 时为空）
+    std::vector<int8_t> codes_;     // int8 存储
+    std::vector<float> scales_;     // int8 每个向量的缩放系数
+    std::vector<float> sq_norms_;   // 每个向量原始特征的模长平方（int8 距离估计和批量检索使用）
+    std::vector<uint16_t> halves_;  // fp16 存储
+
+    size_t projected_dims_ = 0;     // PCA 索引的实际维数，0 表示没有索引
+    std::vector<float> pca_mean_;   // dim_
+    std::vector<float> pca_basis_;  // projected_dims_ x dim_，每行一个主成分
+    std::vector<float> projected_;  // size() x projected_dims_
+
+    bool identity_index_ = false;   // 是否按身份剪枝（buildIndex 时决定）
+    std::vector<float> centroids_;  // identityCount() x dim_
+    std::vector<float> radii_;      // 每个身份成员到质心的最大距离
+};
+
+#endif // FACE_GALLERY_H
@@ -0,0 +1,47 @@
+#ifndef FACE_QUALITY_H
+#define FACE_QUALITY_H
+
+#include "ConfigParser.h"
+
+#include <dlib/image_processing.h>
+#include <dlib/matrix.h>
+#include <dlib/pixel.h>
+#include <vector>
+
+// 人脸质量门控参数，对应 config.json 中的 quality.*
+struct QualityOptions {
+    bool enabled = false;
+    int min_face_size = 60;       // 人脸框短边的最小像素数，更小的脸连形状预测都不做
+    double min_eye_distance = 20; // 两眼中心的最小像素距离（5 点关键点）
+    double max_yaw = 0.35;        // 鼻尖偏离两眼中垂线的距离 / 眼距，超过视为侧脸过大
+    double min_sharpness = 40.0;  // 芯片灰度图拉普拉斯方差，低于该值视为模糊
+    int track_max_missed = 5;     // 轨迹连续多少帧未检测到后丢弃（识别结果沿轨迹沿用）
+
+    static QualityOptions fromConfig(const ConfigParser& config);
+};
+
+// 一张人脸的质量评估结果
+struct QualityScore {
+    double eye_distance = 0.0;
+    double yaw = 0.0;
+    double sharpness = 0.0;
+    bool passed = true;
+    const char* reason = "";  // 未通过的原因：size | eyes | yaw | blur
+};
+
+// 人脸框是否大到值得继续处理（形状预测之前的快速筛选）
+bool faceLargeEnough(const dlib::rectangle& face, const QualityOptions& options);
+
+// 灰度图（行优先）的拉普拉斯方差，作为清晰度：对焦清晰的人脸边缘多，方差大
+double grayLaplacianVariance(const std::vector<float>& gray, long rows, long cols);
+
+// 用 5 点关键点几何和已算好的芯片清晰度评估人脸质量（形状预测和芯片提取之后、特征提取之前）
+QualityScore assessFaceQuality(const dlib::full_object_detection& shape, double sharpness,
+                               const QualityOptions& options);
+
+// 同上，清晰度从芯片图像计算
+QualityScore assessFaceQuality(const dlib::full_object_detection& shape,
+                               const dlib::matrix<dlib::rgb_pixel>& chip,
+                               const QualityOptions& options);
+
+#endif // FACE_QUALITY_H
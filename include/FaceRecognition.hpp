@@ -2,13 +2,21 @@
 #define FACE_RECOGNITION_HPP
 
 #include <dlib/dnn.h>
-#include <dlib/image_processing/frontal_face_detector.h>
 #include <dlib/image_processing.h>
+#include "FaceChipBatch.h"
+#include "FaceGallery.h"
+#include <memory>
+#include <shared_mutex>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 // 前向声明
 class ConfigParser;
+struct DetectionOptions;
+class InferenceContextPool;
+class ShardedGallery;
+class EmbeddingScheduler;
+class StrangerClusters;
 
 // 使用 dlib 的标准人脸识别网络定义
 // 这是 dlib 官方推荐的人脸识别网络结构
@@ -45,16 +53,87 @@ class FaceRecognition
 {
 public:
     explicit FaceRecognition(const ConfigParser& config);
+    ~FaceRecognition();
     
-    // 识别人脸
-    std::string recognize(const dlib::matrix<dlib::rgb_pixel>& face_chip);
+    // 识别人脸（线程安全，最多 inference.contexts 个线程同时提取特征）。
+    // 以下识别和匹配接口的 watchlists 是关注名单掩码（见 watchlistMask），只在这些名单的人中匹配。
+    // 开启 strangers.enabled 时，不限名单的识别把未匹配的人脸聚类，返回 "Stranger-N" 匿名标签
+    std::string recognize(const dlib::matrix<dlib::rgb_pixel>& face_chip,
+                          uint64_t watchlists = FaceGallery::kAllWatchlists);
+
+    // 识别一组人脸（例如同一帧中的所有人脸），尽量并行或合批提取特征
+    std::vector<std::string> recognizeAll(const std::vector<dlib::matrix<dlib::rgb_pixel>>& face_chips,
+                                          uint64_t watchlists = FaceGallery::kAllWatchlists);
+
+    // 识别已直接写入网络输入张量的一批人脸（FaceChipBatch），一次批量前向
+    std::vector<std::string> recognizeBatch(const FaceChipBatch& batch,
+                                            uint64_t watchlists = FaceGallery::kAllWatchlists);
+
+    // 是否可以使用 recognizeBatch：跨流合批开启时人脸要交给 EmbeddingScheduler，只能走芯片路径
+    bool acceptsChipBatches() const { return !scheduler_; }
+
+    // 网络输入层的各通道均值，用于在张量中直接构建芯片
+    FaceChipBatch::Means inputMeans() const;
+
+    // 提取 128 维人脸特征（线程安全；开启批处理时经由 EmbeddingScheduler 合批）
+    dlib::matrix<float,0,1> computeDescriptor(const dlib::matrix<dlib::rgb_pixel>& face_chip);
+
+    // 在人脸库中查找与特征最接近的人，超过阈值返回 "Stranger"
+    std::string matchDescriptor(const dlib::matrix<float,0,1>& descriptor,
+                                uint64_t watchlists = FaceGallery::kAllWatchlists) const;
+
+    // 一次匹配一组特征（一次矩阵乘法完成全部距离计算），结果与逐个 matchDescriptor 相同
+    std::vector<std::string> matchDescriptors(const std::vector<dlib::matrix<float,0,1>>& descriptors,
+                                              uint64_t watchlists = FaceGallery::kAllWatchlists) const;
+
+    // 人脸库检索结果：最近的人及其欧氏距离（不做阈值判断）
+    struct MatchResult
+    {
+        std::string name;
+        double distance;
+    };
+    MatchResult findBestMatch(const dlib::matrix<float,0,1>& descriptor,
+                              uint64_t watchlists = FaceGallery::kAllWatchlists) const;
+
+    // gallery.watchlists 中定义的名单组成的掩码；为空时不限名单，名单未定义时抛出 std::runtime_error
+    uint64_t watchlistMask(const std::vector<std::string>& watchlists) const;
+
+    // 匹配阈值
+    double matchThreshold() const { return face_match_threshold_; }
+
+    // 推理上下文数量，即可以同时提取特征的线程数
+    size_t inferenceContexts() const;
     
-    // 获取形状预测器
-    dlib::shape_predictor getShapePredictor() const;
+    // 获取形状预测器（其 operator() 为 const，可被多个线程同时使用）
+    const dlib::shape_predictor& getShapePredictor() const;
     
     // 打印人脸库信息
     void printFaceLibInfo() const;
 
+    // 人脸库占用的内存（字节）
+    size_t libraryMemoryBytes() const;
+
+    // 陌生人聚类（strangers.enabled 关闭时为 nullptr），用于统计去重后的陌生访客数
+    const StrangerClusters* strangers() const { return strangers_.get(); }
+
+    // 在线修改人脸库（线程安全，与识别并发）：只在写入的一瞬间独占人脸库，身份剪枝和 PCA 索引增量更新。
+    // 加入一张参考特征，维数不一致时抛出 std::invalid_argument；分片协调模式下抛出 std::runtime_error
+    void enrollDescriptor(const std::string& name, const dlib::matrix<float,0,1>& descriptor);
+
+    // 用新的参考特征替换此人已有的全部参考（旧特征成为墓碑）
+    void replacePerson(const std::string& name, const dlib::matrix<float,0,1>& descriptor);
+
+    // 删除此人的全部参考特征（墓碑），返回删除的条数
+    size_t removePerson(const std::string& name);
+
+    // 墓碑条目数，以及人脸库总条目数（含墓碑）
+    size_t libraryTombstones() const;
+    size_t librarySize() const;
+
+    // 压缩人脸库：在副本上移除墓碑，完成后替换；压缩期间识别照常进行。
+    // 与 enrollDescriptor / replacePerson / removePerson 由同一个线程串行调用（例如 EnrollmentService 的后台线程）
+    void compactLibrary();
+
 private:
     // 加载模型
     void loadModels(const ConfigParser& config);
@@ -62,16 +141,51 @@ private:
     // 从CSV加载人脸库
     void loadLibraryFromCSV(const std::string& csv_path);
     
-    // 从目录构建人脸库
-    void buildFaceLibrary(const std::string& dir_path);
+    // 人脸库中的一张参考图片（已解码并检测到唯一人脸）
+    struct LibraryImage
+    {
+        std::string name;
+        dlib::matrix<dlib::rgb_pixel> img;
+        dlib::rectangle face;
+    };
+
+    // 从目录读取参考图片并检测人脸（不依赖识别模型，可与模型加载并行）。
+    // 每个子目录是一个人，其中每张只含一张人脸的图片都是一张参考，每人最多 max_references 张（0 不限）
+    std::vector<LibraryImage> prepareLibraryImages(const std::string& dir_path, const DetectionOptions& detection,
+                                                   size_t max_references) const;
+
+    // 用已加载的模型为参考图片提取特征，构建人脸库
+    void buildFaceLibrary(const std::vector<LibraryImage>& images);
+
+    // 建立人脸库的检索索引（身份质心；gallery.pca_dims > 0 时还有 PCA 粗筛）；
+    // index_path 非空时保存 / 复用 PCA 索引文件
+    void buildLibraryIndex(const std::string& index_path);
 
 private:
-    anet_type net_;                           // 人脸识别网络
+    anet_type net_;                           // 人脸识别网络（建库用，之后作为推理池的第一个上下文）
+    std::unique_ptr<InferenceContextPool> pool_; // 推理上下文池
+    std::unique_ptr<EmbeddingScheduler> scheduler_; // 跨流批处理（未开启时为空）
     dlib::shape_predictor sp_;                // 形状预测器
     double face_match_threshold_;             // 人脸匹配阈值
     
-    // 人脸库：姓名 -> 特征向量
-    std::unordered_map<std::string, dlib::matrix<float,0,1>> face_library_;
+    // 人脸库：姓名 -> 一张或多张参考特征（存储格式见 gallery.*）
+    FaceGallery face_library_;
+
+    // 分片协调模式（gallery.shards 非空）：人脸库在各分片进程中，本地 face_library_ 为空，只用来记录名单
+    std::unique_ptr<ShardedGallery> shards_;
+
+    // 保护 face_library_：识别时共享，在线登记 / 删除 / 压缩替换时独占
+    mutable std::shared_mutex library_mutex_;
+
+    // 陌生人聚类（未开启时为空）
+    std::unique_ptr<StrangerClusters> strangers_;
+
+    // 本地人脸库非空，或者连接了分片
+    bool hasLibrary() const;
+
+    // 识别结果中的 "Stranger" 换成聚类得到的匿名标签；只用于不限名单的识别（名单外的熟人不算陌生人）
+    void labelStrangers(const std::vector<dlib::matrix<float,0,1>>& descriptors, std::vector<std::string>& names,
+                        uint64_t watchlists);
 };
 
 #endif // FACE_RECOGNITION_HPP
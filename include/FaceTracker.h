@@ -0,0 +1,38 @@
+#ifndef FACE_TRACKER_H
+#define FACE_TRACKER_H
+
+#include <dlib/geometry/rectangle.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// 基于 IoU 的简单人脸跟踪：把相邻两次检测的人脸框贪心关联成轨迹。
+// 运动门控用它判断“画面里还有人”，流水线用它把识别结果沿轨迹传递。
+// 不是线程安全的，每路视频源 / 每条流水线各持有一个。
+class FaceTracker {
+public:
+    struct Track {
+        uint64_t id = 0;
+        dlib::rectangle rect;
+        int missed = 0;          // 连续未被关联的检测次数
+        std::string label;       // 轨迹上最近一次可靠的识别结果，空表示尚未识别
+    };
+
+    explicit FaceTracker(int max_missed = 5, double min_iou = 0.3);
+
+    // 关联本次检测的人脸框，返回每个框对应的轨迹下标（在下一次 update 之前有效）。
+    // 未关联上的框开启新轨迹；连续 max_missed 次未关联的轨迹被删除。
+    std::vector<size_t> update(const std::vector<dlib::rectangle>& boxes);
+
+    Track& track(size_t index) { return tracks_[index]; }
+    bool empty() const { return tracks_.empty(); }
+    size_t size() const { return tracks_.size(); }
+
+private:
+    int max_missed_;
+    double min_iou_;
+    uint64_t next_id_ = 1;
+    std::vector<Track> tracks_;
+};
+
+#endif // FACE_TRACKER_H
@@ -0,0 +1,80 @@
+#ifndef FRAME_PIPELINE_H
+#define FRAME_PIPELINE_H
+
+#include "DetectionRegion.h"
+#include "FaceChipBatch.h"
+#include "FaceDetector.h"
+#include "FaceGallery.h"
+#include "FaceQuality.h"
+#include "FaceTracker.h"
+
+#include <opencv2/opencv.hpp>
+#include <dlib/image_processing.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FaceRecognition;
+
+// 单个人脸的处理结果
+struct FaceResult {
+    dlib::rectangle rect;   // 人脸框（帧坐标）
+    std::string name;       // 识别结果，未匹配时为 "Stranger"（开启陌生人聚类时为 "Stranger-N"），
+                            // 质量不足且轨迹上尚无结果时为 "Unknown"
+};
+
+// 流水线参数：检测和质量门控，对应 config.json 中的 detection.* 和 quality.*
+struct PipelineOptions {
+    DetectionOptions detection;
+    QualityOptions quality;
+    // 送进同一条流水线的帧是否按时间顺序连续。多个离线工作线程分帧处理时不是，
+    // 这时不做轨迹跟踪（相隔很远的帧之间按 IoU 关联会把结果传给别人），未通过门控的人脸标为 "Unknown"
+    bool sequential_frames = true;
+
+    static PipelineOptions fromConfig(const ConfigParser& config);
+};
+
+// 单帧处理流水线：人脸检测 -> 形状预测 -> 芯片提取 -> 质量门控 -> 识别 -> 绘制 -> 编码。
+// 未开启跨流合批时，芯片提取直接写入识别网络的输入张量（FaceChipBatch），整帧人脸一次前向。
+// web_capture 和录像回放共用这一套流程，保证性能数据可比。
+// 开启质量门控时，过小、侧脸过大或模糊的人脸不做特征提取，
+// 而是沿用同一轨迹上一次可靠的识别结果（没有时标为 "Unknown"），等更好的帧再识别。
+// 每个线程应持有自己的 FramePipeline（检测器和轨迹有内部状态）。
+class FramePipeline {
+public:
+    explicit FramePipeline(FaceRecognition& recognizer, const PipelineOptions& options = PipelineOptions());
+
+    // 检测并识别帧中的人脸，并把结果绘制到 frame 上
+    std::vector<FaceResult> process(cv::Mat& frame);
+
+    // 只检测和识别，不修改帧（离线处理、批量工具使用）
+    std::vector<FaceResult> analyze(const cv::Mat& frame);
+
+    // 只在这些区域内检测人脸；为空（默认）时检测整帧
+    void setRegions(std::vector<DetectionRegion> regions) { regions_ = std::move(regions); }
+
+    // 只在这些关注名单中匹配（FaceRecognition::watchlistMask 的结果）；默认匹配全库
+    void setWatchlists(uint64_t watchlists) { watchlists_ = watchlists; }
+
+    // 把帧编码为 JPEG，供推流或保存
+    void encode(const cv::Mat& frame, std::vector<uchar>& buffer, int jpeg_quality = 80);
+
+private:
+    // 在整帧或各 ROI 子图上运行检测器，返回帧坐标下的人脸框
+    std::vector<dlib::rectangle> detectFaces(const cv::Mat& frame);
+
+    // 在图像上绘制人脸框和姓名
+    void drawResult(cv::Mat& frame, const FaceResult& result) const;
+
+    FaceRecognition& recognizer_;
+    std::unique_ptr<FaceDetector> detector_;  // 按 detection.backend 创建
+    const dlib::shape_predictor& sp_;  // 引用共享的预测器，多路视频源不重复占用内存
+    FaceChipBatch chip_batch_;         // 本帧人脸直接构建在网络输入张量中，跨帧复用
+    std::vector<DetectionRegion> regions_;
+    uint64_t watchlists_ = FaceGallery::kAllWatchlists;
+    QualityOptions quality_;
+    bool track_faces_;                 // 质量门控开启且帧按顺序到达时沿轨迹传递结果
+    FaceTracker tracker_;
+};
+
+#endif // FRAME_PIPELINE_H
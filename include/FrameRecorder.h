@@ -0,0 +1,70 @@
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include "FrameSource.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// 录像文件格式 (.ddfgrec)，所有整数均为小端：
+//   文件头: "DDFGREC1" (8 字节) | uint32 版本号 | uint32 JPEG 质量
+//   每帧:   int64 时间戳(纳秒, 相对第一帧) | uint32 数据长度 | JPEG 数据
+// 用 JPEG 压缩每一帧，一分钟 720p 录像通常只有几十 MB。
+
+// 把采集到的帧连同时间戳写入录像文件
+class FrameRecorder {
+public:
+    explicit FrameRecorder(const std::string& path, int jpeg_quality = 90);
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    bool isOpened() const { return out_.is_open(); }
+
+    // 写入一帧，timestamp_ns 使用采集时的单调时钟
+    bool write(const cv::Mat& frame, long long timestamp_ns);
+
+    // 已写入的帧数
+    size_t frameCount() const { return frame_count_; }
+
+    void close();
+
+private:
+    std::ofstream out_;
+    int jpeg_quality_;
+    long long first_timestamp_ns_ = -1;
+    size_t frame_count_ = 0;
+    std::vector<uchar> buffer_;
+};
+
+// 从录像文件回放帧，可以按录制时的速度，也可以尽可能快地输出
+class FrameReplaySource : public FrameSource {
+public:
+    explicit FrameReplaySource(const std::string& path, bool realtime = false, bool loop = false);
+
+    bool read(cv::Mat& frame, long long& timestamp_ns) override;
+    bool isOpened() const override { return opened_; }
+    std::string describe() const override { return "replay " + path_; }
+
+    // 已回放的帧数
+    size_t frameCount() const { return frame_count_; }
+
+private:
+    bool readHeader();
+
+    std::ifstream in_;
+    std::string path_;
+    bool realtime_;
+    bool loop_;
+    bool opened_ = false;
+    size_t frame_count_ = 0;
+    long long replay_start_ns_ = -1;   // 回放开始时的单调时钟
+    long long loop_offset_ns_ = 0;     // 循环回放时累加的时间偏移
+    long long last_timestamp_ns_ = 0;  // 最近一帧的录制时间戳
+    std::vector<uchar> buffer_;
+};
+
+#endif // FRAME_RECORDER_H
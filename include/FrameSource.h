@@ -0,0 +1,46 @@
+#ifndef FRAME_SOURCE_H
+#define FRAME_SOURCE_H
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <string>
+
+// 帧来源接口：摄像头、录像回放等都实现这个接口，
+// 这样处理流水线不需要关心帧从哪里来。
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    // 读取下一帧；timestamp_ns 为该帧的采集时间戳（纳秒，单调时钟）。
+    // 没有更多帧时返回 false。
+    virtual bool read(cv::Mat& frame, long long& timestamp_ns) = 0;
+
+    // 来源是否可用
+    virtual bool isOpened() const = 0;
+
+    // 来源描述，用于日志
+    virtual std::string describe() const = 0;
+};
+
+// 基于 cv::VideoCapture 的来源（摄像头编号或视频文件）
+class VideoCaptureSource : public FrameSource {
+public:
+    explicit VideoCaptureSource(int device_index);
+    explicit VideoCaptureSource(const std::string& path);
+
+    bool read(cv::Mat& frame, long long& timestamp_ns) override;
+    bool isOpened() const override { return cap_.isOpened(); }
+    std::string describe() const override { return description_; }
+
+private:
+    cv::VideoCapture cap_;
+    std::string description_;
+};
+
+// 当前单调时钟时间（纳秒），所有来源共用同一个时间基准
+inline long long monotonicNowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif // FRAME_SOURCE_H
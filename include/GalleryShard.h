@@ -0,0 +1,116 @@
+#ifndef GALLERY_SHARD_H
+#define GALLERY_SHARD_H
+
+#include "FaceGallery.h"
+
+#include <dlib/matrix.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// 分片检索：人脸库太大、一个进程放不下时，每个分片进程（gallery_shard）持有一部分身份，
+// 协调方（FaceRecognition 的 gallery.shards 模式）把查询并行发给所有分片，合并各分片的 top-k。
+//
+// 协议（TCP，同一台机器或同构机器之间，整数和浮点按本机字节序）：每条消息为 uint32 魔数 | uint32 正文字节数 | 正文
+//   请求正文  uint32 查询数 n | uint32 k | uint32 维数 d | uint32 名单数 w |
+//             w x (uint32 长度 | 名单名) | n x d 个 float32
+//   响应正文  uint32 查询数 n | n x (uint32 命中数 | 命中数 x (uint32 长度 | 姓名 | float64 距离))
+// 名单按名字传递（各进程的掩码位不一定相同），分片上没有定义的名单视为空名单。
+// 一个连接上可以依次发送多个请求。
+
+struct ShardEndpoint {
+    std::string host = "127.0.0.1";
+    int port = 0;
+    int timeout_ms = 0;  // 该分片的超时，0 表示用 ShardedGallery 的默认超时
+};
+
+// 分片返回的一个命中：身份姓名和欧氏距离
+struct ShardMatch {
+    std::string name;
+    double distance = 0.0;
+};
+
+// 分片服务：在 port 上监听（0 表示由系统分配，之后用 port() 查询），为每个连接开一个线程，
+// 用 FaceGallery::search 回答查询。人脸库在服务期间只读
+class GalleryShardServer {
+public:
+    // 监听失败时抛出 std::runtime_error
+    GalleryShardServer(const FaceGallery& gallery, int port, const std::string& bind_address = "127.0.0.1");
+    ~GalleryShardServer();
+
+    GalleryShardServer(const GalleryShardServer&) = delete;
+    GalleryShardServer& operator=(const GalleryShardServer&) = delete;
+
+    int port() const { return port_; }
+
+    // 接受连接并处理请求，直到 stop() 被调用（可在信号处理函数中调用）
+    void serve();
+    void stop() { stopping_ = true; }
+
+private:
+    void handleConnection(int fd);
+    // join 已经结束的连接线程，调用方持有 mutex_
+    void reapFinishedWorkers();
+
+    const FaceGallery& gallery_;
+    int listen_fd_ = -1;
+    int port_ = 0;
+    std::atomic<bool> stopping_{false};
+
+    std::mutex mutex_;
+    std::vector<int> connections_;
+    std::vector<std::thread> workers_;
+    std::vector<std::thread::id> finished_;  // 已结束、尚未 join 的连接线程
+};
+
+// 协调方：把一批查询并行发给所有分片，每个查询合并出距离最小的 k 个命中。
+// 每个分片有独立的超时（连接、发送和接收共用一个截止时间）；超时或出错的分片本次被跳过，
+// 结果只来自按时回答的分片，并计入 failedRequests()。各分片的收发在调用线程上用一个 poll() 同时进行，
+// 不另开线程。到分片的连接复用，可被多个线程同时调用
+class ShardedGallery {
+public:
+    // timeout 是没有单独设置 timeout_ms 的分片的超时
+    ShardedGallery(std::vector<ShardEndpoint> shards, std::chrono::milliseconds timeout);
+    ~ShardedGallery();
+
+    ShardedGallery(const ShardedGallery&) = delete;
+    ShardedGallery& operator=(const ShardedGallery&) = delete;
+
+    // 每个查询各自的命中，按距离从小到大，至多 k 个；watchlists 为空时不限名单
+    std::vector<std::vector<ShardMatch>> search(const std::vector<dlib::matrix<float,0,1>>& queries, size_t k,
+                                                const std::vector<std::string>& watchlists = {});
+
+    size_t shardCount() const { return shards_.size(); }
+    std::chrono::milliseconds timeout() const { return timeout_; }
+    size_t failedRequests() const { return failed_requests_; }
+
+private:
+    struct Shard {
+        ShardEndpoint endpoint;
+        std::chrono::milliseconds timeout{0};
+        std::mutex mutex;
+        std::vector<int> idle;  // 空闲的连接
+        bool healthy = true;    // 上一次是否按时回答，状态变化时打日志
+    };
+
+    struct Exchange;  // 一次请求在一个分片上的收发进度，定义在 GalleryShard.cpp
+
+    // 取一个空闲连接（reuse 为 true 时）或开始新建连接；没有可连的地址时返回 false
+    bool open(Exchange& exchange, bool reuse);
+    // 非阻塞地连接下一个地址
+    bool connectNext(Exchange& exchange);
+    // 套接字就绪后推进一步：连接、发送请求或接收响应，收完后连接放回空闲列表
+    void advance(Exchange& exchange, const std::vector<char>& request, size_t query_count);
+    // 关闭出错的连接；复用的旧连接出错且未超时时换新连接重试
+    void fail(Exchange& exchange);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::chrono::milliseconds timeout_;
+    std::atomic<size_t> failed_requests_{0};
+};
+
+#endif // GALLERY_SHARD_H
@@ -0,0 +1,78 @@
+#ifndef HTTP_STREAM_SERVER_H
+#define HTTP_STREAM_SERVER_H
+
+#include <nadjieb/mjpeg_streamer.hpp>
+
+#include <functional>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+
+// 推流端口上的 HTTP 服务：GET <topic> 是 MJPEG 流，另外可以按路径前缀注册处理函数（例如在线登记）。
+// 用 nadjieb 的 Listener / Publisher 组装，代替 nadjieb::MJPEGStreamer；extern/ 下的第三方头文件保持原样，
+// 升级 mjpeg-streamer 时不用合并本地修改。与 MJPEGStreamer 的区别：
+//   - 请求按 Content-Length 在多次读取间缓冲（上传图片），超过 max_request_bytes 回复 413
+//   - 请求头名不区分大小写
+//   - 没有 /shutdown，进程由信号结束
+class HttpStreamServer {
+public:
+    struct Request {
+        std::string method;
+        std::string target;    // 含查询串
+        std::string version;
+        std::unordered_map<std::string, std::string> headers;  // 键为小写
+        std::string body;
+
+        // 请求头（名字不区分大小写），没有时为空串
+        const std::string& header(const std::string& name) const;
+    };
+
+    struct Response {
+        int status = 200;
+        std::string reason = "OK";
+        std::string content_type = "application/json";
+        std::string body;
+    };
+
+    using Handler = std::function<Response(const Request&)>;
+
+    explicit HttpStreamServer(size_t max_request_bytes = 1u << 20);
+    ~HttpStreamServer();
+
+    HttpStreamServer(const HttpStreamServer&) = delete;
+    HttpStreamServer& operator=(const HttpStreamServer&) = delete;
+
+    // target 以 prefix 开头的请求（任意方法）交给 handler，回复后关闭连接。须在 start() 之前调用
+    void route(const std::string& prefix, Handler handler);
+
+    void start(int port, int num_workers = std::thread::hardware_concurrency());
+    void stop();
+
+    // 发布一帧 JPEG 到 topic（例如 /webcam）。Publisher 的 topic 表没有加锁，多个线程发布时须由调用方串行化
+    void publish(const std::string& topic, const std::string& buffer);
+
+    bool isRunning() { return publisher_.isRunning() && listener_.isRunning(); }
+
+    // 解析完整的请求头；text 须含结尾的空行
+    static bool parseHead(const std::string& text, Request& request);
+
+    // 解析 Content-Length：只接受十进制数字且不超出 size_t，空串为 0；否则返回 false（回复 400）
+    static bool parseContentLength(const std::string& text, size_t& length);
+
+private:
+    nadjieb::net::OnMessageCallbackResponse onMessage(const nadjieb::net::SocketFD& sockfd, const std::string& data);
+    void onClose(const nadjieb::net::SocketFD& sockfd);
+    static void send(const nadjieb::net::SocketFD& sockfd, const std::string& version, const Response& response);
+
+    nadjieb::net::Listener listener_;
+    nadjieb::net::Publisher publisher_;
+    std::map<std::string, Handler> routes_;
+    size_t max_request_bytes_;
+    // 尚未收全的请求；只在监听线程上访问
+    std::unordered_map<nadjieb::net::SocketFD, std::string> pending_;
+    // 各 topic 已上报给 MemoryTracker 的最新帧副本大小；与 publish() 一样由调用方串行化
+    std::unordered_map<std::string, size_t> topic_bytes_;
+};
+
+#endif // HTTP_STREAM_SERVER_H
@@ -0,0 +1,93 @@
+#ifndef INFERENCE_CONTEXT_POOL_H
+#define INFERENCE_CONTEXT_POOL_H
+
+#include "FaceRecognition.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 识别网络的推理上下文池。
+// dlib 网络在前向计算时会把中间结果写进各层的输出张量，同一个网络对象不能被两个线程同时调用。
+// 池中保存 N 个网络实例，线程通过 acquire() 借出一个，用完自动归还，从而让 N 个线程并行提取特征。
+//
+// 第 0 个上下文直接借用 FaceRecognition 中已加载的网络，其余为它的副本。
+// dlib 的每个层自己持有参数张量，无法在实例之间共享权重，因此每多一个上下文就多一份权重
+// 加上该实例的中间结果缓存；构造时会实测这部分开销并上报给 MemoryTracker。
+//
+// 有多个上下文时，池另有 size - 1 个常驻线程供 parallelFor 使用，识别一组人脸时不再每张脸新建线程。
+class InferenceContextPool {
+public:
+    // 借出的上下文，析构时归还
+    class Lease {
+    public:
+        Lease(InferenceContextPool& pool, anet_type* net) : pool_(&pool), net_(net) {}
+        Lease(Lease&& other) noexcept : pool_(other.pool_), net_(other.net_) { other.net_ = nullptr; }
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() {
+            if (net_) pool_->release(net_);
+        }
+
+        anet_type& net() { return *net_; }
+
+    private:
+        InferenceContextPool* pool_;
+        anet_type* net_;
+    };
+
+    // primary 为已加载的网络（不转移所有权），size 为上下文总数（至少为 1）
+    InferenceContextPool(anet_type& primary, size_t size);
+    ~InferenceContextPool();
+
+    // 借出一个空闲上下文，全部被占用时阻塞等待
+    Lease acquire();
+
+    // 并行执行 count 个任务：job(i, net) 由调用线程和常驻线程领取执行，每个任务借用一个上下文。
+    // 全部完成后返回；任务抛出的第一个异常在调用线程上重新抛出。可被多个线程同时调用
+    void parallelFor(size_t count, const std::function<void(size_t, anet_type&)>& job);
+
+    // 上下文总数
+    size_t size() const { return all_.size(); }
+
+    // 实测的每个额外上下文的内存开销（字节），只有一个上下文时为 0
+    size_t bytesPerExtraContext() const { return bytes_per_extra_context_; }
+
+private:
+    // 一次 parallelFor 调用：任务编号从 next 领取，done 与 error 由 mutex_ 保护
+    struct Batch {
+        size_t count = 0;
+        const std::function<void(size_t, anet_type&)>* job = nullptr;
+        std::atomic<size_t> next{0};
+        size_t done = 0;
+        std::exception_ptr error;
+    };
+
+    void release(anet_type* net);
+    // 领取并执行 batch 中的任务，直到领完
+    void runJobs(Batch& batch);
+    // 常驻线程：等待 parallelFor 发布的任务
+    void helperLoop();
+
+    std::vector<std::unique_ptr<anet_type>> owned_; // 额外创建的副本
+    std::vector<anet_type*> all_;                   // 所有上下文（含借用的 primary）
+    std::vector<anet_type*> idle_;                  // 空闲上下文
+    std::mutex mutex_;
+    std::condition_variable available_;
+    size_t bytes_per_extra_context_ = 0;
+
+    // 常驻线程及待领取的任务，由 mutex_ 保护
+    std::vector<std::thread> helpers_;
+    std::deque<std::shared_ptr<Batch>> batches_;
+    std::condition_variable work_ready_;
+    std::condition_variable batch_done_;
+    bool stopping_ = false;
+};
+
+#endif // INFERENCE_CONTEXT_POOL_H
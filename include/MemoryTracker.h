@@ -0,0 +1,111 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 内存统计：
+// 1. 分配统计（需要以 -DDDFG_ALLOC_TRACKING=ON 编译）：替换全局 operator new/delete，
+//    把每次分配的次数和字节数记到当前线程最内层的 PM_SCOPED 阶段上；
+//    释放时记回分配它的那个阶段，因此“存活字节”反映的是该阶段留下的内存。
+// 2. 组件内存：各模块（模型、人脸库、统计数据、推流缓冲等）主动上报自己的估算占用，
+//    再加上进程常驻内存 (RSS)，不需要特殊编译选项。
+class MemoryTracker {
+public:
+    static constexpr int kMaxStages = 128;  // 可统计的阶段数上限，超出的记到 0 号
+    static constexpr int kUntrackedStage = 0; // 不在任何 PM_SCOPED 阶段内的分配
+
+    struct StageStats {
+        std::string name;
+        uint64_t allocs = 0;
+        uint64_t frees = 0;
+        uint64_t bytes_allocated = 0;
+        int64_t live_bytes = 0;
+    };
+
+    static MemoryTracker& getInstance();
+
+    // 是否编译了分配统计
+    static constexpr bool allocationTrackingEnabled() {
+#ifdef DDFG_ALLOC_TRACKING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // 注册（或查找）一个阶段，返回阶段编号
+    int registerStage(const std::string& name);
+
+    // 当前线程正在执行的阶段
+    static int currentStage() { return current_stage_; }
+    static void setCurrentStage(int stage) { current_stage_ = stage; }
+
+    // 由 operator new/delete 调用，只做原子计数，不分配内存
+    static void recordAlloc(int stage, size_t bytes);
+    static void recordFree(int stage, size_t bytes);
+
+    // 上报 / 查询组件内存占用（字节）
+    void setComponentBytes(const std::string& component, size_t bytes);
+    std::map<std::string, size_t> getComponents() const;
+
+    // 各阶段分配统计，按分配字节数降序
+    std::vector<StageStats> getStageStats() const;
+
+    // 进程常驻内存 (RSS)，读取失败时返回 0
+    static size_t residentBytes();
+
+    // 打印内存报告（由 PerformanceMonitor::printReport 调用）。
+    // extra_components 是调用方自己的占用，只并入本次报告，不写回组件表
+    void printReport(const std::map<std::string, size_t>& extra_components = {}) const;
+
+    // 清除分配计数（组件占用保留）
+    void reset();
+
+private:
+    MemoryTracker() = default;
+    MemoryTracker(const MemoryTracker&) = delete;
+    MemoryTracker& operator=(const MemoryTracker&) = delete;
+
+    struct StageCounters {
+        std::atomic<uint64_t> allocs{0};
+        std::atomic<uint64_t> frees{0};
+        std::atomic<uint64_t> bytes_allocated{0};
+        std::atomic<uint64_t> bytes_freed{0};
+    };
+
+    static StageCounters counters_[kMaxStages];
+    static thread_local int current_stage_;
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, int> stage_ids_;
+    std::vector<std::string> stage_names_{"(其他)"};
+    std::map<std::string, size_t> components_;
+};
+
+// 切换当前线程阶段的 RAII 辅助类，由 ScopedPerformanceMonitor 使用
+class ScopedMemoryStage {
+public:
+    explicit ScopedMemoryStage(const std::string& name) {
+#ifdef DDFG_ALLOC_TRACKING
+        previous_ = MemoryTracker::currentStage();
+        MemoryTracker::setCurrentStage(MemoryTracker::getInstance().registerStage(name));
+#else
+        (void)name;
+#endif
+    }
+
+    ~ScopedMemoryStage() {
+#ifdef DDFG_ALLOC_TRACKING
+        MemoryTracker::setCurrentStage(previous_);
+#endif
+    }
+
+private:
+    int previous_ = MemoryTracker::kUntrackedStage;
+};
@@ -0,0 +1,54 @@
+#ifndef MOTION_GATE_H
+#define MOTION_GATE_H
+
+#include "ConfigParser.h"
+#include "FaceTracker.h"
+#include "FramePipeline.h"
+
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+// 运动门控参数，对应 config.json 中的 motion.*（单个视频源可用 sources[i].motion 覆盖）
+struct MotionGateOptions {
+    bool enabled = false;
+    int thumbnail_width = 64;           // 差分用缩略图宽度（高度按比例）
+    int pixel_threshold = 20;           // 缩略图像素灰度变化超过该值才算变化 (0-255)
+    double min_changed_fraction = 0.01; // 变化像素占比超过该值才认为场景变化（灵敏度）
+    int hold_frames = 15;               // 检测到变化后继续做完整检测的帧数
+    int track_max_missed = 5;           // 跟踪目标连续多少帧未被检测到后丢弃
+    int keyframe_interval = 150;        // 静止时每隔多少帧强制检测一次，0 表示不强制
+
+    static MotionGateOptions fromJson(const json& node, const MotionGateOptions& defaults);
+};
+
+// 运动门控：决定当前帧是否需要运行完整的人脸检测。
+// 把帧缩成很小的灰度缩略图并与上一帧差分，场景有变化、仍有活动的人脸跟踪，
+// 或到达强制检测间隔时才放行；空旷静止的画面直接跳过检测和识别。
+// 跟踪用 FaceTracker 把相邻两次检测的人脸框关联起来，足以判断“画面里还有人”。
+// 每路视频源各持有一个，不是线程安全的。
+class MotionGate {
+public:
+    explicit MotionGate(const MotionGateOptions& options);
+
+    // 本帧是否需要做人脸检测（同时更新差分参考帧）
+    bool shouldDetect(const cv::Mat& frame);
+
+    // 提交本帧的检测结果，用于维护跟踪
+    void observe(const std::vector<FaceResult>& faces);
+
+    bool trackActive() const { return !tracker_.empty(); }
+    // 最近一次 shouldDetect 计算出的变化像素占比
+    double lastChangedFraction() const { return last_changed_fraction_; }
+
+private:
+    MotionGateOptions options_;
+    cv::Mat previous_;        // 上一帧缩略图
+    cv::Mat thumbnail_;
+    cv::Mat diff_;
+    FaceTracker tracker_;
+    int hold_remaining_ = 0;
+    int frames_since_detect_ = 0;
+    double last_changed_fraction_ = 0.0;
+};
+
+#endif // MOTION_GATE_H
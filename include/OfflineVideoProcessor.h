@@ -0,0 +1,40 @@
+#ifndef OFFLINE_VIDEO_PROCESSOR_H
+#define OFFLINE_VIDEO_PROCESSOR_H
+
+#include "FramePipeline.h"
+
+#include <string>
+
+class ConfigParser;
+class FaceRecognition;
+
+// 离线视频处理选项，对应 config.json 中的 video_path 和 offline.*
+struct OfflineOptions {
+    std::string video_path;
+    std::string log_path = "recognition_log.csv";
+    size_t workers = 0;          // 检测识别线程数，0 表示按 CPU 核数；每个线程的检测线程数随之减少，总数不超过核数
+    size_t queue_capacity = 0;   // 解码队列上限（帧），0 表示 workers 的 4 倍
+    PipelineOptions pipeline;
+
+    static OfflineOptions fromConfig(const ConfigParser& config);
+};
+
+// 离线视频处理：以尽可能快的速度处理录好的视频文件。
+// 解码在独立线程上进行，解出的帧经有界队列分发给多个工作线程做检测与识别，
+// 结果按帧号重新排序后写入逐帧识别日志 (CSV)：
+//   frame,timestamp_ms,name,left,top,right,bottom
+// 每张人脸一行；没有人脸的帧不产生记录。
+class OfflineVideoProcessor {
+public:
+    OfflineVideoProcessor(FaceRecognition& recognizer, const OfflineOptions& options);
+
+    // 处理整个视频，完成后返回；视频或日志文件打不开时返回 false。
+    // 检测器创建失败（检测后端或模型配置错误）以及处理中的异常在所有线程结束后抛给调用方
+    bool run();
+
+private:
+    FaceRecognition& recognizer_;
+    OfflineOptions options_;
+};
+
+#endif // OFFLINE_VIDEO_PROCESSOR_H
@@ -6,7 +6,11 @@
 #include <vector>
 #include <numeric> // For std::accumulate
 #include <iostream> // For std::cerr in ScopedPerformanceMonitor (optional, but good for warnings)
+#include <mutex>
+#include "MemoryTracker.h"
 
+// 线程安全：各线程的计时起点保存在线程局部存储中，汇总数据由互斥锁保护，
+// 多个线程可以同时对同名任务计时。
 class PerformanceMonitor {
 public:
     using Clock = std::chrono::high_resolution_clock;
@@ -22,18 +26,77 @@ public:
     // 停止一个任务计时
     void stopTask(const std::string& task_name);
 
+    // 直接记录一次任务耗时（用于无法用 start/stop 包住的场景，例如排队等待时间）
+    void recordDuration(const std::string& task_name, DurationNs duration);
+
+    // 记录一个非时间类指标的取值（例如批大小、队列长度）
+    void recordValue(const std::string& metric_name, double value);
+
     // 记录一帧的开始时间
     void startFrame();
 
     // 记录一帧的结束时间
     void stopFrame();
 
+    // 单个任务的统计摘要（毫秒）
+    struct TaskSummary {
+        std::string name;
+        long long runs = 0;
+        double avg_ms = 0.0;
+        double min_ms = 0.0;
+        double max_ms = 0.0;
+        double p50_ms = 0.0;
+        double p99_ms = 0.0;
+    };
+
+    // 整帧的统计摘要
+    struct FrameSummary {
+        long long frames = 0;
+        double avg_ms = 0.0;
+        double min_ms = 0.0;
+        double max_ms = 0.0;
+        double p50_ms = 0.0;
+        double p99_ms = 0.0;
+        double fps = 0.0;
+    };
+
+    // 非时间类指标的统计摘要
+    struct MetricSummary {
+        std::string name;
+        long long count = 0;
+        double avg = 0.0;
+        double p50 = 0.0;
+        double p99 = 0.0;
+        double max = 0.0;
+    };
+
     // 打印所有统计信息
     void printReport() const;
 
+    // 获取各任务的统计摘要，按平均耗时降序
+    std::vector<TaskSummary> getTaskSummaries() const;
+
+    // 获取整帧统计摘要
+    FrameSummary getFrameSummary() const;
+
+    // 获取各指标的统计摘要，按名称排序
+    std::vector<MetricSummary> getMetricSummaries() const;
+
+    // 把统计摘要写成 JSON 文件，便于脚本比较
+    bool writeJson(const std::string& path) const;
+
     // 清除所有统计数据
     void reset();
 
+    // 统计数据本身占用的内存（字节），计入内存报告
+    size_t memoryBytes() const;
+
+    // 记录一个启动阶段（可在任意线程调用，阶段之间允许重叠）
+    void recordStartupPhase(const std::string& phase, TimePoint start, TimePoint end);
+
+    // 打印启动时间线，时间相对于进程启动
+    void printStartupTimeline() const;
+
 private:
     PerformanceMonitor() = default; // 私有构造函数，实现单例
     ~PerformanceMonitor() = default; // 私有析构函数
@@ -42,8 +105,6 @@ private:
 
     struct TaskStats {
         std::vector<long long> durations_ns; // 存储每次运行的纳秒时长
-        TimePoint current_start_time;       // 当前任务的开始时间
-        bool is_running = false;            // 任务是否正在计时
         long long min_ns = -1;              // 最小耗时
         long long max_ns = -1;              // 最大耗时
         long long total_ns = 0;             // 总耗时
@@ -67,9 +128,18 @@ private:
         }
     };
 
+    mutable std::mutex data_mutex_;             // 保护 task_data_、metric_data_ 和 frame_durations_ns_
     std::unordered_map<std::string, TaskStats> task_data_;
-    TimePoint frame_start_time_;
+    std::unordered_map<std::string, std::vector<double>> metric_data_;
     std::vector<long long> frame_durations_ns_; // 存储每帧的纳秒时长
+
+    struct StartupPhase {
+        std::string name;
+        TimePoint start;
+        TimePoint end;
+    };
+    mutable std::mutex startup_mutex_;          // 启动阶段可能来自并行加载线程
+    std::vector<StartupPhase> startup_phases_;
 };
 
 
@@ -83,9 +153,10 @@ private:
 #define PM_STOP(task_name) PerformanceMonitor::getInstance().stopTask(task_name);
 
 // 自动停止的辅助类，用于 RAII 风格的时间测量
+// 开启 DDFG_ALLOC_TRACKING 时，作用域内的内存分配也记到该任务名下
 class ScopedPerformanceMonitor {
 public:
-    ScopedPerformanceMonitor(const std::string& task_name) : task_name_(task_name) {
+    ScopedPerformanceMonitor(const std::string& task_name) : task_name_(task_name), memory_stage_(task_name_) {
         PerformanceMonitor::getInstance().startTask(task_name_);
     }
 
@@ -95,6 +166,22 @@ public:
 
 private:
     std::string task_name_;
+    ScopedMemoryStage memory_stage_;
+};
+
+// 记录启动阶段的 RAII 辅助类，析构时把整个作用域记为一个阶段
+class ScopedStartupPhase {
+public:
+    explicit ScopedStartupPhase(const std::string& phase)
+        : phase_(phase), start_(PerformanceMonitor::Clock::now()) {}
+
+    ~ScopedStartupPhase() {
+        PerformanceMonitor::getInstance().recordStartupPhase(phase_, start_, PerformanceMonitor::Clock::now());
+    }
+
+private:
+    std::string phase_;
+    PerformanceMonitor::TimePoint start_;
 };
 
 // 方便的宏，用于自动管理任务的开始和结束
@@ -0,0 +1,84 @@
+#ifndef PYRAMID_DETECTOR_H
+#define PYRAMID_DETECTOR_H
+
+#include "FaceDetector.h"
+
+#include <opencv2/opencv.hpp>
+#include <dlib/image_processing/frontal_face_detector.h>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 基于共享灰度金字塔的 HOG 人脸检测器（detection.backend = "hog"）。
+// dlib 的 frontal_face_detector 对每帧都要自己做颜色转换和金字塔缩放；这里用 OpenCV
+// (SIMD 优化的 cvtColor / resize) 一次性构建灰度金字塔，并复用各层缓冲区，
+// 再用只扫描单层的同一组 HOG 滤波器逐层检测，最后按得分做与 dlib 相同的非极大值抑制。
+// 检测结果已映射回输入图像的坐标。每个线程应持有自己的实例。
+//
+// threads > 1 时各层（以及面积过大的层切出的水平条带）分给多个线程并行扫描：
+// 构造时创建 threads - 1 个常驻扫描线程，调用 detect() 的线程也参与，每帧不再创建线程。
+// 条带起点按 HOG 单元对齐并带有足够的重叠，每个检测窗口只由“拥有”它的条带上报，
+// 因而并行结果与单线程完全一致。
+class PyramidDetector : public FaceDetector {
+public:
+    explicit PyramidDetector(const DetectionOptions& options = DetectionOptions());
+    ~PyramidDetector() override;
+
+    PyramidDetector(const PyramidDetector&) = delete;
+    PyramidDetector& operator=(const PyramidDetector&) = delete;
+
+    std::vector<dlib::rectangle> detect(const cv::Mat& bgr) override;
+    std::string name() const override { return "hog"; }
+
+private:
+    using Detections = std::vector<dlib::rect_detection>;
+
+    // 一个扫描任务：某一层金字塔上的一段行
+    struct ScanJob {
+        size_t level = 0;
+        int row_begin = 0;   // 实际送进检测器的行范围 [row_begin, row_end)
+        int row_end = 0;
+        int own_begin = 0;   // 本任务负责上报的检测框顶边范围 [own_begin, own_end)
+        int own_end = 0;
+    };
+
+    // 构建灰度金字塔：第 0 层是按 scale 缩放后的灰度图，之后每层缩小为上一层的 5/6
+    void buildPyramid(const cv::Mat& bgr);
+    // 把各层划分为扫描任务，大层切成条带以便均衡负载
+    void planJobs();
+    // 用第 worker 个检测器执行一个任务，结果映射回输入图像坐标
+    void runJob(size_t worker, const ScanJob& job, const cv::Size& input_size, Detections& out);
+    // 从共享计数器领取任务直到领完，结果放进 partial_[worker]
+    void scanJobs(size_t worker);
+    // 常驻扫描线程：等待 detect() 发布一轮任务，参与扫描后报告完成
+    void helperLoop(size_t worker);
+    // 按得分排序后用检测器的重叠判定去除重复框
+    std::vector<dlib::rectangle> suppress(Detections& detections) const;
+
+    DetectionOptions options_;
+    std::vector<dlib::frontal_face_detector> level_detectors_;  // 只扫描单层的检测器，每个线程一个
+    dlib::test_box_overlap overlap_tester_;        // 原检测器的重叠判定，用于跨层去重
+    unsigned long min_level_width_;                // 小于检测窗口的层不再扫描
+    unsigned long min_level_height_;
+    cv::Mat gray_;
+    std::vector<cv::Mat> levels_;
+    size_t level_count_ = 0;
+    std::vector<ScanJob> jobs_;
+
+    // 常驻扫描线程及一轮扫描的状态，由 pool_mutex_ 保护（next_job_ 除外）
+    std::vector<std::thread> helpers_;
+    std::mutex pool_mutex_;
+    std::condition_variable work_ready_;
+    std::condition_variable work_done_;
+    size_t generation_ = 0;       // 每轮扫描加一
+    size_t active_workers_ = 0;   // 本轮参与的线程数（含调用线程）
+    size_t busy_helpers_ = 0;     // 本轮尚未完成的常驻线程数
+    bool stopping_ = false;
+    std::atomic<size_t> next_job_{0};
+    cv::Size input_size_;
+    std::vector<Detections> partial_;  // 每个线程一份结果
+};
+
+#endif // PYRAMID_DETECTOR_H
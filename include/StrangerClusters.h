@@ -0,0 +1,78 @@
+#ifndef STRANGER_CLUSTERS_H
+#define STRANGER_CLUSTERS_H
+
+#include "ConfigParser.h"
+
+#include <dlib/matrix.h>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 陌生人聚类参数，对应 config.json 中的 strangers.*
+struct StrangerOptions {
+    bool enabled = false;
+    double threshold = 0.5;     // 与聚类中心的欧氏距离不超过它时归入该聚类（比识别阈值略严，避免两人合并）
+    size_t max_clusters = 1000; // 同时保留的聚类上限，满了淘汰最久未出现的
+    double max_age_s = 3600;    // 超过这么久没再出现的聚类被丢弃，之后再来算作新访客
+    int min_sightings = 3;      // 出现这么多次的聚类才计入访客数（过滤误检和一闪而过的侧脸）
+
+    static StrangerOptions fromConfig(const ConfigParser& config);
+};
+
+// 未匹配人脸的在线聚类：给反复出现的陌生人分配稳定的匿名编号（"Stranger-17"），并实时统计访客数。
+// 每个特征只与现有聚类中心比较一次（增量最近中心分配），不保存历史特征，也不做周期性的
+// chinese_whispers 全量重算；内存上限为 max_clusters 个中心。编号单调递增、从不复用。
+// 线程安全，多路视频源共用一个实例，同一个人在不同摄像头下得到同一个编号。
+class StrangerClusters {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit StrangerClusters(const StrangerOptions& options = StrangerOptions());
+
+    // 把一个陌生人特征归入最近的聚类（或新建一个），返回匿名标签
+    std::string assign(const dlib::matrix<float,0,1>& descriptor) { return assign(descriptor, Clock::now()); }
+    std::string assign(const dlib::matrix<float,0,1>& descriptor, Clock::time_point now);
+
+    // 至今出现过 min_sightings 次以上的聚类数，即去重后的陌生访客数（含已淘汰的聚类）
+    size_t uniqueVisitors() const;
+
+    // 当前保留的聚类数
+    size_t activeClusters() const;
+
+    // 把识别结果中未匹配的 "Stranger" 换成匿名标签，descriptors 与 names 一一对应。
+    // 只用于不限名单（FaceGallery::kAllWatchlists）的识别：名单外的熟人不算陌生人，此时不做任何改动
+    void labelUnmatched(const std::vector<dlib::matrix<float,0,1>>& descriptors, std::vector<std::string>& names,
+                        uint64_t watchlists);
+
+    // 匿名标签的前缀，标签为 "Stranger-N"
+    static const char* labelPrefix() { return "Stranger"; }
+
+    // name 是否为陌生人：未匹配的 "Stranger" 或聚类标签 "Stranger-N"。
+    // 只比较完整格式，以 "Stranger" 开头的登记姓名（如 "Strangerfield"）不算
+    static bool isStrangerLabel(const std::string& name);
+
+private:
+    struct Cluster {
+        uint64_t id = 0;
+        uint32_t sightings = 0;
+        Clock::time_point last_seen;
+    };
+
+    // 丢弃过期聚类；仍然满员时淘汰最久未出现的一个
+    void evict(Clock::time_point now);
+
+    // 删除第 slot 个聚类（与最后一个交换）
+    void erase(size_t slot);
+
+    StrangerOptions options_;
+    mutable std::mutex mutex_;
+    long dim_ = 0;
+    std::vector<float> centroids_;   // clusters_.size() x dim_，行优先
+    std::vector<Cluster> clusters_;
+    uint64_t next_id_ = 1;
+    size_t visitors_ = 0;
+};
+
+#endif // STRANGER_CLUSTERS_H
@@ -0,0 +1,84 @@
+// 录像回放性能测试：把 .ddfgrec 录像送进与 web_capture 相同的处理流水线，
+// 不需要摄像头和推流，结束后输出 PerformanceMonitor 报告。
+//
+// 用法: replay_bench <录像文件> [--realtime] [--config config/config.json]
+//   --realtime  按录制时的速度回放（默认尽可能快）
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "ConfigParser.h"
+#include "FaceRecognition.hpp"
+#include "FramePipeline.h"
+#include "FrameRecorder.h"
+#include "PerformanceMonitor.h"
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "用法: " << argv[0] << " <录像文件> [--realtime] [--config 配置文件]" << std::endl;
+        return 1;
+    }
+
+    std::string recording_path = argv[1];
+    std::string config_path = "config/config.json";
+    bool realtime = false;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--realtime") {
+            realtime = true;
+        } else if (arg == "--config" && i + 1 < argc) {
+            config_path = argv[++i];
+        } else {
+            std::cerr << "未知参数: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    ConfigParser config;
+    if (!config.load(config_path)) {
+        return 1;
+    }
+
+    try {
+        FaceRecognition face_recognizer(config);
+        FrameReplaySource source(recording_path, realtime);
+        if (!source.isOpened()) {
+            return 1;
+        }
+
+        FramePipeline pipeline(face_recognizer, PipelineOptions::fromConfig(config));
+        // 模型加载和建库的耗时不计入回放统计
+        PerformanceMonitor::getInstance().reset();
+
+        cv::Mat frame;
+        long long timestamp_ns = 0;
+        std::vector<uchar> buffer;
+        size_t face_count = 0;
+        const long long replay_start_ns = monotonicNowNs();
+
+        while (source.read(frame, timestamp_ns)) {
+            PM_START("总帧处理");
+            PerformanceMonitor::getInstance().startFrame();
+
+            face_count += pipeline.process(frame).size();
+            pipeline.encode(frame, buffer);
+
+            PerformanceMonitor::getInstance().stopFrame();
+            PM_STOP("总帧处理");
+        }
+
+        const double elapsed_s = (monotonicNowNs() - replay_start_ns) / 1e9;
+        std::cout << "Replayed " << source.frameCount() << " frames (" << face_count << " faces) in "
+                  << elapsed_s << " s";
+        if (elapsed_s > 0) {
+            std::cout << ", " << source.frameCount() / elapsed_s << " FPS wall clock";
+        }
+        std::cout << std::endl;
+        PerformanceMonitor::getInstance().printReport();
+    } catch (const std::exception& e) {
+        std::cerr << "回放失败: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,204 @@
+#include "CaptureWorker.h"
+#include "ConfigParser.h"
+#include "FaceRecognition.hpp"
+#include "MemoryTracker.h"
+
+#include <iostream>
+#include <stdexcept>
+
+std::vector<SourceConfig> loadSourceConfigs(const ConfigParser& config) {
+    std::vector<SourceConfig> sources;
+    const PipelineOptions pipeline = PipelineOptions::fromConfig(config);
+    const MotionGateOptions motion = MotionGateOptions::fromJson(config.get<json>("motion", json::object()), {});
+    const json list = config.get<json>("sources", json::array());
+    const json defined_watchlists = config.get<json>("gallery.watchlists", json::object());
+
+    if (!list.is_array() || list.empty()) {
+        // 旧配置：单摄像头（或 replay.path 指定的录像），推流到 /webcam
+        SourceConfig source;
+        source.name = "default";
+        source.topic = "/webcam";
+        source.path = config.get<std::string>("replay.path", "");
+        if (!source.path.empty()) {
+            source.type = "replay";
+            source.realtime = config.get<bool>("replay.realtime", true);
+            source.loop = config.get<bool>("replay.loop", false);
+        }
+        if (config.get<bool>("record.enabled", false)) {
+            source.record_path = config.get<std::string>("record.path", "capture.ddfgrec");
+            source.record_jpeg_quality = config.get<int>("record.jpeg_quality", 90);
+        }
+        source.pipeline = pipeline;
+        source.motion = motion;
+        sources.push_back(source);
+        return sources;
+    }
+
+    // 两种写法同时出现时以 sources 为准，旧的 replay.* / record.* 不再生效，提示一下免得以为在录像
+    if (!config.get<std::string>("replay.path", "").empty() || config.get<bool>("record.enabled", false)) {
+        std::cerr << "Warning: 'sources' is set, so replay.path and record.* are ignored; "
+                     "use sources[].type = \"replay\" and sources[].record_path instead." << std::endl;
+    }
+
+    for (size_t i = 0; i < list.size(); ++i) {
+        const json& item = list[i];
+        SourceConfig source;
+        source.pipeline = pipeline;
+        source.name = item.value("name", "source" + std::to_string(i));
+        source.type = item.value("type", "camera");
+        // 其他类型（拼错的 "flie"、尚不支持的 "rtsp"）不能悄悄当成摄像头打开
+        if (source.type != "camera" && source.type != "file" && source.type != "replay") {
+            throw std::runtime_error("Source '" + source.name + "' has unknown type '" + source.type +
+                                     "'; expected \"camera\", \"file\" or \"replay\"");
+        }
+        source.device = item.value("device", 0);
+        source.path = item.value("path", "");
+        source.topic = item.value("topic", "/" + source.name);
+        source.realtime = item.value("realtime", true);
+        source.loop = item.value("loop", false);
+        source.record_path = item.value("record_path", "");
+        source.record_jpeg_quality = item.value("record_jpeg_quality", 90);
+        source.motion = MotionGateOptions::fromJson(item.value("motion", json::object()), motion);
+        source.regions = DetectionRegion::parseList(item.value("roi", json::array()));
+        source.watchlists = item.value("watchlists", std::vector<std::string>());
+        // 名单拼错时在启动阶段报错，不要等到创建 CaptureWorker 时才抛出
+        for (const auto& watchlist : source.watchlists) {
+            if (!defined_watchlists.contains(watchlist)) {
+                throw std::runtime_error("Source '" + source.name + "' uses watchlist '" + watchlist +
+                                         "', which is not defined in gallery.watchlists");
+            }
+        }
+        sources.push_back(source);
+    }
+    return sources;
+}
+
+std::unique_ptr<FrameSource> openFrameSource(const SourceConfig& source_config) {
+    if (source_config.type == "replay") {
+        return std::make_unique<FrameReplaySource>(source_config.path, source_config.realtime, source_config.loop);
+    }
+    if (source_config.type == "file") {
+        return std::make_unique<VideoCaptureSource>(source_config.path);
+    }
+    return std::make_unique<VideoCaptureSource>(source_config.device);
+}
+
+CaptureWorker::CaptureWorker(const SourceConfig& source_config, std::unique_ptr<FrameSource> source,
+                             FaceRecognition& recognizer, PublishFn publish)
+    : config_(source_config),
+      source_(std::move(source)),
+      pipeline_(recognizer, source_config.pipeline),
+      publish_(std::move(publish)),
+      drop_stale_frames_(source_config.type == "camera") {
+    if (!config_.record_path.empty()) {
+        recorder_ = std::make_unique<FrameRecorder>(config_.record_path, config_.record_jpeg_quality);
+        if (!recorder_->isOpened()) {
+            throw std::runtime_error("Cannot open recording file " + config_.record_path + " for source " +
+                                     config_.name);
+        }
+    }
+    pipeline_.setRegions(config_.regions);
+    pipeline_.setWatchlists(recognizer.watchlistMask(config_.watchlists));
+    if (config_.motion.enabled) {
+        motion_gate_ = std::make_unique<MotionGate>(config_.motion);
+    }
+}
+
+CaptureWorker::~CaptureWorker() {
+    stop();
+}
+
+void CaptureWorker::start() {
+    start_time_ = PerformanceMonitor::Clock::now();
+    capture_thread_ = std::thread(&CaptureWorker::captureLoop, this);
+    process_thread_ = std::thread(&CaptureWorker::processLoop, this);
+}
+
+void CaptureWorker::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (capture_thread_.joinable()) capture_thread_.join();
+    if (process_thread_.joinable()) process_thread_.join();
+    if (recorder_) recorder_->close();
+}
+
+void CaptureWorker::captureLoop() {
+    while (true) {
+        cv::Mat frame;  // 每帧新建，交给处理线程后不再复用缓冲
+        long long timestamp_ns = 0;
+        if (!source_->read(frame, timestamp_ns)) {
+            std::cerr << "[" << config_.name << "] 帧为空，视频源结束: " << source_->describe() << std::endl;
+            break;
+        }
+        if (recorder_ && !recorder_->write(frame, timestamp_ns)) {
+            // 磁盘写满等情况：报告一次并停止录像，不影响识别和推流
+            std::cerr << "[" << config_.name << "] 录像写入失败，停止录像: " << config_.record_path << std::endl;
+            recorder_.reset();
+        }
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (!drop_stale_frames_) {
+            changed_.wait(lock, [this] { return stopping_ || !has_pending_; });
+        } else if (has_pending_) {
+            ++frames_dropped_;  // 处理跟不上，用最新帧覆盖旧帧
+        }
+        if (stopping_) return;
+        pending_frame_ = std::move(frame);
+        has_pending_ = true;
+        lock.unlock();
+        changed_.notify_all();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        source_done_ = true;
+    }
+    changed_.notify_all();
+}
+
+void CaptureWorker::processLoop() {
+    auto& monitor = PerformanceMonitor::getInstance();
+    std::vector<uchar> buffer;
+    cv::Mat frame;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            changed_.wait(lock, [this] { return stopping_ || has_pending_ || source_done_; });
+            if (stopping_ || (!has_pending_ && source_done_)) break;
+            frame = std::move(pending_frame_);
+            has_pending_ = false;
+        }
+        changed_.notify_all();
+
+        // 统计一帧的总处理时间
+        PM_START("总帧处理");
+        monitor.startFrame();
+
+        if (!motion_gate_ || motion_gate_->shouldDetect(frame)) {
+            std::vector<FaceResult> faces = pipeline_.process(frame);
+            if (motion_gate_) motion_gate_->observe(faces);
+        } else {
+            ++frames_skipped_;  // 画面静止且没有跟踪目标，只推流不检测
+        }
+        pipeline_.encode(frame, buffer);
+        {
+            PM_SCOPED(图像发布);
+            publish_(config_.topic, buffer);
+        }
+
+        monitor.stopFrame();
+        PM_STOP("总帧处理");
+
+        if (frames_processed_++ == 0) {
+            monitor.recordStartupPhase("首帧发布 (" + config_.name + ")", start_time_, PerformanceMonitor::Clock::now());
+        }
+        if (frames_processed_ % 100 == 1) {
+            MemoryTracker::getInstance().setComponentBytes("推流帧缓冲 (" + config_.name + ")", buffer.capacity());
+        }
+    }
+    finished_ = true;
+}
@@ -2,7 +2,258 @@
 #include <iostream>
 #include <fstream>
 #include <filesystem>
-#include <algorithm> // 需要包含 <algorithm> 来使用 std::replace
+#include <algorithm>
+#include <sstream>
+
+namespace {
+// 配置项的类型。Object 按表逐键校验；Map 是自由的对象（例如名单名 -> 成员），只校验类型；
+// ObjectList 是对象数组，每个元素按 "键[]" 下的表校验
+enum class Type { Bool, Int, Number, String, StringList, Array, Object, Map, ObjectList };
+
+struct KeySpec {
+    const char* key;
+    Type type;
+};
+
+// 所有已知的配置项。新增配置项时在这里登记，否则 load() 会把它当作未知的键
+const KeySpec kSchema[] = {
+    {"use_camera", Type::Bool},
+    {"video_path", Type::String},
+    {"face_match_threshold", Type::Number},
+    {"debug_mode", Type::Bool},
+    {"frame_sample_interval", Type::Int},
+    {"offline", Type::Object},
+    {"offline.log_path", Type::String},
+    {"offline.workers", Type::Int},
+    {"offline.queue_capacity", Type::Int},
+    {"models", Type::Object},
+    {"models.shape_predictor", Type::String},
+    {"models.face_recognition", Type::String},
+    {"inference", Type::Object},
+    {"inference.contexts", Type::Int},
+    {"inference.batching", Type::Object},
+    {"inference.batching.enabled", Type::Bool},
+    {"inference.batching.max_batch_size", Type::Int},
+    {"inference.batching.max_delay_ms", Type::Number},
+    {"gallery", Type::Object},
+    {"gallery.storage", Type::String},
+    {"gallery.rerank", Type::Int},
+    {"gallery.pca_dims", Type::Int},
+    {"gallery.pca_candidates", Type::Int},
+    {"gallery.identity_prefilter", Type::Bool},
+    {"gallery.watchlists", Type::Map},
+    {"gallery.shards", Type::ObjectList},
+    {"gallery.shards[].host", Type::String},
+    {"gallery.shards[].port", Type::Int},
+    {"gallery.shards[].timeout_ms", Type::Int},
+    {"gallery.shard_timeout_ms", Type::Int},
+    {"shard", Type::Object},
+    {"shard.port", Type::Int},
+    {"shard.bind", Type::String},
+    {"strangers", Type::Object},
+    {"strangers.enabled", Type::Bool},
+    {"strangers.threshold", Type::Number},
+    {"strangers.max_clusters", Type::Int},
+    {"strangers.max_age_s", Type::Number},
+    {"strangers.min_sightings", Type::Int},
+    {"enrollment", Type::Object},
+    {"enrollment.enabled", Type::Bool},
+    {"enrollment.path", Type::String},
+    {"enrollment.max_body_kb", Type::Int},
+    {"enrollment.max_pending", Type::Int},
+    {"enrollment.compact_ratio", Type::Number},
+    {"face_lib", Type::Object},
+    {"face_lib.use_csv", Type::Bool},
+    {"face_lib.csv_path", Type::String},
+    {"face_lib.dir_path", Type::String},
+    {"face_lib.max_references", Type::Int},
+    {"record", Type::Object},
+    {"record.enabled", Type::Bool},
+    {"record.path", Type::String},
+    {"record.jpeg_quality", Type::Int},
+    {"detection", Type::Object},
+    {"detection.backend", Type::String},
+    {"detection.scale", Type::Number},
+    {"detection.adjust_threshold", Type::Number},
+    {"detection.threads", Type::Int},
+    {"detection.mmod_model", Type::String},
+    {"detection.dnn_model", Type::String},
+    {"detection.dnn_config", Type::String},
+    {"detection.dnn_confidence", Type::Number},
+    {"detection.dnn_input_size", Type::Int},
+    {"quality", Type::Object},
+    {"quality.enabled", Type::Bool},
+    {"quality.min_face_size", Type::Int},
+    {"quality.min_eye_distance", Type::Number},
+    {"quality.max_yaw", Type::Number},
+    {"quality.min_sharpness", Type::Number},
+    {"quality.track_max_missed", Type::Int},
+    {"motion", Type::Object},
+    {"motion.enabled", Type::Bool},
+    {"motion.thumbnail_width", Type::Int},
+    {"motion.pixel_threshold", Type::Int},
+    {"motion.min_changed_fraction", Type::Number},
+    {"motion.hold_frames", Type::Int},
+    {"motion.track_max_missed", Type::Int},
+    {"motion.keyframe_interval", Type::Int},
+    {"sources", Type::ObjectList},
+    {"sources[].name", Type::String},
+    {"sources[].type", Type::String},
+    {"sources[].device", Type::Int},
+    {"sources[].path", Type::String},
+    {"sources[].topic", Type::String},
+    {"sources[].realtime", Type::Bool},
+    {"sources[].loop", Type::Bool},
+    {"sources[].record_path", Type::String},
+    {"sources[].record_jpeg_quality", Type::Int},
+    {"sources[].roi", Type::Array},
+    {"sources[].watchlists", Type::StringList},
+    {"sources[].motion", Type::Object},
+    {"sources[].motion.enabled", Type::Bool},
+    {"sources[].motion.thumbnail_width", Type::Int},
+    {"sources[].motion.pixel_threshold", Type::Int},
+    {"sources[].motion.min_changed_fraction", Type::Number},
+    {"sources[].motion.hold_frames", Type::Int},
+    {"sources[].motion.track_max_missed", Type::Int},
+    {"sources[].motion.keyframe_interval", Type::Int},
+    {"replay", Type::Object},
+    {"replay.path", Type::String},
+    {"replay.realtime", Type::Bool},
+    {"replay.loop", Type::Bool},
+};
+
+const KeySpec* findSpec(const std::string& key) {
+    for (const auto& spec : kSchema) {
+        if (key == spec.key) return &spec;
+    }
+    return nullptr;
+}
+
+const char* typeName(Type type) {
+    switch (type) {
+    case Type::Bool: return "bool";
+    case Type::Int: return "integer";
+    case Type::Number: return "number";
+    case Type::String: return "string";
+    case Type::StringList: return "array of strings";
+    case Type::Array: return "array";
+    case Type::Object:
+    case Type::Map: return "object";
+    case Type::ObjectList: return "array of objects";
+    }
+    return "value";
+}
+
+bool matches(Type type, const json& value) {
+    switch (type) {
+    case Type::Bool: return value.is_boolean();
+    case Type::Int: return value.is_number_integer();
+    case Type::Number: return value.is_number();
+    case Type::String: return value.is_string();
+    case Type::StringList:
+        return value.is_array() && std::all_of(value.begin(), value.end(), [](const json& v) { return v.is_string(); });
+    case Type::Array: return value.is_array();
+    case Type::Object:
+    case Type::Map: return value.is_object();
+    case Type::ObjectList:
+        return value.is_array() && std::all_of(value.begin(), value.end(), [](const json& v) { return v.is_object(); });
+    }
+    return false;
+}
+
+// 引号里的布尔值和数字是最常见的写法错误，给出改法
+std::string hint(Type type, const json& value) {
+    if (!value.is_string()) return "";
+    const std::string& text = value.get_ref<const std::string&>();
+    if (type == Type::Bool && (text == "true" || text == "false")) return " (write " + text + " without quotes)";
+    if (type == Type::Int || type == Type::Number) {
+        std::istringstream iss(text);
+        double number = 0;
+        if (iss >> number && iss.eof()) return " (write " + text + " without quotes)";
+    }
+    return "";
+}
+
+size_t editDistance(const std::string& a, const std::string& b) {
+    std::vector<size_t> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) row[j] = j;
+    for (size_t i = 1; i <= a.size(); ++i) {
+        size_t diagonal = row[0];
+        row[0] = i;
+        for (size_t j = 1; j <= b.size(); ++j) {
+            const size_t above = row[j];
+            row[j] = std::min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] == b[j - 1] ? 0 : 1)});
+            diagonal = above;
+        }
+    }
+    return row[b.size()];
+}
+
+// 同一层里拼写最接近的已知键，用于 "did you mean"
+std::string closestKey(const std::string& spec_key) {
+    const size_t dot = spec_key.rfind('.');
+    const std::string parent = dot == std::string::npos ? "" : spec_key.substr(0, dot + 1);
+    const std::string leaf = spec_key.substr(parent.size());
+    std::string best;
+    size_t best_distance = 3;  // 最多差两个字符
+    for (const auto& spec : kSchema) {
+        const std::string key = spec.key;
+        if (key.compare(0, parent.size(), parent) != 0) continue;
+        const std::string candidate = key.substr(parent.size());
+        if (candidate.find('.') != std::string::npos) continue;
+        const size_t distance = editDistance(leaf, candidate);
+        if (distance < best_distance) {
+            best_distance = distance;
+            best = candidate;
+        }
+    }
+    return best;
+}
+
+// 逐键校验 node；path 是报错用的实际路径（含数组下标），spec_path 是表中的路径（数组元素为 "[]"）。
+// store 非空时把值按点号路径记下（数组元素内部不记，由读取方从数组中取）
+void validate(const json& node, const std::string& path, const std::string& spec_path,
+              std::unordered_map<std::string, json>* store, std::vector<std::string>& errors) {
+    for (const auto& item : node.items()) {
+        const std::string full = path.empty() ? item.key() : path + "." + item.key();
+        const std::string spec_key = spec_path.empty() ? item.key() : spec_path + "." + item.key();
+        const KeySpec* spec = findSpec(spec_key);
+        if (!spec) {
+            const std::string suggestion = closestKey(spec_key);
+            errors.push_back(full + ": unknown key" + (suggestion.empty() ? "" : " (did you mean '" + suggestion + "'?)"));
+            continue;
+        }
+        const json& value = item.value();
+        if (!matches(spec->type, value)) {
+            errors.push_back(full + ": expected " + typeName(spec->type) + ", got " + value.type_name() + " " +
+                             value.dump() + hint(spec->type, value));
+            continue;
+        }
+        if (store) (*store)[full] = value;
+        if (spec->type == Type::Object) {
+            validate(value, full, spec_key, store, errors);
+        } else if (spec->type == Type::ObjectList) {
+            for (size_t i = 0; i < value.size(); ++i) {
+                validate(value[i], full + "[" + std::to_string(i) + "]", spec_key + "[]", nullptr, errors);
+            }
+        }
+    }
+}
+
+template<typename T>
+bool holds(const json& value);
+
+template<>
+bool holds<std::string>(const json& value) { return value.is_string(); }
+template<>
+bool holds<bool>(const json& value) { return value.is_boolean(); }
+template<>
+bool holds<double>(const json& value) { return value.is_number(); }
+template<>
+bool holds<int>(const json& value) { return value.is_number(); }
+template<>
+bool holds<json>(const json&) { return true; }
+} // namespace
 
 bool ConfigParser::load(const std::string& config_path) {
     std::ifstream f(config_path);
@@ -14,33 +265,55 @@ bool ConfigParser::load(const std::string& config_path) {
         config_data_ = json::parse(f);
     } catch (json::parse_error& e) {
         std::cerr << "Error: JSON parsing failed: " << e.what() << std::endl;
+        errors_ = {e.what()};
+        return false;
+    }
+    if (!index()) {
+        for (const auto& error : errors_) {
+            std::cerr << "Error: " << config_path << ": " << error << std::endl;
+        }
         return false;
     }
     return true;
 }
 
-template<typename T>
-T ConfigParser::get(const std::string& key, const T& default_value) const {
+bool ConfigParser::loadFromString(const std::string& text) {
     try {
-        // --- START OF FIX ---
-        // 1. 先创建一个可修改的字符串
-        std::string path_key = key;
+        config_data_ = json::parse(text);
+    } catch (json::parse_error& e) {
+        errors_ = {e.what()};
+        return false;
+    }
+    return index();
+}
 
-        // 2. 在字符串上执行替换操作
-        std::replace(path_key.begin(), path_key.end(), '.', '/');
+bool ConfigParser::index() {
+    values_.clear();
+    errors_.clear();
+    settings_ = Settings();
+    if (!config_data_.is_object()) {
+        errors_.push_back("top level must be an object");
+        return false;
+    }
+    validate(config_data_, "", "", &values_, errors_);
+    if (!errors_.empty()) return false;
 
-        // 3. 用修正后的字符串创建 json_pointer
-        json::json_pointer ptr("/" + path_key);
-        // --- END OF FIX ---
+    settings_.use_camera = get<bool>("use_camera", settings_.use_camera);
+    settings_.video_path = get<std::string>("video_path", settings_.video_path);
+    settings_.face_match_threshold = get<double>("face_match_threshold", settings_.face_match_threshold);
+    settings_.debug_mode = get<bool>("debug_mode", settings_.debug_mode);
+    settings_.frame_sample_interval = std::max(1, get<int>("frame_sample_interval", settings_.frame_sample_interval));
+    return true;
+}
 
-        return config_data_.at(ptr).get<T>();
-    } catch (json::out_of_range&) {
-        // Key not found
-        return default_value;
-    } catch (json::type_error&) {
-        // Key found but type is wrong
+template<typename T>
+T ConfigParser::get(const std::string& key, const T& default_value) const {
+    // load() 时已按点号路径展开并校验过类型，这里只查表
+    const auto it = values_.find(key);
+    if (it == values_.end() || !holds<T>(it->second)) {
         return default_value;
     }
+    return it->second.get<T>();
 }
 
 // 显式实例化模板
@@ -48,6 +321,7 @@ template std::string ConfigParser::get<std::string>(const std::string&, const st
 template bool ConfigParser::get<bool>(const std::string&, const bool&) const;
 template double ConfigParser::get<double>(const std::string&, const double&) const;
 template int ConfigParser::get<int>(const std::string&, const int&) const;
+template json ConfigParser::get<json>(const std::string&, const json&) const;
 
 void ConfigParser::printAll() const {
     if (config_data_.empty()) {
@@ -0,0 +1,63 @@
+#include "DetectionRegion.h"
+
+#include <algorithm>
+#include <iostream>
+
+cv::Rect DetectionRegion::pixelRect(const cv::Size& frame_size) const {
+    cv::Rect pixels(cvFloor(rect.x * frame_size.width), cvFloor(rect.y * frame_size.height),
+                    cvCeil(rect.width * frame_size.width), cvCeil(rect.height * frame_size.height));
+    return pixels & cv::Rect(0, 0, frame_size.width, frame_size.height);
+}
+
+bool DetectionRegion::contains(const cv::Point2f& point, const cv::Size& frame_size) const {
+    const cv::Point2f normalized(point.x / frame_size.width, point.y / frame_size.height);
+    if (polygon.empty()) {
+        return rect.contains(normalized);
+    }
+    return cv::pointPolygonTest(polygon, normalized, false) >= 0;
+}
+
+std::vector<DetectionRegion> DetectionRegion::parseList(const json& list) {
+    std::vector<DetectionRegion> regions;
+    if (!list.is_array()) return regions;
+
+    for (const auto& item : list) {
+        DetectionRegion region;
+        try {
+            if (item.contains("rect")) {
+                const auto& r = item.at("rect");
+                region.rect = cv::Rect2f(r.at(0).get<float>(), r.at(1).get<float>(),
+                                         r.at(2).get<float>(), r.at(3).get<float>());
+            } else if (item.contains("polygon")) {
+                for (const auto& p : item.at("polygon")) {
+                    region.polygon.emplace_back(p.at(0).get<float>(), p.at(1).get<float>());
+                }
+                if (region.polygon.size() < 3) {
+                    std::cerr << "Warning: ROI polygon needs at least 3 points, ignored: " << item.dump() << std::endl;
+                    continue;
+                }
+                // cv::boundingRect 对浮点点集返回整数矩形，比例坐标需自己求外接矩形
+                float min_x = 1.f, min_y = 1.f, max_x = 0.f, max_y = 0.f;
+                for (const auto& p : region.polygon) {
+                    min_x = std::min(min_x, p.x);
+                    min_y = std::min(min_y, p.y);
+                    max_x = std::max(max_x, p.x);
+                    max_y = std::max(max_y, p.y);
+                }
+                region.rect = cv::Rect2f(min_x, min_y, max_x - min_x, max_y - min_y);
+            } else {
+                std::cerr << "Warning: ROI entry needs \"rect\" or \"polygon\", ignored: " << item.dump() << std::endl;
+                continue;
+            }
+        } catch (const json::exception& e) {
+            std::cerr << "Warning: Invalid ROI entry " << item.dump() << ": " << e.what() << std::endl;
+            continue;
+        }
+        if (region.rect.width <= 0 || region.rect.height <= 0) {
+            std::cerr << "Warning: Empty ROI ignored: " << item.dump() << std::endl;
+            continue;
+        }
+        regions.push_back(region);
+    }
+    return regions;
+}
@@ -0,0 +1,103 @@
+#include "EmbeddingScheduler.h"
+#include "InferenceContextPool.h"
+#include "PerformanceMonitor.h"
+
+#include <algorithm>
+
+EmbeddingScheduler::EmbeddingScheduler(InferenceContextPool& pool, const Options& options)
+    : pool_(pool), options_(options)
+{
+    if (options_.max_batch_size == 0)
+        options_.max_batch_size = 1;
+    if (options_.workers == 0)
+        options_.workers = 1;
+
+    for (size_t i = 0; i < options_.workers; ++i)
+        workers_.emplace_back(&EmbeddingScheduler::workerLoop, this);
+}
+
+EmbeddingScheduler::~EmbeddingScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    queue_changed_.notify_all();
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+std::future<EmbeddingScheduler::Descriptor> EmbeddingScheduler::submit(Chip chip)
+{
+    Request request;
+    request.chip = std::move(chip);
+    request.enqueued = Clock::now();
+    auto future = request.promise.get_future();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(request));
+    }
+    queue_changed_.notify_one();
+    return future;
+}
+
+void EmbeddingScheduler::workerLoop()
+{
+    auto& monitor = PerformanceMonitor::getInstance();
+    std::vector<Request> batch;
+    std::vector<Chip> chips;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            queue_changed_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty())
+                return;  // stopping_ 且队列已清空
+
+            // 凑批：队列未满时最多等到最早请求的截止时间
+            const auto deadline = queue_.front().enqueued + options_.max_delay;
+            queue_changed_.wait_until(lock, deadline, [this] {
+                return stopping_ || queue_.empty() || queue_.size() >= options_.max_batch_size;
+            });
+            if (queue_.empty())
+                continue;  // 被其他工作线程取走了
+
+            const size_t n = std::min(queue_.size(), options_.max_batch_size);
+            batch.clear();
+            for (size_t i = 0; i < n; ++i)
+            {
+                batch.push_back(std::move(queue_.front()));
+                queue_.pop_front();
+            }
+        }
+        // 队列里还有剩余时唤醒其他工作线程
+        queue_changed_.notify_one();
+
+        const auto dispatched = Clock::now();
+        chips.clear();
+        for (auto& request : batch)
+        {
+            monitor.recordDuration("嵌入排队等待", dispatched - request.enqueued);
+            chips.push_back(std::move(request.chip));
+        }
+        monitor.recordValue("嵌入批大小", static_cast<double>(batch.size()));
+
+        try
+        {
+            std::vector<Descriptor> descriptors;
+            {
+                auto lease = pool_.acquire();
+                PM_SCOPED(批量特征提取);
+                descriptors = lease.net()(chips, options_.max_batch_size);
+            }
+            for (size_t i = 0; i < batch.size(); ++i)
+                batch[i].promise.set_value(std::move(descriptors[i]));
+        }
+        catch (...)
+        {
+            for (auto& request : batch)
+                request.promise.set_exception(std::current_exception());
+        }
+    }
+}
@@ -0,0 +1,333 @@
+#include "EnrollmentService.h"
+#include "ConfigParser.h"
+#include "FaceRecognition.hpp"
+#include "PerformanceMonitor.h"
+
+#include <dlib/opencv.h>
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+constexpr size_t kKeptStatuses = 1024;
+
+// %XX 和 '+' 解码
+std::string urlDecode(const std::string& text) {
+    std::string out;
+    out.reserve(text.size());
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] == '+') {
+            out += ' ';
+        } else if (text[i] == '%' && i + 2 < text.size() && std::isxdigit(static_cast<unsigned char>(text[i + 1])) &&
+                   std::isxdigit(static_cast<unsigned char>(text[i + 2]))) {
+            out += static_cast<char>(std::stoi(text.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        } else {
+            out += text[i];
+        }
+    }
+    return out;
+}
+
+std::unordered_map<std::string, std::string> parseQuery(const std::string& query) {
+    std::unordered_map<std::string, std::string> params;
+    size_t start = 0;
+    while (start < query.size()) {
+        size_t end = query.find('&', start);
+        if (end == std::string::npos) end = query.size();
+        const std::string pair = query.substr(start, end - start);
+        const size_t eq = pair.find('=');
+        if (eq != std::string::npos) {
+            params[urlDecode(pair.substr(0, eq))] = urlDecode(pair.substr(eq + 1));
+        } else if (!pair.empty()) {
+            params[urlDecode(pair)] = "";
+        }
+        start = end + 1;
+    }
+    return params;
+}
+
+EnrollmentService::Reply reply(int status, const json& body) {
+    EnrollmentService::Reply result;
+    result.status = status;
+    result.body = body.dump();
+    return result;
+}
+
+EnrollmentService::Reply error(int status, const std::string& message) {
+    return reply(status, json{{"error", message}});
+}
+
+const char* stateName(EnrollmentService::JobState state) {
+    switch (state) {
+    case EnrollmentService::JobState::Queued: return "queued";
+    case EnrollmentService::JobState::Done: return "done";
+    case EnrollmentService::JobState::Failed: return "failed";
+    }
+    return "failed";
+}
+} // namespace
+
+EnrollmentOptions EnrollmentOptions::fromConfig(const ConfigParser& config) {
+    EnrollmentOptions options;
+    options.enabled = config.get<bool>("enrollment.enabled", options.enabled);
+    options.path = config.get<std::string>("enrollment.path", options.path);
+    options.max_body_bytes = static_cast<size_t>(
+        std::max(1, config.get<int>("enrollment.max_body_kb", static_cast<int>(options.max_body_bytes >> 10)))) << 10;
+    options.max_pending = static_cast<size_t>(std::max(1, config.get<int>("enrollment.max_pending", 64)));
+    options.compact_ratio = config.get<double>("enrollment.compact_ratio", options.compact_ratio);
+    options.detection = DetectionOptions::fromConfig(config);
+    return options;
+}
+
+const char* EnrollmentService::Reply::reason() const {
+    switch (status) {
+    case 200: return "OK";
+    case 202: return "Accepted";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 503: return "Service Unavailable";
+    default: return "Error";
+    }
+}
+
+EnrollmentService::EnrollmentService(FaceRecognition& recognizer, const EnrollmentOptions& options)
+    : recognizer_(recognizer), options_(options), detector_(createFaceDetector(options.detection)) {
+    worker_ = std::thread(&EnrollmentService::workerLoop, this);
+}
+
+EnrollmentService::~EnrollmentService() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (worker_.joinable()) worker_.join();
+}
+
+bool EnrollmentService::parseRequest(const EnrollmentOptions& options, const std::string& method,
+                                     const std::string& target, const std::string& content_type,
+                                     const std::string& body, Request& request, Reply& failure) {
+    const auto fail = [&failure](int status, const std::string& message) {
+        failure = error(status, message);
+        return false;
+    };
+    const size_t question = target.find('?');
+    const std::string path = target.substr(0, question);
+    if (path != options.path) return fail(404, "not found");
+    const auto params = parseQuery(question == std::string::npos ? "" : target.substr(question + 1));
+    const auto param = [&params](const std::string& key) {
+        const auto it = params.find(key);
+        return it == params.end() ? std::string() : it->second;
+    };
+
+    request = Request();
+    if (method == "GET") {
+        const std::string job = param("job");
+        if (job.empty()) return fail(400, "missing job");
+        if (!std::all_of(job.begin(), job.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); }))
+            return fail(400, "invalid job");
+        try {
+            request.job = static_cast<size_t>(std::stoull(job));
+        } catch (const std::exception&) {
+            return fail(400, "invalid job");
+        }
+        request.kind = Kind::Status;
+        return true;
+    }
+
+    if (body.size() > options.max_body_bytes) return fail(413, "request body too large");
+
+    request.name = param("name");
+    if (method == "POST" || method == "PUT") {
+        request.replace = method == "PUT";
+        if (content_type.rfind("application/json", 0) == 0) {
+            const json parsed = json::parse(body, nullptr, false);
+            if (parsed.is_discarded() || !parsed.is_object()) return fail(400, "invalid JSON body");
+            // 字段类型来自客户端，逐个检查后再读取，不能让 nlohmann 抛出 type_error
+            const auto name = parsed.find("name");
+            if (name != parsed.end()) {
+                if (!name->is_string()) return fail(400, "name must be a string");
+                if (request.name.empty()) request.name = name->get<std::string>();
+            }
+            const auto values = parsed.find("descriptor");
+            if (values == parsed.end() || !values->is_array() || values->empty()) return fail(400, "missing descriptor");
+            for (const auto& value : *values) {
+                if (!value.is_number()) return fail(400, "descriptor must be an array of numbers");
+                request.descriptor.push_back(value.get<float>());
+            }
+            if (request.name.empty()) return fail(400, "missing name");
+            request.kind = Kind::Descriptor;
+        } else {
+            if (request.name.empty()) return fail(400, "missing name");
+            if (body.empty()) return fail(400, "missing image");
+            request.image = body;
+            request.kind = Kind::Image;
+        }
+        return true;
+    }
+    if (method == "DELETE") {
+        if (request.name.empty()) return fail(400, "missing name");
+        request.kind = Kind::Remove;
+        return true;
+    }
+    return fail(405, "method not allowed");
+}
+
+EnrollmentService::Reply EnrollmentService::handle(const std::string& method, const std::string& target,
+                                                   const std::string& content_type, const std::string& body) {
+    // 在推流的监听线程上运行，异常逃出去会结束整个进程
+    try {
+        Request request;
+        Reply failure;
+        if (!parseRequest(options_, method, target, content_type, body, request, failure)) return failure;
+
+        if (request.kind == Kind::Status) {
+            const JobStatus result = status(request.job);
+            if (result.state == JobState::Failed && result.message.empty()) return error(404, "unknown job");
+            return reply(200, json{{"job", request.job}, {"state", stateName(result.state)}, {"message", result.message}});
+        }
+        Job job;
+        static_cast<Request&>(job) = std::move(request);
+        const size_t id = enqueue(std::move(job));
+        if (id == 0) return error(503, "enrollment queue is full");
+        return reply(202, json{{"job", id}});
+    } catch (const std::exception& e) {
+        return error(400, e.what());
+    }
+}
+
+size_t EnrollmentService::submitImage(const std::string& name, std::string image, bool replace) {
+    Job job;
+    job.kind = Kind::Image;
+    job.name = name;
+    job.image = std::move(image);
+    job.replace = replace;
+    return enqueue(std::move(job));
+}
+
+size_t EnrollmentService::submitDescriptor(const std::string& name, std::vector<float> descriptor, bool replace) {
+    Job job;
+    job.kind = Kind::Descriptor;
+    job.name = name;
+    job.descriptor = std::move(descriptor);
+    job.replace = replace;
+    return enqueue(std::move(job));
+}
+
+size_t EnrollmentService::submitRemove(const std::string& name) {
+    Job job;
+    job.kind = Kind::Remove;
+    job.name = name;
+    return enqueue(std::move(job));
+}
+
+size_t EnrollmentService::enqueue(Job job) {
+    size_t id = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (stopping_ || queue_.size() >= options_.max_pending) return 0;
+        id = next_id_++;
+        job.id = id;
+        queue_.push_back(std::move(job));
+        statuses_[id] = JobStatus{JobState::Queued, ""};
+        status_order_.push_back(id);
+        while (status_order_.size() > kKeptStatuses) {
+            statuses_.erase(status_order_.front());
+            status_order_.pop_front();
+        }
+    }
+    changed_.notify_all();
+    return id;
+}
+
+EnrollmentService::JobStatus EnrollmentService::status(size_t job) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = statuses_.find(job);
+    return it == statuses_.end() ? JobStatus{} : it->second;
+}
+
+void EnrollmentService::waitIdle() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    changed_.wait(lock, [this] { return stopping_ || (queue_.empty() && !busy_); });
+}
+
+void EnrollmentService::finish(size_t id, JobState state, const std::string& message) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto it = statuses_.find(id);
+    if (it != statuses_.end()) it->second = JobStatus{state, message};
+}
+
+void EnrollmentService::workerLoop() {
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            busy_ = false;
+            changed_.notify_all();
+            changed_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            job = std::move(queue_.front());
+            queue_.pop_front();
+            busy_ = true;
+        }
+
+        try {
+            PM_SCOPED(在线登记);
+            const std::string message = run(job);
+            std::cout << "Enrollment job " << job.id << ": " << message << std::endl;
+            finish(job.id, JobState::Done, message);
+        } catch (const std::exception& e) {
+            std::cerr << "Enrollment job " << job.id << " for '" << job.name << "' failed: " << e.what() << std::endl;
+            finish(job.id, JobState::Failed, e.what());
+        }
+        compactIfNeeded();
+    }
+}
+
+std::string EnrollmentService::run(const Job& job) {
+    if (job.kind == Kind::Remove) {
+        const size_t removed = recognizer_.removePerson(job.name);
+        if (removed == 0) throw std::runtime_error("unknown person '" + job.name + "'");
+        return "removed " + std::to_string(removed) + " references of '" + job.name + "'";
+    }
+
+    dlib::matrix<float,0,1> descriptor;
+    if (job.kind == Kind::Descriptor) {
+        descriptor = dlib::mat(job.descriptor);
+    } else {
+        // 与建库相同：恰好一张人脸，5 点对齐后提取 150x150 芯片
+        const std::vector<uchar> bytes(job.image.begin(), job.image.end());
+        const cv::Mat bgr = cv::imdecode(bytes, cv::IMREAD_COLOR);
+        if (bgr.empty()) throw std::runtime_error("cannot decode image");
+        const auto faces = detector_->detect(bgr);
+        if (faces.size() != 1) throw std::runtime_error("found " + std::to_string(faces.size()) + " faces, expected 1");
+
+        dlib::cv_image<dlib::bgr_pixel> image(bgr);
+        const auto shape = recognizer_.getShapePredictor()(image, faces[0]);
+        dlib::matrix<dlib::rgb_pixel> chip;
+        dlib::extract_image_chip(image, dlib::get_face_chip_details(shape, 150, 0.25), chip);
+        descriptor = recognizer_.computeDescriptor(chip);
+    }
+
+    if (job.replace) {
+        recognizer_.replacePerson(job.name, descriptor);
+        return "replaced references of '" + job.name + "'";
+    }
+    recognizer_.enrollDescriptor(job.name, descriptor);
+    return "enrolled '" + job.name + "'";
+}
+
+void EnrollmentService::compactIfNeeded() {
+    const size_t tombstones = recognizer_.libraryTombstones();
+    const size_t size = recognizer_.librarySize();
+    if (tombstones == 0 || size == 0 || static_cast<double>(tombstones) / size < options_.compact_ratio) return;
+    const auto start = PerformanceMonitor::Clock::now();
+    recognizer_.compactLibrary();
+    PerformanceMonitor::getInstance().recordDuration("人脸库压缩", PerformanceMonitor::Clock::now() - start);
+    std::cout << "Compacted face library: removed " << tombstones << " tombstones." << std::endl;
+}
@@ -0,0 +1,194 @@
+#include "FaceChipBatch.h"
+#include "FaceQuality.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+// v = v0 + d * c 满足 0 <= v < limit 的列 c 与 [begin, end) 求交。
+// 浮点误差可能让端点差一列，调用方再用逐点判断校正
+void clipColumns(double v0, double d, double limit, long& begin, long& end) {
+    if (d == 0) {
+        if (!(v0 >= 0 && v0 < limit)) end = begin;
+        return;
+    }
+    double lo = -v0 / d;
+    double hi = (limit - v0) / d;
+    if (d < 0) std::swap(lo, hi);
+    const double chip = static_cast<double>(FaceChipBatch::kChipSize);
+    begin = std::max(begin, static_cast<long>(std::clamp(std::ceil(lo), 0.0, chip)));
+    end = std::min(end, static_cast<long>(std::clamp(std::ceil(hi), 0.0, chip)));
+    if (end < begin) end = begin;
+}
+} // namespace
+
+void FaceChipBatch::reset(size_t count) {
+    tensor_.set_size(static_cast<long long>(count), 3, kChipSize, kChipSize);
+}
+
+void FaceChipBatch::write(size_t index, const cv::Mat& bgr, const dlib::chip_details& details) {
+    // 芯片坐标 -> 帧坐标：src = M * (c, r) + b
+    const dlib::point_transform_affine to_image = dlib::inv(dlib::get_mapping_to_chip(details));
+    double m00 = to_image.get_m()(0, 0), m01 = to_image.get_m()(0, 1);
+    double m10 = to_image.get_m()(1, 0), m11 = to_image.get_m()(1, 1);
+    double bx = to_image.get_b().x(), by = to_image.get_b().y();
+
+    // 源区域比芯片大很多时，逐点双线性采样会混叠；与 extract_image_chip 一样先缩小。
+    // 只缩小芯片覆盖的那块区域，按 2 的幂整数倍做面积平均
+    const cv::Mat* source = &bgr;
+    const double scale = std::sqrt(std::abs(m00 * m11 - m01 * m10));
+    int factor = 1;
+    while (scale / factor > 2.0) factor *= 2;
+    if (factor > 1) {
+        double min_x = bx, max_x = bx, min_y = by, max_y = by;
+        for (const auto& corner : {dlib::dpoint(kChipSize - 1, 0), dlib::dpoint(0, kChipSize - 1),
+                                   dlib::dpoint(kChipSize - 1, kChipSize - 1)}) {
+            const dlib::dpoint p = to_image(corner);
+            min_x = std::min(min_x, p.x());
+            max_x = std::max(max_x, p.x());
+            min_y = std::min(min_y, p.y());
+            max_y = std::max(max_y, p.y());
+        }
+        cv::Rect region(cvFloor(min_x) - factor, cvFloor(min_y) - factor,
+                        cvCeil(max_x - min_x) + 2 * factor + 1, cvCeil(max_y - min_y) + 2 * factor + 1);
+        region &= cv::Rect(0, 0, bgr.cols, bgr.rows);
+        // 对齐到 factor 的整数倍，缩小后的像素与原图块一一对应
+        region.width -= region.width % factor;
+        region.height -= region.height % factor;
+        if (region.width > 0 && region.height > 0) {
+            cv::resize(bgr(region), shrunk_, cv::Size(region.width / factor, region.height / factor), 0, 0,
+                       cv::INTER_AREA);
+            source = &shrunk_;
+            // 缩小图中像素 j 的中心对应原图 region.x + j*factor + (factor-1)/2
+            const double offset = (factor - 1) / 2.0;
+            bx = (bx - region.x - offset) / factor;
+            by = (by - region.y - offset) / factor;
+            m00 /= factor;
+            m01 /= factor;
+            m10 /= factor;
+            m11 /= factor;
+        }
+    }
+
+    const long plane = kChipSize * kChipSize;
+    float* red = tensor_.host() + index * 3 * plane;
+    float* green = red + plane;
+    float* blue = green + plane;
+    const float scale_out = 1.0f / 256.0f;
+    const float zero_red = -means_.red * scale_out;
+    const float zero_green = -means_.green * scale_out;
+    const float zero_blue = -means_.blue * scale_out;
+    const int cols = source->cols;
+    const int rows = source->rows;
+
+    const uchar* data = source->data;
+    const size_t step = source->step;
+
+    // 双线性采样一个像素并减均值写入三个平面；调用方保证 2x2 邻域在图像内
+    const auto sample = [&](long i, double x, double y) {
+        const int x0 = static_cast<int>(x);  // x、y 非负，截断即向下取整
+        const int y0 = static_cast<int>(y);
+        const float fx = static_cast<float>(x - x0);
+        const float fy = static_cast<float>(y - y0);
+        const float w00 = (1 - fx) * (1 - fy), w01 = fx * (1 - fy);
+        const float w10 = (1 - fx) * fy, w11 = fx * fy;
+        const uchar* p0 = data + y0 * step + 3 * x0;
+        const uchar* p1 = p0 + step;
+
+        const float b = p0[0] * w00 + p0[3] * w01 + p1[0] * w10 + p1[3] * w11;
+        const float g = p0[1] * w00 + p0[4] * w01 + p1[1] * w10 + p1[4] * w11;
+        const float rr = p0[2] * w00 + p0[5] * w01 + p1[2] * w10 + p1[5] * w11;
+        red[i] = (rr - means_.red) * scale_out;
+        green[i] = (g - means_.green) * scale_out;
+        blue[i] = (b - means_.blue) * scale_out;
+    };
+
+    for (long r = 0; r < kChipSize; ++r) {
+        const double x_row = m01 * r + bx;
+        const double y_row = m11 * r + by;
+        const long row_offset = r * kChipSize;
+        const auto inside = [&](long c) {
+            const double x = x_row + m00 * c;
+            const double y = y_row + m10 * c;
+            return x >= 0 && y >= 0 && x < cols - 1 && y < rows - 1;
+        };
+
+        // 芯片的一行在源图中是一条线段：先求出 2x2 邻域都在图像内的列区间 [begin, end)，
+        // 区间内不做边界判断；区间按同一公式逐端校正，只会偏窄，不会把越界的列放进来
+        long begin = 0, end = kChipSize;
+        clipColumns(x_row, m00, cols - 1, begin, end);
+        clipColumns(y_row, m10, rows - 1, begin, end);
+        while (begin < end && !inside(begin)) ++begin;
+        while (end > begin && !inside(end - 1)) --end;
+
+        // 区间两侧：仍在图像内的照常采样，落在图像外的与 dlib 一致为黑色
+        const auto border = [&](long c) {
+            if (inside(c)) {
+                sample(row_offset + c, x_row + m00 * c, y_row + m10 * c);
+            } else {
+                red[row_offset + c] = zero_red;
+                green[row_offset + c] = zero_green;
+                blue[row_offset + c] = zero_blue;
+            }
+        };
+        for (long c = 0; c < begin; ++c) border(c);
+        for (long c = begin; c < end; ++c) {
+            sample(row_offset + c, x_row + m00 * c, y_row + m10 * c);
+        }
+        for (long c = end; c < kChipSize; ++c) border(c);
+    }
+}
+
+double FaceChipBatch::sharpness(size_t index) const {
+    const long plane = kChipSize * kChipSize;
+    const float* red = tensor_.host() + index * 3 * plane;
+    const float* green = red + plane;
+    const float* blue = green + plane;
+
+    std::vector<float> gray(plane);
+    for (long i = 0; i < plane; ++i) {
+        const float r = red[i] * 256.0f + means_.red;
+        const float g = green[i] * 256.0f + means_.green;
+        const float b = blue[i] * 256.0f + means_.blue;
+        gray[i] = (r * 77 + g * 150 + b * 29) / 256.0f;
+    }
+    return grayLaplacianVariance(gray, kChipSize, kChipSize);
+}
+
+void FaceChipBatch::keep(const std::vector<size_t>& indices) {
+    bool identity = indices.size() == size();
+    for (size_t i = 0; identity && i < indices.size(); ++i) {
+        identity = indices[i] == i;
+    }
+    if (identity) return;
+
+    // 只有质量门控丢掉了部分芯片时才会走到这里；dlib 张量缩小会重新分配，只能整体拷贝一次
+    const long sample = 3 * kChipSize * kChipSize;
+    dlib::resizable_tensor kept;
+    kept.set_size(static_cast<long long>(indices.size()), 3, kChipSize, kChipSize);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        std::memcpy(kept.host() + i * sample, tensor_.host() + indices[i] * sample, sample * sizeof(float));
+    }
+    tensor_ = std::move(kept);
+}
+
+dlib::matrix<dlib::rgb_pixel> FaceChipBatch::chip(size_t index) const {
+    const long plane = kChipSize * kChipSize;
+    const float* red = tensor_.host() + index * 3 * plane;
+    const float* green = red + plane;
+    const float* blue = green + plane;
+
+    auto to_byte = [](float v, float mean) {
+        return static_cast<unsigned char>(std::clamp(std::lround(v * 256.0f + mean), 0L, 255L));
+    };
+    dlib::matrix<dlib::rgb_pixel> out(kChipSize, kChipSize);
+    for (long r = 0; r < kChipSize; ++r) {
+        for (long c = 0; c < kChipSize; ++c) {
+            const long i = r * kChipSize + c;
+            out(r, c) = dlib::rgb_pixel(to_byte(red[i], means_.red), to_byte(green[i], means_.green),
+                                        to_byte(blue[i], means_.blue));
+        }
+    }
+    return out;
+}
@@ -0,0 +1,135 @@
+#include "FaceDetector.h"
+#include "PyramidDetector.h"
+
+#include <dlib/dnn.h>
+#include <dlib/opencv.h>
+#include <opencv2/dnn.hpp>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+// dlib 官方 mmod_human_face_detector.dat 对应的网络结构
+template <long num_filters, typename SUBNET> using con5d = dlib::con<num_filters,5,5,2,2,SUBNET>;
+template <long num_filters, typename SUBNET> using con5  = dlib::con<num_filters,5,5,1,1,SUBNET>;
+template <typename SUBNET> using downsampler = dlib::relu<dlib::affine<con5d<32, dlib::relu<dlib::affine<con5d<32,
+                                               dlib::relu<dlib::affine<con5d<16,SUBNET>>>>>>>>>;
+template <typename SUBNET> using rcon5 = dlib::relu<dlib::affine<con5<45,SUBNET>>>;
+using mmod_net_type = dlib::loss_mmod<dlib::con<1,9,9,1,1,rcon5<rcon5<rcon5<downsampler<
+                      dlib::input_rgb_image_pyramid<dlib::pyramid_down<6>>>>>>>>;
+
+// dlib MMOD CNN 检测器
+class MmodFaceDetector : public FaceDetector {
+public:
+    explicit MmodFaceDetector(const DetectionOptions& options) : options_(options) {
+        try {
+            dlib::deserialize(options_.mmod_model) >> net_;
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Failed to load MMOD model '" + options_.mmod_model + "': " + e.what());
+        }
+    }
+
+    std::vector<dlib::rectangle> detect(const cv::Mat& bgr) override {
+        // 网络自带图像金字塔，这里只负责降分辨率和转成 RGB
+        cv::Mat scaled = bgr;
+        if (options_.scale < 1.0) {
+            cv::resize(bgr, scaled, cv::Size(), options_.scale, options_.scale, cv::INTER_AREA);
+        }
+        dlib::assign_image(image_, dlib::cv_image<dlib::bgr_pixel>(scaled));
+
+        std::vector<dlib::rectangle> faces;
+        const double sx = static_cast<double>(bgr.cols) / scaled.cols;
+        const double sy = static_cast<double>(bgr.rows) / scaled.rows;
+        for (const auto& det : net_.process(image_, options_.adjust_threshold)) {
+            const dlib::rectangle& r = det.rect;
+            faces.emplace_back(std::lround(r.left() * sx), std::lround(r.top() * sy),
+                               std::lround((r.right() + 1) * sx) - 1, std::lround((r.bottom() + 1) * sy) - 1);
+        }
+        return faces;
+    }
+
+    std::string name() const override { return "mmod"; }
+
+private:
+    DetectionOptions options_;
+    mmod_net_type net_;
+    dlib::matrix<dlib::rgb_pixel> image_;
+};
+
+// OpenCV DNN + ResNet-10 SSD 检测器。
+// SSD 的框比 HOG/MMOD 的略松，5 点形状预测器对此不敏感，芯片对齐结果基本一致。
+class OpenCvDnnFaceDetector : public FaceDetector {
+public:
+    explicit OpenCvDnnFaceDetector(const DetectionOptions& options) : options_(options) {
+        try {
+            net_ = cv::dnn::readNetFromCaffe(options_.dnn_config, options_.dnn_model);
+        } catch (const cv::Exception& e) {
+            throw std::runtime_error("Failed to load OpenCV DNN face model '" + options_.dnn_model + "': " + e.what());
+        }
+        if (net_.empty()) {
+            throw std::runtime_error("Failed to load OpenCV DNN face model '" + options_.dnn_model + "'");
+        }
+        net_.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
+        net_.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+    }
+
+    std::vector<dlib::rectangle> detect(const cv::Mat& bgr) override {
+        const cv::Size input_size(options_.dnn_input_size, options_.dnn_input_size);
+        cv::dnn::blobFromImage(bgr, blob_, 1.0, input_size, cv::Scalar(104.0, 177.0, 123.0), false, false);
+        net_.setInput(blob_);
+        const cv::Mat output = net_.forward();
+
+        // 输出形状 [1, 1, N, 7]：image_id, label, confidence, x1, y1, x2, y2（比例坐标）
+        const cv::Mat detections(output.size[2], output.size[3], CV_32F, const_cast<float*>(output.ptr<float>()));
+        std::vector<dlib::rectangle> faces;
+        for (int i = 0; i < detections.rows; ++i) {
+            if (detections.at<float>(i, 2) < options_.dnn_confidence) continue;
+            const long left = std::max(0L, std::lround(detections.at<float>(i, 3) * bgr.cols));
+            const long top = std::max(0L, std::lround(detections.at<float>(i, 4) * bgr.rows));
+            const long right = std::min<long>(bgr.cols - 1, std::lround(detections.at<float>(i, 5) * bgr.cols));
+            const long bottom = std::min<long>(bgr.rows - 1, std::lround(detections.at<float>(i, 6) * bgr.rows));
+            if (right > left && bottom > top) faces.emplace_back(left, top, right, bottom);
+        }
+        return faces;
+    }
+
+    std::string name() const override { return "opencv_dnn"; }
+
+private:
+    DetectionOptions options_;
+    cv::dnn::Net net_;
+    cv::Mat blob_;
+};
+} // namespace
+
+DetectionOptions DetectionOptions::fromConfig(const ConfigParser& config) {
+    DetectionOptions options;
+    options.backend = config.get<std::string>("detection.backend", options.backend);
+    options.scale = config.get<double>("detection.scale", options.scale);
+    options.adjust_threshold = config.get<double>("detection.adjust_threshold", options.adjust_threshold);
+    options.threads = static_cast<size_t>(std::max(0, config.get<int>("detection.threads", 1)));
+    options.mmod_model = config.get<std::string>("detection.mmod_model", options.mmod_model);
+    options.dnn_model = config.get<std::string>("detection.dnn_model", options.dnn_model);
+    options.dnn_config = config.get<std::string>("detection.dnn_config", options.dnn_config);
+    options.dnn_confidence = config.get<double>("detection.dnn_confidence", options.dnn_confidence);
+    options.dnn_input_size = config.get<int>("detection.dnn_input_size", options.dnn_input_size);
+    if (options.scale <= 0.0 || options.scale > 1.0) {
+        std::cerr << "Warning: detection.scale must be in (0, 1], using 1.0" << std::endl;
+        options.scale = 1.0;
+    }
+    return options;
+}
+
+std::unique_ptr<FaceDetector> createFaceDetector(const DetectionOptions& options) {
+    if (options.backend == "hog") {
+        return std::make_unique<PyramidDetector>(options);
+    }
+    if (options.backend == "mmod") {
+        return std::make_unique<MmodFaceDetector>(options);
+    }
+    if (options.backend == "opencv_dnn") {
+        return std::make_unique<OpenCvDnnFaceDetector>(options);
+    }
+    throw std::runtime_error("Unknown detection.backend '" + options.backend + "' (expected hog, mmod or opencv_dnn)");
+}
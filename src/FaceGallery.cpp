@@ -0,0 +1,893 @@
+#include "FaceGallery.h"
+
+#include <dlib/matrix/matrix_la.h>
+#include <dlib/serialize.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__AVX2__) || defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace {
+// --- 半精度转换（无 F16C 指令时的软件实现，舍入到最近偶数） ---
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t raw_exponent = (bits >> 23) & 0xffu;
+    uint32_t mantissa = bits & 0x7fffffu;
+    if (raw_exponent == 0xffu) return static_cast<uint16_t>(sign | 0x7c00u | (mantissa ? 0x200u : 0u));
+
+    const int exponent = static_cast<int>(raw_exponent) - 127 + 15;
+    if (exponent >= 31) return static_cast<uint16_t>(sign | 0x7c00u);
+    if (exponent <= 0) {
+        if (exponent < -10) return static_cast<uint16_t>(sign);
+        mantissa |= 0x800000u;
+        const int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (rest > halfway || (rest == halfway && (half & 1u))) ++half;
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    const uint32_t rest = mantissa & 0x1fffu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) ++half;  // 进位溢出到指数时正好变成无穷大
+    return static_cast<uint16_t>(sign | half);
+}
+
+float halfToFloat(uint16_t half) {
+    const uint32_t sign = (half & 0x8000u) << 16;
+    int exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ffu;
+    uint32_t bits;
+    if (exponent == 0) {
+        if (mantissa == 0) {
+            bits = sign;
+        } else {
+            // 非规格化数：左移直到出现隐含的最高位
+            exponent = 1;
+            while (!(mantissa & 0x400u)) {
+                mantissa <<= 1;
+                --exponent;
+            }
+            bits = sign | (static_cast<uint32_t>(exponent + 127 - 15) << 23) | ((mantissa & 0x3ffu) << 13);
+        }
+    } else if (exponent == 31) {
+        bits = sign | 0x7f800000u | (mantissa << 13);
+    } else {
+        bits = sign | (static_cast<uint32_t>(exponent + 127 - 15) << 23) | (mantissa << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+// --- 扫描内核。没有开启 FACEREC_NATIVE_ARCH 时由编译器自动向量化 ---
+
+// 8 路独立累加，不依赖 -ffast-math 也能向量化
+float squaredDistance(const float* a, const float* b, long n) {
+    float lanes[8] = {};
+    long i = 0;
+    for (; i + 8 <= n; i += 8) {
+        for (int k = 0; k < 8; ++k) {
+            const float d = a[i + k] - b[i + k];
+            lanes[k] += d * d;
+        }
+    }
+    float total = 0.f;
+    for (float lane : lanes) total += lane;
+    for (; i < n; ++i) {
+        const float d = a[i] - b[i];
+        total += d * d;
+    }
+    return total;
+}
+
+int32_t dotInt8(const int8_t* a, const int8_t* b, long n) {
+    long i = 0;
+    int32_t total = 0;
+#if defined(__AVX2__)
+    // 16 个 int8 符号扩展成 int16，madd 相邻两两相乘相加得到 8 个 int32
+    __m256i acc = _mm256_setzero_si256();
+    for (; i + 16 <= n; i += 16) {
+        const __m256i va = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + i)));
+        const __m256i vb = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(b + i)));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(va, vb));
+    }
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(acc), _mm256_extracti128_si256(acc, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    total = _mm_cvtsi128_si32(sum);
+#endif
+    for (; i < n; ++i) total += static_cast<int32_t>(a[i]) * b[i];
+    return total;
+}
+
+float squaredDistanceHalf(const float* query, const uint16_t* half, long n) {
+    long i = 0;
+    float total = 0.f;
+#if defined(__F16C__) && defined(__AVX__)
+    __m256 acc = _mm256_setzero_ps();
+    for (; i + 8 <= n; i += 8) {
+        const __m256 g = _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(half + i)));
+        const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(query + i), g);
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(d, d));
+    }
+    alignas(32) float lanes[8];
+    _mm256_store_ps(lanes, acc);
+    for (float lane : lanes) total += lane;
+#endif
+    for (; i < n; ++i) {
+        const float d = query[i] - halfToFloat(half[i]);
+        total += d * d;
+    }
+    return total;
+}
+
+// 对称量化到 [-127, 127]，返回缩放系数（原值 ≈ 码值 * 系数）
+float quantizeInt8(const float* values, long n, int8_t* codes) {
+    float max_abs = 0.f;
+    for (long i = 0; i < n; ++i) max_abs = std::max(max_abs, std::abs(values[i]));
+    const float scale = max_abs > 0.f ? max_abs / 127.f : 1.f;
+    for (long i = 0; i < n; ++i) {
+        codes[i] = static_cast<int8_t>(std::lround(values[i] / scale));
+    }
+    return scale;
+}
+
+// 批量检索时每次与多少个库条目做矩阵乘法：得分矩阵为 查询数 x kGemmBlockRows，留在缓存中
+constexpr long kGemmBlockRows = 4096;
+
+// 批量检索时展开式 |q|^2 + |g|^2 - 2 q·g 在距离很近的条目之间会因相消失去精度，
+// 每个查询保留这么多个候选，按定义精确重算后再取最近
+constexpr size_t kBatchRescoreCandidates = 8;
+
+// 学习 PCA 时最多使用的条目数（等间隔抽样），百万级人脸库也只需几十毫秒算协方差
+constexpr size_t kPcaSamples = 20000;
+
+constexpr uint32_t kIndexFileVersion = 2;
+
+// 保留距离最小的 k 个 (距离平方, 下标)：最大堆，堆顶是目前第 k 小的候选
+class TopK {
+public:
+    explicit TopK(size_t k) : k_(k) { items_.reserve(k + 1); }
+
+    void push(float distance, size_t index) {
+        if (k_ == 0) return;
+        if (items_.size() == k_) {
+            if (!(distance < items_.front().first)) return;
+            std::pop_heap(items_.begin(), items_.end());
+            items_.pop_back();
+        }
+        items_.emplace_back(distance, index);
+        std::push_heap(items_.begin(), items_.end());
+    }
+
+    const std::vector<std::pair<float, size_t>>& items() const { return items_; }
+
+private:
+    size_t k_;
+    std::vector<std::pair<float, size_t>> items_;
+};
+} // namespace
+
+GalleryOptions GalleryOptions::fromConfig(const ConfigParser& config) {
+    GalleryOptions options;
+    options.storage = config.get<std::string>("gallery.storage", options.storage);
+    options.rerank = config.get<int>("gallery.rerank", options.rerank);
+    options.pca_dims = config.get<int>("gallery.pca_dims", options.pca_dims);
+    options.pca_candidates = config.get<int>("gallery.pca_candidates", options.pca_candidates);
+    options.identity_prefilter = config.get<bool>("gallery.identity_prefilter", options.identity_prefilter);
+    return options;
+}
+
+FaceGallery::Storage FaceGallery::parseStorage(const std::string& name) {
+    if (name == "float") return Storage::Float;
+    if (name == "int8") return Storage::Int8;
+    if (name == "fp16") return Storage::Half;
+    throw std::runtime_error("Unknown gallery storage '" + name + "' (expected float, int8 or fp16)");
+}
+
+FaceGallery::FaceGallery(const GalleryOptions& options)
+    : storage_(parseStorage(options.storage)),
+      rerank_(static_cast<size_t>(std::max(0, options.rerank))),
+      pca_dims_(static_cast<size_t>(std::max(0, options.pca_dims))),
+      pca_candidates_(static_cast<size_t>(std::max(1, options.pca_candidates))),
+      identity_prefilter_(options.identity_prefilter) {}
+
+void FaceGallery::add(const std::string& name, const dlib::matrix<float,0,1>& descriptor) {
+    if (descriptor.size() == 0) return;
+    if (dim_ == 0) {
+        dim_ = descriptor.size();
+    } else if (descriptor.size() != dim_) {
+        throw std::invalid_argument("Descriptor for '" + name + "' has " + std::to_string(descriptor.size()) +
+                                    " dimensions, gallery has " + std::to_string(dim_));
+    }
+
+    auto [it, inserted] = identity_of_.emplace(name, identities_.size());
+    if (inserted) {
+        identities_.push_back(name);
+        members_.emplace_back();
+        identity_tags_.push_back(kLiveBit);
+    }
+    const size_t identity = it->second;
+    const size_t index = entry_identity_.size();
+    entry_identity_.push_back(static_cast<uint32_t>(identity));
+    entry_tags_.push_back(identity_tags_[identity]);
+    members_[identity].push_back(index);
+    store(index, &descriptor(0));
+    if (identity_index_) updateIdentity(identity);
+}
+
+uint64_t FaceGallery::watchlistBit(const std::string& watchlist) {
+    auto it = watchlists_.find(watchlist);
+    if (it == watchlists_.end()) {
+        if (watchlists_.size() >= 63) {
+            throw std::runtime_error("Too many watchlists (at most 63), cannot add '" + watchlist + "'");
+        }
+        it = watchlists_.emplace(watchlist, static_cast<int>(watchlists_.size())).first;
+    }
+    return 1ull << it->second;
+}
+
+uint64_t FaceGallery::watchlistMask(const std::vector<std::string>& watchlists) const {
+    if (watchlists.empty()) return kAllWatchlists;
+    uint64_t mask = 0;
+    for (const auto& watchlist : watchlists) {
+        const auto it = watchlists_.find(watchlist);
+        if (it == watchlists_.end()) throw std::runtime_error("Unknown watchlist '" + watchlist + "'");
+        mask |= 1ull << it->second;
+    }
+    return mask;
+}
+
+bool FaceGallery::addToWatchlist(const std::string& name, const std::string& watchlist) {
+    const auto it = identity_of_.find(name);
+    if (it == identity_of_.end()) return false;
+    const uint64_t tags = identity_tags_[it->second] | watchlistBit(watchlist);
+    identity_tags_[it->second] = tags;
+    for (size_t index : members_[it->second]) entry_tags_[index] = tags;
+    return true;
+}
+
+std::vector<std::string> FaceGallery::watchlistNames(uint64_t watchlists) const {
+    std::vector<std::string> names;
+    if (watchlists == kAllWatchlists) return names;
+    for (const auto& [name, bit] : watchlists_) {
+        if (watchlists & (1ull << bit)) names.push_back(name);
+    }
+    return names;
+}
+
+void FaceGallery::loadWatchlists(const json& watchlists) {
+    if (!watchlists.is_object()) return;
+    for (const auto& [watchlist, members] : watchlists.items()) {
+        std::vector<std::string> names;
+        if (members.is_array()) {
+            for (const auto& member : members) {
+                if (member.is_string()) names.push_back(member.get<std::string>());
+            }
+        } else if (members.is_string()) {
+            std::ifstream file(members.get<std::string>());
+            if (!file.is_open()) throw std::runtime_error("Cannot open watchlist file: " + members.get<std::string>());
+            std::string line;
+            while (std::getline(file, line)) {
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                if (!line.empty()) names.push_back(line);
+            }
+        }
+
+        // 名单即使一个人都没有也要定义，引用它的视频流就不会匹配到任何人
+        watchlistBit(watchlist);
+        size_t tagged = 0;
+        for (const auto& name : names) {
+            if (addToWatchlist(name, watchlist)) {
+                ++tagged;
+            } else {
+                std::cerr << "Warning: watchlist '" << watchlist << "' lists unknown person '" << name << "'."
+                          << std::endl;
+            }
+        }
+        std::cout << "Watchlist '" << watchlist << "': " << tagged << " people." << std::endl;
+    }
+}
+
+size_t FaceGallery::loadCsv(const std::string& path) {
+    std::ifstream fin(path);
+    if (!fin.is_open()) return 0;
+
+    std::string line;
+    size_t count = 0;
+    while (std::getline(fin, line)) {
+        std::istringstream iss(line);
+        std::string name;
+        if (!std::getline(iss, name, ',')) continue;
+
+        std::vector<float> values;
+        float v;
+        while (iss >> v) values.push_back(v);
+        if (values.empty()) continue;
+
+        try {
+            add(name, dlib::mat(values));
+        } catch (const std::invalid_argument& e) {
+            std::cerr << "Skipping CSV entry: " << e.what() << std::endl;
+            continue;
+        }
+        ++count;
+    }
+    return count;
+}
+
+size_t FaceGallery::remove(const std::string& name) {
+    const auto it = identity_of_.find(name);
+    if (it == identity_of_.end()) return 0;
+    auto& members = members_[it->second];
+    const size_t removed = members.size();
+    for (size_t index : members) entry_tags_[index] = 0;
+    members.clear();
+    tombstones_ += removed;
+    if (identity_index_) updateIdentity(it->second);
+    return removed;
+}
+
+void FaceGallery::compact() {
+    if (tombstones_ == 0) return;
+    const size_t n = static_cast<size_t>(dim_);
+    const size_t pd = projected_dims_;
+    // 按原顺序把有效条目前移：目标位置不超过源位置，逐段复制不会覆盖尚未读取的数据
+    auto move_slice = [](auto& values, size_t width, size_t from, size_t to) {
+        if (values.empty() || width == 0) return;
+        std::copy(values.begin() + from * width, values.begin() + (from + 1) * width, values.begin() + to * width);
+    };
+
+    constexpr size_t kDropped = std::numeric_limits<size_t>::max();
+    std::vector<size_t> identity_map(identities_.size(), kDropped);
+    std::vector<std::string> identities;
+    std::vector<uint64_t> identity_tags;
+    size_t out = 0;
+    for (size_t i = 0; i < entry_identity_.size(); ++i) {
+        if (!(entry_tags_[i] & kLiveBit)) continue;
+        const size_t identity = entry_identity_[i];
+        if (identity_map[identity] == kDropped) {
+            identity_map[identity] = identities.size();
+            identities.push_back(std::move(identities_[identity]));
+            identity_tags.push_back(identity_tags_[identity]);
+        }
+        if (out != i) {
+            entry_tags_[out] = entry_tags_[i];
+            move_slice(floats_, n, i, out);
+            move_slice(codes_, n, i, out);
+            move_slice(halves_, n, i, out);
+            move_slice(scales_, 1, i, out);
+            move_slice(sq_norms_, 1, i, out);
+            move_slice(projected_, pd, i, out);
+        }
+        entry_identity_[out] = static_cast<uint32_t>(identity_map[identity]);
+        ++out;
+    }
+
+    auto shrink = [out](auto& values, size_t width) {
+        if (values.empty()) return;
+        values.resize(out * width);
+        values.shrink_to_fit();
+    };
+    shrink(entry_identity_, 1);
+    shrink(entry_tags_, 1);
+    shrink(floats_, n);
+    shrink(codes_, n);
+    shrink(halves_, n);
+    shrink(scales_, 1);
+    shrink(sq_norms_, 1);
+    shrink(projected_, pd);
+
+    identities_ = std::move(identities);
+    identity_tags_ = std::move(identity_tags);
+    identity_of_.clear();
+    for (size_t identity = 0; identity < identities_.size(); ++identity) identity_of_[identities_[identity]] = identity;
+    members_.assign(identities_.size(), {});
+    for (size_t i = 0; i < entry_identity_.size(); ++i) members_[entry_identity_[i]].push_back(i);
+    tombstones_ = 0;
+    if (identity_index_) buildIdentityIndex();
+}
+
+void FaceGallery::store(size_t index, const float* values) {
+    const size_t n = static_cast<size_t>(dim_);
+    const size_t count = index + 1;
+    const bool keep_floats = storage_ == Storage::Float || rerank_ > 0;
+    if (keep_floats) {
+        floats_.resize(count * n);
+        std::copy(values, values + n, floats_.begin() + index * n);
+    }
+    float sq_norm = 0.f;
+    for (size_t i = 0; i < n; ++i) sq_norm += values[i] * values[i];
+    sq_norms_.resize(count);
+    sq_norms_[index] = sq_norm;
+
+    switch (storage_) {
+    case Storage::Float:
+        break;
+    case Storage::Int8: {
+        codes_.resize(count * n);
+        scales_.resize(count);
+        scales_[index] = quantizeInt8(values, dim_, &codes_[index * n]);
+        break;
+    }
+    case Storage::Half:
+        halves_.resize(count * n);
+        for (size_t i = 0; i < n; ++i) halves_[index * n + i] = floatToHalf(values[i]);
+        break;
+    }
+
+    // 已有 PCA 索引时新条目直接投影，投影矩阵不变
+    if (projected_dims_ > 0) {
+        projected_.resize(count * projected_dims_);
+        project(values, &projected_[index * projected_dims_]);
+    }
+}
+
+void FaceGallery::decode(size_t index, float* out) const {
+    const size_t n = static_cast<size_t>(dim_);
+    const size_t offset = index * n;
+    if (!floats_.empty()) {
+        std::copy(floats_.begin() + offset, floats_.begin() + offset + n, out);
+    } else if (storage_ == Storage::Int8) {
+        for (size_t i = 0; i < n; ++i) out[i] = codes_[offset + i] * scales_[index];
+    } else {
+        for (size_t i = 0; i < n; ++i) out[i] = halfToFloat(halves_[offset + i]);
+    }
+}
+
+void FaceGallery::project(const float* values, float* out) const {
+    for (size_t j = 0; j < projected_dims_; ++j) {
+        const float* axis = &pca_basis_[j * static_cast<size_t>(dim_)];
+        float sum = 0.f;
+        for (long c = 0; c < dim_; ++c) sum += axis[c] * (values[c] - pca_mean_[c]);
+        out[j] = sum;
+    }
+}
+
+void FaceGallery::buildIndex() {
+    buildIdentityIndex();
+    buildPcaIndex();
+}
+
+void FaceGallery::buildIdentityIndex() {
+    // 每个身份多于一张参考特征时才值得先按身份剪枝；每人一张时与全量扫描相同，只会多一层开销
+    identity_index_ = identity_prefilter_ && entry_identity_.size() > identities_.size();
+    centroids_.clear();
+    radii_.clear();
+    if (!identity_index_) return;
+    centroids_.resize(identities_.size() * static_cast<size_t>(dim_));
+    radii_.resize(identities_.size());
+    for (size_t identity = 0; identity < identities_.size(); ++identity) updateIdentity(identity);
+}
+
+void FaceGallery::updateIdentity(size_t identity) {
+    const size_t n = static_cast<size_t>(dim_);
+    if (centroids_.size() < (identity + 1) * n) {
+        centroids_.resize((identity + 1) * n);
+        radii_.resize(identity + 1);
+    }
+
+    // 质心为成员特征的均值，半径为成员到质心的最大距离；参考特征全部删除的身份检索时直接跳过
+    float* centroid = &centroids_[identity * n];
+    std::fill(centroid, centroid + n, 0.f);
+    radii_[identity] = 0.f;
+    const auto& members = members_[identity];
+    if (members.empty()) return;
+    std::vector<float> row(n);
+    for (size_t index : members) {
+        decode(index, row.data());
+        for (size_t c = 0; c < n; ++c) centroid[c] += row[c];
+    }
+    for (size_t c = 0; c < n; ++c) centroid[c] /= static_cast<float>(members.size());
+    float radius_sq = 0.f;
+    for (size_t index : members) {
+        decode(index, row.data());
+        radius_sq = std::max(radius_sq, squaredDistance(row.data(), centroid, dim_));
+    }
+    radii_[identity] = std::sqrt(radius_sq);
+}
+
+void FaceGallery::buildPcaIndex() {
+    projected_dims_ = 0;
+    projected_.clear();
+    pca_basis_.clear();
+    pca_mean_.clear();
+    const size_t n = entry_identity_.size();
+    if (pca_dims_ == 0 || n < 2) return;
+    const long k = std::min(static_cast<long>(pca_dims_), dim_);
+
+    // 在抽样条目上求均值和协方差
+    const size_t stride = std::max<size_t>(1, n / kPcaSamples);
+    std::vector<float> row(static_cast<size_t>(dim_));
+    dlib::matrix<double,0,1> mean = dlib::zeros_matrix<double>(dim_, 1);
+    size_t samples = 0;
+    for (size_t i = 0; i < n; i += stride, ++samples) {
+        decode(i, row.data());
+        mean += dlib::matrix_cast<double>(dlib::mat(row));
+    }
+    mean /= static_cast<double>(samples);
+    dlib::matrix<double> cov = dlib::zeros_matrix<double>(dim_, dim_);
+    for (size_t i = 0; i < n; i += stride) {
+        decode(i, row.data());
+        const dlib::matrix<double,0,1> centered = dlib::matrix_cast<double>(dlib::mat(row)) - mean;
+        cov += centered * dlib::trans(centered);
+    }
+    cov /= static_cast<double>(std::max<size_t>(1, samples - 1));
+
+    // 取方差最大的 k 个主成分作为投影轴
+    dlib::eigenvalue_decomposition<dlib::matrix<double>> eig(dlib::make_symmetric(cov));
+    const dlib::matrix<double,0,1> values = eig.get_real_eigenvalues();
+    const dlib::matrix<double>& vectors = eig.get_pseudo_v();
+    std::vector<long> order(static_cast<size_t>(dim_));
+    for (long c = 0; c < dim_; ++c) order[c] = c;
+    std::sort(order.begin(), order.end(), [&values](long a, long b) { return values(a) > values(b); });
+
+    pca_mean_.resize(static_cast<size_t>(dim_));
+    for (long c = 0; c < dim_; ++c) pca_mean_[c] = static_cast<float>(mean(c));
+    pca_basis_.resize(static_cast<size_t>(k * dim_));
+    for (long j = 0; j < k; ++j) {
+        for (long c = 0; c < dim_; ++c) pca_basis_[j * dim_ + c] = static_cast<float>(vectors(c, order[j]));
+    }
+    projected_dims_ = static_cast<size_t>(k);
+
+    // 投影全部条目：分块解码后一次矩阵乘法，再减去均值的投影
+    projected_.resize(n * projected_dims_);
+    const dlib::matrix<float> basis = dlib::mat(pca_basis_.data(), k, dim_);
+    const dlib::matrix<float,0,1> mean_projection = basis * dlib::mat(pca_mean_);
+    dlib::matrix<float> block, block_projection;
+    for (long start = 0; start < static_cast<long>(n); start += kGemmBlockRows) {
+        const long rows = std::min(kGemmBlockRows, static_cast<long>(n) - start);
+        block.set_size(rows, dim_);
+        for (long r = 0; r < rows; ++r) decode(static_cast<size_t>(start + r), &block(r, 0));
+        block_projection = block * dlib::trans(basis);
+        for (long r = 0; r < rows; ++r) {
+            float* out = &projected_[static_cast<size_t>(start + r) * projected_dims_];
+            for (long j = 0; j < k; ++j) out[j] = block_projection(r, j) - mean_projection(j);
+        }
+    }
+}
+
+uint64_t FaceGallery::fingerprint() const {
+    // FNV-1a：条目的身份、顺序和特征（按存储格式解码后的值，与学习投影时用的一致）都相同
+    // 才认为是同一个人脸库；只比模长的话，特征重新提取后模长仍为 1，旧索引会被误用
+    uint64_t hash = 1469598103934665603ull;
+    auto mix = [&hash](const void* data, size_t bytes) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < bytes; ++i) {
+            hash ^= p[i];
+            hash *= 1099511628211ull;
+        }
+    };
+    mix(&dim_, sizeof(dim_));
+    mix(&storage_, sizeof(storage_));
+    std::vector<float> values(static_cast<size_t>(dim_));
+    for (size_t i = 0; i < entry_identity_.size(); ++i) {
+        const std::string& name = identities_[entry_identity_[i]];
+        mix(name.data(), name.size() + 1);
+        decode(i, values.data());
+        mix(values.data(), values.size() * sizeof(float));
+    }
+    return hash;
+}
+
+bool FaceGallery::saveIndex(const std::string& path) const {
+    if (!hasIndex()) return false;
+    try {
+        dlib::serialize(path) << kIndexFileVersion << static_cast<uint64_t>(entry_identity_.size()) << fingerprint()
+                              << static_cast<uint64_t>(projected_dims_) << pca_mean_ << pca_basis_ << projected_;
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to save gallery index " << path << ": " << e.what() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool FaceGallery::loadIndex(const std::string& path) {
+    if (pca_dims_ == 0 || entry_identity_.empty()) return false;
+    uint32_t version = 0;
+    uint64_t count = 0, hash = 0, dims = 0;
+    std::vector<float> mean, basis, projected;
+    try {
+        dlib::deserialize(path) >> version >> count >> hash >> dims >> mean >> basis >> projected;
+    } catch (const std::exception&) {
+        return false;
+    }
+    // 人脸库或 pca_dims 变了就重新学习
+    const size_t expected_dims = std::min(pca_dims_, static_cast<size_t>(dim_));
+    if (version != kIndexFileVersion || count != entry_identity_.size() || hash != fingerprint() || dims != expected_dims ||
+        mean.size() != static_cast<size_t>(dim_) || basis.size() != dims * dim_ || projected.size() != count * dims) {
+        return false;
+    }
+    pca_mean_ = std::move(mean);
+    pca_basis_ = std::move(basis);
+    projected_ = std::move(projected);
+    projected_dims_ = static_cast<size_t>(dims);
+    buildIdentityIndex();
+    return true;
+}
+
+float FaceGallery::approxSquaredDistance(size_t index, const float* query, const int8_t* query_codes,
+                                         float query_scale, float query_sq_norm) const {
+    const size_t offset = index * static_cast<size_t>(dim_);
+    switch (storage_) {
+    case Storage::Int8: {
+        // |q - g|^2 = |q|^2 + |g|^2 - 2 q·g，只有点积是近似的
+        const float dot = dotInt8(query_codes, &codes_[offset], dim_) * query_scale * scales_[index];
+        return std::max(0.f, query_sq_norm + sq_norms_[index] - 2.f * dot);
+    }
+    case Storage::Half:
+        return squaredDistanceHalf(query, &halves_[offset], dim_);
+    case Storage::Float:
+    default:
+        return squaredDistance(query, &floats_[offset], dim_);
+    }
+}
+
+float FaceGallery::entryDistance(size_t index, const float* query, const int8_t* query_codes, float query_scale,
+                                 float query_sq_norm) const {
+    // 有原始特征时精确计算，否则按存储格式近似
+    return floats_.empty() ? approxSquaredDistance(index, query, query_codes, query_scale, query_sq_norm)
+                           : squaredDistance(query, &floats_[index * static_cast<size_t>(dim_)], dim_);
+}
+
+FaceGallery::Hit FaceGallery::nearestByIdentity(const float* query, const int8_t* query_codes, float query_scale,
+                                                float query_sq_norm, uint64_t required) const {
+    // 三角不等式：身份内任一成员到查询的距离 >= |q - 质心| - 半径。
+    // 先算出每个身份的下界建成最小堆，按下界从小到大展开成员，下界不小于当前最优距离时停止；
+    // 结果与全量扫描相同，身份越紧凑、相互离得越远，剪掉的越多
+    // 不在所选名单内的身份连质心距离都不算
+    std::vector<std::pair<float, size_t>> bounds;
+    bounds.reserve(identities_.size());
+    for (size_t identity = 0; identity < identities_.size(); ++identity) {
+        if (members_[identity].empty() || !(identity_tags_[identity] & required)) continue;
+        const float to_centroid =
+            std::sqrt(squaredDistance(query, &centroids_[identity * static_cast<size_t>(dim_)], dim_));
+        // 留一点余量，避免舍入误差剪掉真正的最近邻
+        bounds.emplace_back(std::max(0.f, to_centroid - radii_[identity]) * 0.9999f, identity);
+    }
+    auto greater = [](const std::pair<float, size_t>& a, const std::pair<float, size_t>& b) { return a > b; };
+    std::make_heap(bounds.begin(), bounds.end(), greater);
+
+    Hit best;
+    double best_sq = std::numeric_limits<double>::infinity();
+    while (!bounds.empty()) {
+        const auto [bound, identity] = bounds.front();
+        if (static_cast<double>(bound) * bound >= best_sq) break;
+        std::pop_heap(bounds.begin(), bounds.end(), greater);
+        bounds.pop_back();
+        for (size_t index : members_[identity]) {
+            const double d = entryDistance(index, query, query_codes, query_scale, query_sq_norm);
+            if (d < best_sq || (d == best_sq && index < best.index)) {
+                best_sq = d;
+                best.index = index;
+            }
+        }
+    }
+    best.distance = std::sqrt(best_sq);
+    return best;
+}
+
+FaceGallery::Hit FaceGallery::nearest(const dlib::matrix<float,0,1>& query, uint64_t watchlists) const {
+    Hit best;
+    best.distance = std::numeric_limits<double>::infinity();
+    if (entry_identity_.empty() || query.size() != dim_) return best;
+
+    const float* q = &query(0);
+    std::vector<int8_t> query_codes;
+    float query_scale = 1.f;
+    float query_sq_norm = 0.f;
+    if (storage_ == Storage::Int8) {
+        query_codes.resize(static_cast<size_t>(dim_));
+        query_scale = quantizeInt8(q, dim_, query_codes.data());
+        for (long i = 0; i < dim_; ++i) query_sq_norm += q[i] * q[i];
+    }
+
+    const uint64_t required = requiredTags(watchlists);
+    if (hasIndex()) return nearestWithIndex(q, query_codes.data(), query_scale, query_sq_norm, required);
+    if (identity_index_) return nearestByIdentity(q, query_codes.data(), query_scale, query_sq_norm, required);
+
+    // float 存储或不精排：一遍扫描取最小值
+    if (storage_ == Storage::Float || rerank_ == 0) {
+        float best_sq = std::numeric_limits<float>::infinity();
+        for (size_t i = 0; i < entry_identity_.size(); ++i) {
+            if (!visible(i, required)) continue;
+            const float d = approxSquaredDistance(i, q, query_codes.data(), query_scale, query_sq_norm);
+            if (d < best_sq) {
+                best_sq = d;
+                best.index = i;
+            }
+        }
+        best.distance = std::sqrt(static_cast<double>(best_sq));
+        return best;
+    }
+
+    // 量化扫描保留近似距离最小的 rerank_ 个候选，再用原始特征精排
+    TopK candidates(rerank_);
+    for (size_t i = 0; i < entry_identity_.size(); ++i) {
+        if (!visible(i, required)) continue;
+        candidates.push(approxSquaredDistance(i, q, query_codes.data(), query_scale, query_sq_norm), i);
+    }
+    double best_sq = std::numeric_limits<double>::infinity();
+    for (const auto& candidate : candidates.items()) {
+        const size_t offset = candidate.second * static_cast<size_t>(dim_);
+        const double d = squaredDistance(q, &floats_[offset], dim_);
+        if (d < best_sq || (d == best_sq && candidate.second < best.index)) {
+            best_sq = d;
+            best.index = candidate.second;
+        }
+    }
+    best.distance = std::sqrt(best_sq);
+    return best;
+}
+
+FaceGallery::Hit FaceGallery::nearestWithIndex(const float* query, const int8_t* query_codes, float query_scale,
+                                               float query_sq_norm, uint64_t required) const {
+    // 粗筛：在 PCA 低维投影上扫描，投影距离不超过真实距离，取最小的 pca_candidates_ 个
+    std::vector<float> projected_query(projected_dims_);
+    project(query, projected_query.data());
+    TopK shortlist(pca_candidates_);
+    for (size_t i = 0; i < entry_identity_.size(); ++i) {
+        if (!visible(i, required)) continue;
+        shortlist.push(squaredDistance(projected_query.data(), &projected_[i * projected_dims_],
+                                       static_cast<long>(projected_dims_)), i);
+    }
+
+    // 精排：候选上计算完整维度的距离
+    Hit best;
+    double best_sq = std::numeric_limits<double>::infinity();
+    for (const auto& candidate : shortlist.items()) {
+        const size_t i = candidate.second;
+        const double d = entryDistance(i, query, query_codes, query_scale, query_sq_norm);
+        if (d < best_sq || (d == best_sq && i < best.index)) {
+            best_sq = d;
+            best.index = i;
+        }
+    }
+    best.distance = std::sqrt(best_sq);
+    return best;
+}
+
+std::vector<FaceGallery::Hit> FaceGallery::search(const dlib::matrix<float,0,1>& query, size_t k,
+                                                  uint64_t watchlists) const {
+    std::vector<Hit> hits;
+    if (k == 0 || entry_identity_.empty() || query.size() != dim_) return hits;
+    if (k == 1) {
+        const Hit hit = nearest(query, watchlists);
+        if (std::isfinite(hit.distance)) hits.push_back(hit);
+        return hits;
+    }
+
+    const float* q = &query(0);
+    std::vector<int8_t> query_codes;
+    float query_scale = 1.f;
+    float query_sq_norm = 0.f;
+    if (storage_ == Storage::Int8) {
+        query_codes.resize(static_cast<size_t>(dim_));
+        query_scale = quantizeInt8(q, dim_, query_codes.data());
+        for (long i = 0; i < dim_; ++i) query_sq_norm += q[i] * q[i];
+    }
+
+    // 候选：有 PCA 索引时取投影距离最小的若干个，否则按存储格式的近似距离取；候选再计算精排距离
+    std::vector<float> projected_query;
+    if (hasIndex()) {
+        projected_query.resize(projected_dims_);
+        project(q, projected_query.data());
+    }
+    const uint64_t required = requiredTags(watchlists);
+    TopK candidates(std::max(k, hasIndex() ? pca_candidates_ : rerank_));
+    for (size_t i = 0; i < entry_identity_.size(); ++i) {
+        if (!visible(i, required)) continue;
+        candidates.push(hasIndex() ? squaredDistance(projected_query.data(), &projected_[i * projected_dims_],
+                                                     static_cast<long>(projected_dims_))
+                                   : approxSquaredDistance(i, q, query_codes.data(), query_scale, query_sq_norm),
+                        i);
+    }
+    for (const auto& candidate : candidates.items()) {
+        Hit hit;
+        hit.index = candidate.second;
+        hit.distance = std::sqrt(static_cast<double>(
+            entryDistance(hit.index, q, query_codes.data(), query_scale, query_sq_norm)));
+        hits.push_back(hit);
+    }
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) {
+        return a.distance < b.distance || (a.distance == b.distance && a.index < b.index);
+    });
+    if (hits.size() > k) hits.resize(k);
+    return hits;
+}
+
+std::vector<FaceGallery::Hit> FaceGallery::nearestBatch(const std::vector<dlib::matrix<float,0,1>>& queries,
+                                                       uint64_t watchlists) const {
+    // 身份剪枝只影响逐个检索的速度：这里对所有条目做矩阵乘法，候选精确重算后结果相同，不必退回逐个检索
+    if (storage_ != Storage::Float || queries.size() < 2 || hasIndex()) {
+        std::vector<Hit> hits;
+        hits.reserve(queries.size());
+        for (const auto& query : queries) hits.push_back(nearest(query, watchlists));
+        return hits;
+    }
+
+    std::vector<Hit> hits(queries.size());
+    for (auto& hit : hits) hit.distance = std::numeric_limits<double>::infinity();
+    if (entry_identity_.empty()) return hits;
+
+    // 维数正确的查询按行拼成矩阵
+    std::vector<size_t> valid;
+    for (size_t j = 0; j < queries.size(); ++j) {
+        if (queries[j].size() == dim_) valid.push_back(j);
+    }
+    const long m = static_cast<long>(valid.size());
+    if (m == 0) return hits;
+    dlib::matrix<float> q(m, dim_);
+    std::vector<float> query_sq_norms(valid.size());
+    for (long j = 0; j < m; ++j) {
+        const auto& query = queries[valid[j]];
+        dlib::set_rowm(q, j) = dlib::trans(query);
+        query_sq_norms[j] = dlib::dot(query, query);
+    }
+
+    // 分块计算 Q * G^T（mat() 直接引用连续存储，不拷贝；开启 DLIB_USE_BLAS 时为一次 sgemm），
+    // 在得分矩阵上取每行距离最小的几个候选
+    const uint64_t required = requiredTags(watchlists);
+    std::vector<TopK> candidates(valid.size(), TopK(kBatchRescoreCandidates));
+    const long n = static_cast<long>(entry_identity_.size());
+    dlib::matrix<float> scores;
+    for (long start = 0; start < n; start += kGemmBlockRows) {
+        const long rows = std::min(kGemmBlockRows, n - start);
+        scores = q * dlib::trans(dlib::mat(&floats_[static_cast<size_t>(start * dim_)], rows, dim_));
+        for (long j = 0; j < m; ++j) {
+            const float* row = &scores(j, 0);
+            const float* norms = &sq_norms_[static_cast<size_t>(start)];
+            for (long i = 0; i < rows; ++i) {
+                if (!visible(static_cast<size_t>(start + i), required)) continue;
+                candidates[j].push(query_sq_norms[j] + norms[i] - 2.f * row[i], static_cast<size_t>(start + i));
+            }
+        }
+    }
+
+    // 候选的距离按定义精确重算，取最小者（距离相同取下标小的，与 nearest 的逐条扫描一致）
+    for (long j = 0; j < m; ++j) {
+        const float* query = &queries[valid[j]](0);
+        float best_sq = std::numeric_limits<float>::infinity();
+        size_t best_index = 0;
+        for (const auto& candidate : candidates[j].items()) {
+            const float d = squaredDistance(query, &floats_[candidate.second * static_cast<size_t>(dim_)], dim_);
+            if (d < best_sq || (d == best_sq && candidate.second < best_index)) {
+                best_sq = d;
+                best_index = candidate.second;
+            }
+        }
+        if (std::isinf(best_sq)) continue;  // 所选名单内没有条目
+        Hit& hit = hits[valid[j]];
+        hit.index = best_index;
+        hit.distance = std::sqrt(static_cast<double>(best_sq));
+    }
+    return hits;
+}
+
+size_t FaceGallery::rerankCopyBytes() const {
+    return storage_ == Storage::Float ? 0 : floats_.capacity() * sizeof(float);
+}
+
+size_t FaceGallery::memoryBytes() const {
+    size_t bytes = floats_.capacity() * sizeof(float) + codes_.capacity() * sizeof(int8_t) +
+                   scales_.capacity() * sizeof(float) + sq_norms_.capacity() * sizeof(float) +
+                   halves_.capacity() * sizeof(uint16_t) + pca_mean_.capacity() * sizeof(float) +
+                   pca_basis_.capacity() * sizeof(float) + projected_.capacity() * sizeof(float);
+    bytes += entry_identity_.capacity() * sizeof(uint32_t) + centroids_.capacity() * sizeof(float) +
+             radii_.capacity() * sizeof(float) + entry_tags_.capacity() * sizeof(uint64_t) +
+             identity_tags_.capacity() * sizeof(uint64_t);
+    for (const auto& name : identities_) bytes += sizeof(name) + name.capacity();
+    for (const auto& members : members_) bytes += sizeof(members) + members.capacity() * sizeof(size_t);
+    return bytes;
+}
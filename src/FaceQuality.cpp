@@ -0,0 +1,87 @@
+#include "FaceQuality.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+QualityOptions QualityOptions::fromConfig(const ConfigParser& config) {
+    QualityOptions options;
+    options.enabled = config.get<bool>("quality.enabled", options.enabled);
+    options.min_face_size = config.get<int>("quality.min_face_size", options.min_face_size);
+    options.min_eye_distance = config.get<double>("quality.min_eye_distance", options.min_eye_distance);
+    options.max_yaw = config.get<double>("quality.max_yaw", options.max_yaw);
+    options.min_sharpness = config.get<double>("quality.min_sharpness", options.min_sharpness);
+    options.track_max_missed = config.get<int>("quality.track_max_missed", options.track_max_missed);
+    return options;
+}
+
+bool faceLargeEnough(const dlib::rectangle& face, const QualityOptions& options) {
+    return std::min(face.width(), face.height()) >= static_cast<unsigned long>(std::max(0, options.min_face_size));
+}
+
+double grayLaplacianVariance(const std::vector<float>& gray, long rows, long cols) {
+    if (rows < 3 || cols < 3) return 0.0;
+
+    double sum = 0.0;
+    double sum_sq = 0.0;
+    for (long r = 1; r + 1 < rows; ++r) {
+        const float* row = &gray[r * cols];
+        for (long c = 1; c + 1 < cols; ++c) {
+            const double lap = row[c - 1] + row[c + 1] + row[c - cols] + row[c + cols] - 4.0 * row[c];
+            sum += lap;
+            sum_sq += lap * lap;
+        }
+    }
+    const double n = static_cast<double>((rows - 2) * (cols - 2));
+    const double mean = sum / n;
+    return sum_sq / n - mean * mean;
+}
+
+QualityScore assessFaceQuality(const dlib::full_object_detection& shape, double sharpness,
+                               const QualityOptions& options) {
+    QualityScore score;
+
+    // 5 点模型：0/1 和 2/3 分别是两只眼睛的眼角，4 是鼻尖下方
+    if (shape.num_parts() == 5) {
+        const dlib::dpoint eye_a = (dlib::dpoint(shape.part(0)) + dlib::dpoint(shape.part(1))) / 2;
+        const dlib::dpoint eye_b = (dlib::dpoint(shape.part(2)) + dlib::dpoint(shape.part(3))) / 2;
+        const dlib::dpoint nose = shape.part(4);
+        const dlib::dpoint axis = eye_b - eye_a;
+        score.eye_distance = axis.length();
+        if (score.eye_distance > 0) {
+            // 正脸时鼻尖落在两眼连线的中垂线上；转头越多，沿眼睛连线方向的偏移越大
+            const dlib::dpoint offset = nose - (eye_a + eye_b) / 2;
+            score.yaw = std::abs(offset.dot(axis)) / (score.eye_distance * score.eye_distance);
+        }
+        if (score.eye_distance < options.min_eye_distance) {
+            score.passed = false;
+            score.reason = "eyes";
+            return score;
+        }
+        if (score.yaw > options.max_yaw) {
+            score.passed = false;
+            score.reason = "yaw";
+            return score;
+        }
+    }
+
+    score.sharpness = sharpness;
+    if (score.sharpness < options.min_sharpness) {
+        score.passed = false;
+        score.reason = "blur";
+    }
+    return score;
+}
+
+QualityScore assessFaceQuality(const dlib::full_object_detection& shape,
+                               const dlib::matrix<dlib::rgb_pixel>& chip,
+                               const QualityOptions& options) {
+    std::vector<float> gray(chip.size());
+    for (long r = 0; r < chip.nr(); ++r) {
+        for (long c = 0; c < chip.nc(); ++c) {
+            const dlib::rgb_pixel& p = chip(r, c);
+            gray[r * chip.nc() + c] = (p.red * 77 + p.green * 150 + p.blue * 29) / 256.0f;
+        }
+    }
+    return assessFaceQuality(shape, grayLaplacianVariance(gray, chip.nr(), chip.nc()), options);
+}
@@ -1,35 +1,133 @@
 #include "FaceRecognition.hpp"
 #include "ConfigParser.h"
+#include "EmbeddingScheduler.h"
+#include "FaceDetector.h"
+#include "GalleryShard.h"
+#include "InferenceContextPool.h"
+#include "MemoryTracker.h"
+#include "PerformanceMonitor.h"
+#include "StrangerClusters.h"
 
-#include <dlib/image_processing/frontal_face_detector.h>
 #include <dlib/image_io.h>
+#include <dlib/opencv.h>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
+#include <future>
 #include <sstream>
+#include <stdexcept>
 
 namespace dr = dlib;
 
 FaceRecognition::FaceRecognition(const ConfigParser& config)
 {
     std::cout << "Initializing FaceRecognition module..." << std::endl;
-    loadModels(config);
+    face_match_threshold_ = config.settings().face_match_threshold;
+    const auto gallery_options = GalleryOptions::fromConfig(config);
+    face_library_ = FaceGallery(gallery_options);
+    const auto stranger_options = StrangerOptions::fromConfig(config);
+    if (stranger_options.enabled)
+        strangers_ = std::make_unique<StrangerClusters>(stranger_options);
 
-    face_match_threshold_ = config.get<double>("face_match_threshold", 0.6);
+    // 分片协调模式：人脸库由各分片进程持有，本进程只提取特征并把查询发给分片。
+    // 配置加载时已按表校验过 gallery.shards 是对象数组、各字段类型正确，这里可以直接用 value()
+    const json shard_list = config.get<json>("gallery.shards", json::array());
+    if (shard_list.is_array() && !shard_list.empty())
+    {
+        std::vector<ShardEndpoint> endpoints;
+        for (const auto& item : shard_list)
+        {
+            ShardEndpoint endpoint;
+            endpoint.host = item.value("host", endpoint.host);
+            endpoint.port = item.value("port", endpoint.port);
+            endpoint.timeout_ms = item.value("timeout_ms", endpoint.timeout_ms);
+            endpoints.push_back(endpoint);
+        }
+        const auto timeout = std::chrono::milliseconds(config.get<int>("gallery.shard_timeout_ms", 50));
+        shards_ = std::make_unique<ShardedGallery>(std::move(endpoints), timeout);
+        std::cout << "Gallery coordinator mode: " << shards_->shardCount() << " shards, default timeout "
+                  << timeout.count() << " ms." << std::endl;
+    }
 
-    bool use_csv = config.get<bool>("face_lib.use_csv", false);
+    // 人脸库中不依赖模型的部分（读 CSV、解码图片并检测人脸）与模型加载并行进行
+    const bool use_csv = !shards_ && config.get<bool>("face_lib.use_csv", false);
+    const bool use_dir = !shards_ && !use_csv;
+    std::future<void> csv_loaded;
+    std::future<std::vector<LibraryImage>> images_prepared;
     if (use_csv)
     {
         const auto csv_path = config.get<std::string>("face_lib.csv_path", "");
-        loadLibraryFromCSV(csv_path);
+        csv_loaded = std::async(std::launch::async, [this, csv_path] {
+            ScopedStartupPhase phase("人脸库: 读取 CSV");
+            loadLibraryFromCSV(csv_path);
+        });
     }
-    else
+    else if (use_dir)
     {
         const auto dir_path = config.get<std::string>("face_lib.dir_path", "");
-        buildFaceLibrary(dir_path);
+        const auto detection = DetectionOptions::fromConfig(config);
+        const int max_references = config.get<int>("face_lib.max_references", 0);
+        images_prepared = std::async(std::launch::async, [this, dir_path, detection, max_references] {
+            ScopedStartupPhase phase("人脸库: 解码与检测");
+            return prepareLibraryImages(dir_path, detection, max_references > 0 ? max_references : 0);
+        });
+    }
+
+    loadModels(config);
+
+    if (use_csv)
+    {
+        csv_loaded.get();
+    }
+    else if (use_dir)
+    {
+        auto images = images_prepared.get();
+        ScopedStartupPhase phase("人脸库: 特征提取");
+        buildFaceLibrary(images);
+    }
+    const json watchlists = config.get<json>("gallery.watchlists", json::object());
+    if (shards_)
+    {
+        // 协调方只记录名单的名字，名单成员在各分片上
+        for (const auto& item : watchlists.items())
+            face_library_.watchlistBit(item.key());
+    }
+    else
+    {
+        // CSV 人脸库的 PCA 索引保存在 CSV 旁边，下次启动直接加载；目录人脸库每次重新学习
+        buildLibraryIndex(use_csv && gallery_options.pca_dims > 0
+                              ? config.get<std::string>("face_lib.csv_path", "") + ".pca" : "");
+        face_library_.loadWatchlists(watchlists);
+    }
+    MemoryTracker::getInstance().setComponentBytes("人脸库", libraryMemoryBytes());
+
+    // 建库完成后再创建推理池，副本从干净的网络复制
+    const int contexts = config.get<int>("inference.contexts", 1);
+    pool_ = std::make_unique<InferenceContextPool>(net_, contexts > 0 ? contexts : 1);
+
+    if (config.get<bool>("inference.batching.enabled", false))
+    {
+        EmbeddingScheduler::Options options;
+        // 负数转成 size_t 会变成极大的批，先夹到至少 1
+        const int max_batch_size = config.get<int>("inference.batching.max_batch_size", 8);
+        options.max_batch_size = static_cast<size_t>(std::max(1, max_batch_size));
+        options.max_delay = std::chrono::microseconds(
+            static_cast<long long>(config.get<double>("inference.batching.max_delay_ms", 5.0) * 1000));
+        options.workers = pool_->size();
+        scheduler_ = std::make_unique<EmbeddingScheduler>(*pool_, options);
+        std::cout << "Embedding batching enabled: max batch " << options.max_batch_size
+                  << ", max delay " << options.max_delay.count() / 1000.0 << " ms." << std::endl;
     }
 }
 
+// scheduler_ 的工作线程使用 pool_，必须先停止
+FaceRecognition::~FaceRecognition()
+{
+    scheduler_.reset();
+}
+
 void FaceRecognition::loadModels(const ConfigParser& config)
 {
     const auto sp_path  = config.get<std::string>("models.shape_predictor", "");
@@ -37,11 +135,24 @@ void FaceRecognition::loadModels(const ConfigParser& config)
     if (sp_path.empty() || net_path.empty())
         throw std::runtime_error("Model paths missing in config.");
 
-    dr::deserialize(sp_path) >> sp_;
-    std::cout << "Shape predictor loaded from: " << sp_path << std::endl;
+    // 两个模型互不依赖，并行反序列化
+    auto sp_loaded = std::async(std::launch::async, [this, sp_path] {
+        ScopedStartupPhase phase("加载形状预测器");
+        dr::deserialize(sp_path) >> sp_;
+    });
+    {
+        ScopedStartupPhase phase("加载 ResNet 模型");
+        dr::deserialize(net_path) >> net_;
+    }
+    sp_loaded.get();
 
-    dr::deserialize(net_path) >> net_;
+    std::cout << "Shape predictor loaded from: " << sp_path << std::endl;
     std::cout << "Face recognition model loaded from: " << net_path << std::endl;
+
+    // 组件内存估算：ResNet 按参数量计，形状预测器按序列化文件大小计
+    auto& memory = MemoryTracker::getInstance();
+    memory.setComponentBytes("ResNet 模型", dr::count_parameters(net_) * sizeof(float));
+    memory.setComponentBytes("形状预测器", std::filesystem::file_size(sp_path));
 }
 
 void FaceRecognition::loadLibraryFromCSV(const std::string& csv_path)
@@ -52,53 +163,42 @@ void FaceRecognition::loadLibraryFromCSV(const std::string& csv_path)
         return;
     }
 
-    std::ifstream fin(csv_path);
-    std::string line;
-    size_t count = 0;
-
-    while (std::getline(fin, line))
-    {
-        std::istringstream iss(line);
-        std::string name;
-        if (!std::getline(iss, name, ',')) continue;
-
-        std::vector<float> values;
-        float v;
-        while (iss >> v) values.push_back(v);
-
-        if (values.empty()) continue;
-        dr::matrix<float,0,1> desc(values.size());
-        for (size_t i = 0; i < values.size(); ++i)
-            desc(i) = values[i];
-
-        face_library_[name] = desc;
-        ++count;
-    }
-    std::cout << "Loaded " << count << " entries from CSV library." << std::endl;
+    const size_t count = face_library_.loadCsv(csv_path);
+    std::cout << "Loaded " << count << " entries (" << face_library_.identityCount()
+              << " people) from CSV library." << std::endl;
 }
 
-void FaceRecognition::buildFaceLibrary(const std::string& dir_path)
+std::vector<FaceRecognition::LibraryImage> FaceRecognition::prepareLibraryImages(const std::string& dir_path,
+                                                                                  const DetectionOptions& detection,
+                                                                                  size_t max_references) const
 {
+    std::vector<LibraryImage> images;
     if (dir_path.empty() || !std::filesystem::exists(dir_path))
     {
         std::cerr << "Directory path not found: " << dir_path << std::endl;
-        return;
+        return images;
     }
 
-    auto detector = dr::get_frontal_face_detector();
-    size_t count = 0;
+    // 与实时流水线使用同一种检测后端，库中人脸框与查询人脸框的风格一致
+    auto detector = createFaceDetector(detection);
 
     for (const auto& person_dir : std::filesystem::directory_iterator(dir_path))
     {
         if (!person_dir.is_directory()) continue;
         const auto name = person_dir.path().filename().string();
 
+        // 同一个人的每张有效图片都作为一张参考特征（max_references 为 0 时不限数量）
+        size_t references = 0;
         for (const auto& img_file : std::filesystem::directory_iterator(person_dir))
         {
-            dr::matrix<dr::rgb_pixel> img;
+            if (max_references > 0 && references >= max_references)
+                break;
+
+            LibraryImage entry;
+            entry.name = name;
             try
             {
-                dr::load_image(img, img_file.path().string());
+                dr::load_image(entry.img, img_file.path().string());
             }
             catch (const std::exception& e)
             {
@@ -107,7 +207,9 @@ void FaceRecognition::buildFaceLibrary(const std::string& dir_path)
                 continue;
             }
 
-            auto faces = detector(img);
+            cv::Mat bgr;
+            cv::cvtColor(dr::toMat(entry.img), bgr, cv::COLOR_RGB2BGR);
+            auto faces = detector->detect(bgr);
             if (faces.size() != 1)
             {
                 std::cerr << "Skipping " << img_file.path()
@@ -115,56 +217,320 @@ void FaceRecognition::buildFaceLibrary(const std::string& dir_path)
                 continue;
             }
 
-            auto shape = sp_(img, faces[0]);
-            dr::matrix<dr::rgb_pixel> chip;
-            dr::extract_image_chip(img,
-                dr::get_face_chip_details(shape, 150, 0.25),
-                chip);
-
-            auto desc = net_(chip);
-            face_library_[name] = desc;
-            ++count;
-            break;  // 每个子目录只用第一张有效图片
+            entry.face = faces[0];
+            images.push_back(std::move(entry));
+            ++references;
         }
     }
-    std::cout << "Built face library from directory: " << count << " entries." << std::endl;
+    return images;
+}
+
+void FaceRecognition::buildFaceLibrary(const std::vector<LibraryImage>& images)
+{
+    size_t count = 0;
+    for (const auto& entry : images)
+    {
+        auto shape = sp_(entry.img, entry.face);
+        dr::matrix<dr::rgb_pixel> chip;
+        dr::extract_image_chip(entry.img,
+            dr::get_face_chip_details(shape, 150, 0.25),
+            chip);
+
+        auto desc = net_(chip);
+        face_library_.add(entry.name, desc);
+        ++count;
+    }
+    std::cout << "Built face library from directory: " << count << " references of "
+              << face_library_.identityCount() << " people." << std::endl;
+}
+
+void FaceRecognition::buildLibraryIndex(const std::string& index_path)
+{
+    ScopedStartupPhase phase("人脸库: 检索索引");
+    if (!index_path.empty() && face_library_.loadIndex(index_path))
+    {
+        std::cout << "Loaded gallery PCA index from: " << index_path << std::endl;
+        return;
+    }
+    face_library_.buildIndex();
+    if (!face_library_.hasIndex())
+        return;
+    std::cout << "Built gallery PCA index for " << face_library_.size() << " entries." << std::endl;
+    if (!index_path.empty() && face_library_.saveIndex(index_path))
+        std::cout << "Saved gallery PCA index to: " << index_path << std::endl;
+}
+
+uint64_t FaceRecognition::watchlistMask(const std::vector<std::string>& watchlists) const
+{
+    std::shared_lock<std::shared_mutex> lock(library_mutex_);
+    return face_library_.watchlistMask(watchlists);
+}
+
+bool FaceRecognition::hasLibrary() const
+{
+    if (shards_)
+        return true;
+    std::shared_lock<std::shared_mutex> lock(library_mutex_);
+    return !face_library_.empty();
+}
+
+void FaceRecognition::enrollDescriptor(const std::string& name, const dr::matrix<float,0,1>& descriptor)
+{
+    if (shards_)
+        throw std::runtime_error("Enrollment is not supported in gallery coordinator mode; enroll on the shard.");
+    std::unique_lock<std::shared_mutex> lock(library_mutex_);
+    face_library_.add(name, descriptor);
+}
+
+void FaceRecognition::replacePerson(const std::string& name, const dr::matrix<float,0,1>& descriptor)
+{
+    if (shards_)
+        throw std::runtime_error("Enrollment is not supported in gallery coordinator mode; enroll on the shard.");
+    // 删除和加入在同一次独占内完成，识别不会看到此人暂时不在库中；维数不对时先报错，旧特征保留
+    std::unique_lock<std::shared_mutex> lock(library_mutex_);
+    if (face_library_.dimensions() != 0 && descriptor.size() != face_library_.dimensions())
+        throw std::invalid_argument("Descriptor for '" + name + "' has " + std::to_string(descriptor.size()) +
+                                    " dimensions, gallery has " + std::to_string(face_library_.dimensions()));
+    face_library_.remove(name);
+    face_library_.add(name, descriptor);
+}
+
+size_t FaceRecognition::removePerson(const std::string& name)
+{
+    if (shards_)
+        throw std::runtime_error("Enrollment is not supported in gallery coordinator mode; enroll on the shard.");
+    std::unique_lock<std::shared_mutex> lock(library_mutex_);
+    return face_library_.remove(name);
+}
+
+size_t FaceRecognition::libraryTombstones() const
+{
+    std::shared_lock<std::shared_mutex> lock(library_mutex_);
+    return face_library_.tombstoneCount();
+}
+
+size_t FaceRecognition::librarySize() const
+{
+    std::shared_lock<std::shared_mutex> lock(library_mutex_);
+    return face_library_.size();
+}
+
+void FaceRecognition::compactLibrary()
+{
+    // 修改只来自调用线程，复制和压缩期间人脸库不会变化；只有最后的替换需要独占
+    FaceGallery compacted;
+    {
+        std::shared_lock<std::shared_mutex> lock(library_mutex_);
+        if (face_library_.tombstoneCount() == 0)
+            return;
+        compacted = face_library_;
+    }
+    compacted.compact();
+    {
+        std::unique_lock<std::shared_mutex> lock(library_mutex_);
+        face_library_ = std::move(compacted);
+    }
+    MemoryTracker::getInstance().setComponentBytes("人脸库", libraryMemoryBytes());
 }
 
-std::string FaceRecognition::recognize(const dr::matrix<dr::rgb_pixel>& face_chip)
+std::string FaceRecognition::recognize(const dr::matrix<dr::rgb_pixel>& face_chip, uint64_t watchlists)
 {
-    if (face_library_.empty())
+    if (!hasLibrary() && !strangers_)
         return "Stranger";
 
-    auto descriptor = net_(face_chip);
-    double min_dist = std::numeric_limits<double>::infinity();
-    std::string best = "Stranger";
+    std::vector<dr::matrix<float,0,1>> descriptors{computeDescriptor(face_chip)};
+    std::vector<std::string> names{matchDescriptor(descriptors[0], watchlists)};
+    labelStrangers(descriptors, names, watchlists);
+    return names[0];
+}
 
-    for (const auto& [name, lib_desc] : face_library_)
+std::vector<std::string> FaceRecognition::recognizeAll(const std::vector<dr::matrix<dr::rgb_pixel>>& face_chips,
+                                                       uint64_t watchlists)
+{
+    std::vector<std::string> names(face_chips.size(), "Stranger");
+    if ((!hasLibrary() && !strangers_) || face_chips.empty())
+        return names;
+
+    // 先提取整组特征，再一次性在人脸库中匹配
+    std::vector<dr::matrix<float,0,1>> descriptors(face_chips.size());
+    if (scheduler_)
     {
-        double d = dlib::length(lib_desc - descriptor);
-        if (d < min_dist)
+        // 一次性全部提交，让调度器把它们和其他视频流的人脸合成批
+        std::vector<std::future<dr::matrix<float,0,1>>> pending;
+        pending.reserve(face_chips.size());
+        for (const auto& chip : face_chips)
+            pending.push_back(scheduler_->submit(chip));
+        for (size_t i = 0; i < pending.size(); ++i)
+            descriptors[i] = pending[i].get();
+    }
+    else if (pool_->size() > 1 && face_chips.size() > 1)
+    {
+        // 多个推理上下文：交给池的常驻线程并行提取，当前线程也参与
+        pool_->parallelFor(face_chips.size(), [&face_chips, &descriptors](size_t i, anet_type& net) {
+            descriptors[i] = net(face_chips[i]);
+        });
+    }
+    else
+    {
+        for (size_t i = 0; i < face_chips.size(); ++i)
+            descriptors[i] = computeDescriptor(face_chips[i]);
+    }
+    names = matchDescriptors(descriptors, watchlists);
+    labelStrangers(descriptors, names, watchlists);
+    return names;
+}
+
+std::vector<std::string> FaceRecognition::recognizeBatch(const FaceChipBatch& batch, uint64_t watchlists)
+{
+    std::vector<std::string> names(batch.size(), "Stranger");
+    if ((!hasLibrary() && !strangers_) || batch.size() == 0)
+        return names;
+
+    // 张量已经是输入层 to_tensor 的布局，跳过输入层直接前向，再由 loss 层取出特征
+    std::vector<dr::matrix<float,0,1>> descriptors(batch.size());
+    {
+        auto lease = pool_->acquire();
+        auto& net = lease.net();
+        net.subnet().forward(batch.tensor());
+        net.loss_details().to_label(batch.tensor(), net.subnet(), descriptors.begin());
+    }
+    names = matchDescriptors(descriptors, watchlists);
+    labelStrangers(descriptors, names, watchlists);
+    return names;
+}
+
+void FaceRecognition::labelStrangers(const std::vector<dr::matrix<float,0,1>>& descriptors,
+                                     std::vector<std::string>& names, uint64_t watchlists)
+{
+    if (!strangers_ || watchlists != FaceGallery::kAllWatchlists)
+        return;
+    PM_SCOPED(陌生人聚类);
+    strangers_->labelUnmatched(descriptors, names, watchlists);
+}
+
+FaceChipBatch::Means FaceRecognition::inputMeans() const
+{
+    const auto& input = net_.input_layer();
+    FaceChipBatch::Means means;
+    means.red = input.get_avg_red();
+    means.green = input.get_avg_green();
+    means.blue = input.get_avg_blue();
+    return means;
+}
+
+std::string FaceRecognition::matchDescriptor(const dr::matrix<float,0,1>& descriptor, uint64_t watchlists) const
+{
+    const auto match = findBestMatch(descriptor, watchlists);
+    return (match.distance <= face_match_threshold_) ? match.name : "Stranger";
+}
+
+std::vector<std::string> FaceRecognition::matchDescriptors(const std::vector<dr::matrix<float,0,1>>& descriptors,
+                                                           uint64_t watchlists) const
+{
+    std::vector<std::string> names(descriptors.size(), "Stranger");
+    if (!hasLibrary())
+        return names;
+
+    PM_SCOPED(人脸库检索);
+    if (shards_)
+    {
+        const auto matches = shards_->search(descriptors, 1, face_library_.watchlistNames(watchlists));
+        for (size_t i = 0; i < matches.size(); ++i)
+        {
+            if (!matches[i].empty() && matches[i].front().distance <= face_match_threshold_)
+                names[i] = matches[i].front().name;
+        }
+        return names;
+    }
+    std::shared_lock<std::shared_mutex> lock(library_mutex_);
+    const auto hits = face_library_.nearestBatch(descriptors, watchlists);
+    for (size_t i = 0; i < hits.size(); ++i)
+    {
+        if (hits[i].distance <= face_match_threshold_)
+            names[i] = face_library_.name(hits[i].index);
+    }
+    return names;
+}
+
+FaceRecognition::MatchResult FaceRecognition::findBestMatch(const dr::matrix<float,0,1>& descriptor,
+                                                            uint64_t watchlists) const
+{
+    MatchResult best;
+    best.name = "Stranger";
+    best.distance = std::numeric_limits<double>::infinity();
+
+    if (shards_)
+    {
+        const auto matches = shards_->search({descriptor}, 1, face_library_.watchlistNames(watchlists));
+        if (!matches.front().empty())
         {
-            min_dist = d;
-            best = name;
+            best.name = matches.front().front().name;
+            best.distance = matches.front().front().distance;
         }
+        return best;
     }
 
-    return (min_dist <= face_match_threshold_) ? best : "Stranger";
+    // 人脸库为空或所选名单内没有人时距离为无穷大
+    std::shared_lock<std::shared_mutex> lock(library_mutex_);
+    const auto hit = face_library_.nearest(descriptor, watchlists);
+    if (std::isfinite(hit.distance))
+    {
+        best.name = face_library_.name(hit.index);
+        best.distance = hit.distance;
+    }
+    return best;
+}
+
+dr::matrix<float,0,1> FaceRecognition::computeDescriptor(const dr::matrix<dr::rgb_pixel>& face_chip)
+{
+    if (scheduler_)
+        return scheduler_->submit(face_chip).get();
+
+    auto lease = pool_->acquire();
+    return lease.net()(face_chip);
+}
+
+size_t FaceRecognition::inferenceContexts() const
+{
+    return pool_->size();
 }
 
 void FaceRecognition::printFaceLibInfo() const
 {
+    std::shared_lock<std::shared_mutex> lock(library_mutex_);
     std::cout << "----- Face Library Info -----\n";
-    std::cout << "Total entries : " << face_library_.size() << "\n";
+    std::cout << "Total people  : " << face_library_.identityCount() << "\n";
+    std::cout << "References    : " << face_library_.size() - face_library_.tombstoneCount() << "\n";
     std::cout << "Threshold     : " << face_match_threshold_ << "\n";
-    for (const auto& [name, desc] : face_library_)
+    static const char* const storage_names[] = {"float", "int8", "fp16"};
+    std::cout << "Storage       : " << storage_names[static_cast<int>(face_library_.storage())];
+    if (face_library_.storage() != FaceGallery::Storage::Float)
+        std::cout << " (rerank " << face_library_.rerank() << ")";
+    std::cout << "\n";
+    // 精排的浮点副本单独列出：int8 + 副本比 float 存储还大
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "Memory        : " << face_library_.memoryBytes() / mb << " MB";
+    if (face_library_.rerankCopyBytes() > 0)
+        std::cout << " (including " << face_library_.rerankCopyBytes() / mb << " MB float copy for rerank)";
+    std::cout << "\n";
+    std::cout << "Watchlists    : " << face_library_.watchlistCount() << "\n";
+    if (shards_)
+        std::cout << "Shards        : " << shards_->shardCount() << " (default timeout " << shards_->timeout().count() << " ms)\n";
+    for (size_t i = 0; i < face_library_.identityCount(); ++i)
     {
-        std::cout << " - " << name << " (dim=" << desc.size() << ")\n";
+        std::cout << " - " << face_library_.identityName(i) << " (references=" << face_library_.referenceCount(i)
+                  << ", dim=" << face_library_.dimensions() << ")\n";
     }
     std::cout << "-----------------------------\n";
 }
 
-dr::shape_predictor FaceRecognition::getShapePredictor() const
+size_t FaceRecognition::libraryMemoryBytes() const
+{
+    std::shared_lock<std::shared_mutex> lock(library_mutex_);
+    return face_library_.memoryBytes();
+}
+
+const dr::shape_predictor& FaceRecognition::getShapePredictor() const
 {
     return sp_;
 }
@@ -0,0 +1,58 @@
+#include "FaceTracker.h"
+
+namespace {
+double iou(const dlib::rectangle& a, const dlib::rectangle& b) {
+    const double inter = a.intersect(b).area();
+    const double uni = static_cast<double>(a.area()) + b.area() - inter;
+    return uni > 0 ? inter / uni : 0.0;
+}
+} // namespace
+
+FaceTracker::FaceTracker(int max_missed, double min_iou) : max_missed_(max_missed), min_iou_(min_iou) {}
+
+std::vector<size_t> FaceTracker::update(const std::vector<dlib::rectangle>& boxes) {
+    std::vector<int> owner(boxes.size(), -1);  // 每个框关联到的旧轨迹
+    for (size_t t = 0; t < tracks_.size(); ++t) {
+        Track& track = tracks_[t];
+        double best = min_iou_;
+        int best_index = -1;
+        for (size_t i = 0; i < boxes.size(); ++i) {
+            const double overlap = owner[i] >= 0 ? 0.0 : iou(track.rect, boxes[i]);
+            if (overlap > best) {
+                best = overlap;
+                best_index = static_cast<int>(i);
+            }
+        }
+        if (best_index >= 0) {
+            owner[best_index] = static_cast<int>(t);
+            track.rect = boxes[best_index];
+            track.missed = 0;
+        } else {
+            ++track.missed;
+        }
+    }
+
+    // 删除过期轨迹，同时记下旧下标到新下标的映射
+    std::vector<Track> kept;
+    std::vector<int> remap(tracks_.size(), -1);
+    for (size_t t = 0; t < tracks_.size(); ++t) {
+        if (tracks_[t].missed > max_missed_) continue;
+        remap[t] = static_cast<int>(kept.size());
+        kept.push_back(std::move(tracks_[t]));
+    }
+    tracks_ = std::move(kept);
+
+    std::vector<size_t> indices(boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i) {
+        if (owner[i] >= 0) {
+            indices[i] = static_cast<size_t>(remap[owner[i]]);
+        } else {
+            Track track;
+            track.id = next_id_++;
+            track.rect = boxes[i];
+            indices[i] = tracks_.size();
+            tracks_.push_back(std::move(track));
+        }
+    }
+    return indices;
+}
@@ -0,0 +1,201 @@
+#include "FramePipeline.h"
+#include "FaceRecognition.hpp"
+#include "PerformanceMonitor.h"
+#include "StrangerClusters.h"
+
+#include <dlib/opencv.h>
+#include <algorithm>
+
+PipelineOptions PipelineOptions::fromConfig(const ConfigParser& config) {
+    PipelineOptions options;
+    options.detection = DetectionOptions::fromConfig(config);
+    options.quality = QualityOptions::fromConfig(config);
+    return options;
+}
+
+FramePipeline::FramePipeline(FaceRecognition& recognizer, const PipelineOptions& options)
+    : recognizer_(recognizer),
+      detector_(createFaceDetector(options.detection)),
+      sp_(recognizer.getShapePredictor()),
+      chip_batch_(recognizer.inputMeans()),
+      quality_(options.quality),
+      track_faces_(options.quality.enabled && options.sequential_frames),
+      tracker_(options.quality.track_max_missed) {}
+
+std::vector<FaceResult> FramePipeline::process(cv::Mat& frame) {
+    std::vector<FaceResult> results = analyze(frame);
+
+    // --- 最后统一绘制，以免覆盖物干扰后续人脸的识别输入 ---
+    {
+        PM_SCOPED(绘制覆盖物);
+        for (const auto& result : results) {
+            drawResult(frame, result);
+        }
+    }
+    return results;
+}
+
+std::vector<FaceResult> FramePipeline::analyze(const cv::Mat& frame) {
+    std::vector<FaceResult> results;
+    dlib::cv_image<dlib::bgr_pixel> dlib_img(frame);
+
+    // --- 人脸检测 ---
+    std::vector<dlib::rectangle> faces;
+    {
+        PM_SCOPED(人脸检测);
+        faces = detectFaces(frame);
+    }
+
+    // --- 人脸处理与识别 ---
+    PM_START("人脸处理与识别（总）");
+    const std::vector<size_t> tracks = track_faces_ ? tracker_.update(faces) : std::vector<size_t>();
+    std::vector<size_t> shaped_faces;  // 做了形状预测的人脸下标
+    std::vector<dlib::full_object_detection> shapes;
+    results.resize(faces.size());
+    for (size_t i = 0; i < faces.size(); ++i) {
+        results[i].rect = faces[i];
+        if (quality_.enabled && !faceLargeEnough(faces[i], quality_)) {
+            continue;  // 太小的脸连形状预测都跳过
+        }
+        PM_SCOPED(形状预测);
+        shapes.push_back(sp_(dlib_img, faces[i]));
+        shaped_faces.push_back(i);
+    }
+
+    // 芯片提取 + 质量门控 + 特征提取；chip_faces[k] 是第 k 个送进网络的人脸在 faces 中的下标
+    std::vector<size_t> chip_faces;
+    std::vector<std::string> names;
+    if (recognizer_.acceptsChipBatches()) {
+        // 对齐、采样和颜色转换一遍完成，直接写进网络输入张量
+        std::vector<size_t> kept;
+        {
+            PM_SCOPED(人脸芯片提取);
+            chip_batch_.reset(shapes.size());
+            for (size_t k = 0; k < shapes.size(); ++k) {
+                chip_batch_.write(k, frame, dlib::get_face_chip_details(shapes[k], FaceChipBatch::kChipSize, 0.25));
+            }
+        }
+        for (size_t k = 0; k < shapes.size(); ++k) {
+            if (quality_.enabled) {
+                PM_SCOPED(人脸质量评估);
+                if (!assessFaceQuality(shapes[k], chip_batch_.sharpness(k), quality_).passed) continue;
+            }
+            kept.push_back(k);
+            chip_faces.push_back(shaped_faces[k]);
+        }
+        chip_batch_.keep(kept);
+
+        PM_SCOPED(核心人脸识别);
+        names = recognizer_.recognizeBatch(chip_batch_, watchlists_);
+    } else {
+        // 跨流合批开启时，芯片要交给 EmbeddingScheduler 与其他视频流的人脸一起凑批
+        std::vector<dlib::matrix<dlib::rgb_pixel>> face_chips;
+        for (size_t k = 0; k < shapes.size(); ++k) {
+            dlib::matrix<dlib::rgb_pixel> chip;
+            {
+                PM_SCOPED(人脸芯片提取);
+                dlib::extract_image_chip(dlib_img, dlib::get_face_chip_details(shapes[k], 150, 0.25), chip);
+            }
+            if (quality_.enabled) {
+                PM_SCOPED(人脸质量评估);
+                if (!assessFaceQuality(shapes[k], chip, quality_).passed) continue;
+            }
+            face_chips.push_back(std::move(chip));
+            chip_faces.push_back(shaped_faces[k]);
+        }
+
+        // 特征提取是最重的一步：交给 FaceRecognition 并行或合批处理整帧的人脸
+        PM_SCOPED(核心人脸识别);
+        names = recognizer_.recognizeAll(face_chips, watchlists_);
+    }
+    for (size_t k = 0; k < chip_faces.size(); ++k) {
+        results[chip_faces[k]].name = std::move(names[k]);
+    }
+
+    if (quality_.enabled) {
+        // 通过门控的结果记到轨迹上；未通过的人脸沿用轨迹上次的结果
+        for (size_t i = 0; i < faces.size(); ++i) {
+            if (!track_faces_) {
+                if (results[i].name.empty()) results[i].name = "Unknown";
+                continue;
+            }
+            FaceTracker::Track& track = tracker_.track(tracks[i]);
+            if (!results[i].name.empty()) {
+                track.label = results[i].name;
+            } else {
+                results[i].name = track.label.empty() ? "Unknown" : track.label;
+            }
+        }
+        if (!faces.empty()) {
+            PerformanceMonitor::getInstance().recordValue(
+                "质量门控跳过占比", 1.0 - static_cast<double>(chip_faces.size()) / faces.size());
+        }
+    }
+    PM_STOP("人脸处理与识别（总）");
+    return results;
+}
+
+std::vector<dlib::rectangle> FramePipeline::detectFaces(const cv::Mat& frame) {
+    if (regions_.empty()) {
+        return detector_->detect(frame);
+    }
+
+    // 只在各区域的外接矩形上检测：cv::Mat 子图不复制像素，结果平移回帧坐标
+    const cv::Size frame_size = frame.size();
+    std::vector<dlib::rectangle> faces;
+    long scanned_area = 0;
+    for (const auto& region : regions_) {
+        const cv::Rect roi = region.pixelRect(frame_size);
+        if (roi.empty()) continue;
+        scanned_area += roi.area();
+
+        const cv::Mat sub_image = frame(roi);
+        for (const auto& rect : detector_->detect(sub_image)) {
+            const dlib::rectangle mapped = dlib::translate_rect(rect, roi.x, roi.y);
+            const dlib::point center = dlib::center(mapped);
+            if (!region.contains(cv::Point2f(center.x(), center.y()), frame_size)) continue;
+
+            // 区域相互重叠时同一张脸可能被检测两次，保留先出现的框
+            bool duplicate = false;
+            for (const auto& existing : faces) {
+                const double inter = existing.intersect(mapped).area();
+                if (inter > 0.5 * std::min(existing.area(), mapped.area())) {
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate) faces.push_back(mapped);
+        }
+    }
+    PerformanceMonitor::getInstance().recordValue("检测区域面积占比",
+                                                  static_cast<double>(scanned_area) / frame_size.area());
+    return faces;
+}
+
+void FramePipeline::encode(const cv::Mat& frame, std::vector<uchar>& buffer, int jpeg_quality) {
+    PM_SCOPED(图像编码);
+    buffer.clear();
+    cv::imencode(".jpg", frame, buffer, {cv::IMWRITE_JPEG_QUALITY, jpeg_quality});
+}
+
+void FramePipeline::drawResult(cv::Mat& frame, const FaceResult& result) const {
+    const auto& face_rect = result.rect;
+    const std::string& recognized_name = result.name;
+
+    // 陌生人（含聚类得到的 "Stranger-N"）红色，已知人脸绿色，质量不足尚未识别的黄色
+    const bool stranger = StrangerClusters::isStrangerLabel(recognized_name);
+    cv::Scalar color = stranger                        ? cv::Scalar(0, 0, 255)
+                     : (recognized_name == "Unknown")  ? cv::Scalar(0, 255, 255)
+                                                       : cv::Scalar(0, 255, 0);
+    int baseline = 0;
+    cv::Size textSize = cv::getTextSize(recognized_name, cv::FONT_HERSHEY_SIMPLEX, 0.9, 2, &baseline);
+    // 显式转换为 int
+    cv::Point textOrg(static_cast<int>(face_rect.tl_corner().x()), static_cast<int>(face_rect.tl_corner().y()) - 10);
+
+    // 绘制背景矩形以提高文本可读性
+    cv::rectangle(frame, textOrg + cv::Point(0, baseline), textOrg + cv::Point(textSize.width, -textSize.height), color, cv::FILLED);
+    cv::putText(frame, recognized_name, textOrg, cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 2);
+
+    cv::rectangle(frame, cv::Point(static_cast<int>(face_rect.tl_corner().x()), static_cast<int>(face_rect.tl_corner().y())),
+                          cv::Point(static_cast<int>(face_rect.br_corner().x()), static_cast<int>(face_rect.br_corner().y())), color, 2);
+}
@@ -0,0 +1,145 @@
+#include "FrameRecorder.h"
+
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+namespace {
+const char kMagic[8] = {'D', 'D', 'F', 'G', 'R', 'E', 'C', '1'};
+const uint32_t kVersion = 1;
+// 单帧数据上限，防止损坏的文件导致超大内存分配
+const uint32_t kMaxFrameBytes = 64u * 1024u * 1024u;
+
+template <typename T>
+void writePod(std::ofstream& out, const T& value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readPod(std::ifstream& in, T& value) {
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    return static_cast<bool>(in);
+}
+} // namespace
+
+FrameRecorder::FrameRecorder(const std::string& path, int jpeg_quality)
+    : out_(path, std::ios::binary | std::ios::trunc), jpeg_quality_(jpeg_quality) {
+    if (!out_.is_open()) {
+        std::cerr << "Error: Failed to open recording file: " << path << std::endl;
+        return;
+    }
+    out_.write(kMagic, sizeof(kMagic));
+    writePod(out_, kVersion);
+    writePod(out_, static_cast<uint32_t>(jpeg_quality_));
+}
+
+FrameRecorder::~FrameRecorder() {
+    close();
+}
+
+bool FrameRecorder::write(const cv::Mat& frame, long long timestamp_ns) {
+    if (!out_.is_open() || frame.empty()) {
+        return false;
+    }
+    if (first_timestamp_ns_ < 0) {
+        first_timestamp_ns_ = timestamp_ns;
+    }
+
+    buffer_.clear();
+    if (!cv::imencode(".jpg", frame, buffer_, {cv::IMWRITE_JPEG_QUALITY, jpeg_quality_})) {
+        std::cerr << "Error: Failed to encode frame for recording." << std::endl;
+        return false;
+    }
+
+    writePod(out_, static_cast<int64_t>(timestamp_ns - first_timestamp_ns_));
+    writePod(out_, static_cast<uint32_t>(buffer_.size()));
+    out_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+    ++frame_count_;
+    return static_cast<bool>(out_);
+}
+
+void FrameRecorder::close() {
+    if (out_.is_open()) {
+        out_.close();
+        std::cout << "Recording closed: " << frame_count_ << " frames written." << std::endl;
+    }
+}
+
+FrameReplaySource::FrameReplaySource(const std::string& path, bool realtime, bool loop)
+    : in_(path, std::ios::binary), path_(path), realtime_(realtime), loop_(loop) {
+    if (!in_.is_open()) {
+        std::cerr << "Error: Failed to open recording file: " << path << std::endl;
+        return;
+    }
+    opened_ = readHeader();
+    if (!opened_) {
+        std::cerr << "Error: Not a valid recording file: " << path << std::endl;
+    }
+}
+
+bool FrameReplaySource::readHeader() {
+    char magic[sizeof(kMagic)];
+    in_.read(magic, sizeof(magic));
+    if (!in_ || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+    uint32_t version = 0;
+    uint32_t quality = 0;
+    if (!readPod(in_, version) || !readPod(in_, quality)) {
+        return false;
+    }
+    return version == kVersion;
+}
+
+bool FrameReplaySource::read(cv::Mat& frame, long long& timestamp_ns) {
+    if (!opened_) {
+        return false;
+    }
+
+    int64_t recorded_ns = 0;
+    uint32_t size = 0;
+    if (!readPod(in_, recorded_ns) || !readPod(in_, size)) {
+        if (!loop_ || frame_count_ == 0) {
+            return false;
+        }
+        // 回到第一帧，时间戳继续向后累加，保持单调
+        in_.clear();
+        in_.seekg(0);
+        readHeader();
+        loop_offset_ns_ = last_timestamp_ns_ + 1;
+        if (!readPod(in_, recorded_ns) || !readPod(in_, size)) {
+            return false;
+        }
+    }
+    if (size == 0 || size > kMaxFrameBytes) {
+        std::cerr << "Error: Corrupted frame record in " << path_ << std::endl;
+        return false;
+    }
+
+    buffer_.resize(size);
+    in_.read(reinterpret_cast<char*>(buffer_.data()), size);
+    if (!in_) {
+        return false;
+    }
+    frame = cv::imdecode(buffer_, cv::IMREAD_COLOR);
+    if (frame.empty()) {
+        std::cerr << "Error: Failed to decode recorded frame." << std::endl;
+        return false;
+    }
+
+    last_timestamp_ns_ = loop_offset_ns_ + recorded_ns;
+    if (replay_start_ns_ < 0) {
+        replay_start_ns_ = monotonicNowNs() - last_timestamp_ns_;
+    }
+    timestamp_ns = replay_start_ns_ + last_timestamp_ns_;
+
+    if (realtime_) {
+        // 按录制速度回放：等到该帧对应的时刻再交给流水线
+        long long wait_ns = timestamp_ns - monotonicNowNs();
+        if (wait_ns > 0) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(wait_ns));
+        }
+    }
+    ++frame_count_;
+    return true;
+}
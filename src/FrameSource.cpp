@@ -0,0 +1,15 @@
+#include "FrameSource.h"
+
+VideoCaptureSource::VideoCaptureSource(int device_index)
+    : cap_(device_index), description_("camera #" + std::to_string(device_index)) {}
+
+VideoCaptureSource::VideoCaptureSource(const std::string& path)
+    : cap_(path), description_("video file " + path) {}
+
+bool VideoCaptureSource::read(cv::Mat& frame, long long& timestamp_ns) {
+    if (!cap_.read(frame) || frame.empty()) {
+        return false;
+    }
+    timestamp_ns = monotonicNowNs();
+    return true;
+}
@@ -0,0 +1,557 @@
+#include "GalleryShard.h"
+#include "PerformanceMonitor.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t kRequestMagic = 0x51534744;   // "DGSQ"
+constexpr uint32_t kResponseMagic = 0x52534744;  // "DGSR"
+constexpr uint32_t kMaxPayloadBytes = 256u << 20;
+constexpr uint32_t kMaxTopK = 1000;
+
+// 等待 fd 可读 / 可写，超过截止时间返回 false；deadline 为 time_point::max() 时不限时
+bool waitFor(int fd, short events, Clock::time_point deadline) {
+    while (true) {
+        int timeout_ms = -1;
+        if (deadline != Clock::time_point::max()) {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - Clock::now());
+            if (remaining.count() <= 0) return false;
+            timeout_ms = static_cast<int>(remaining.count());
+        }
+        pollfd pfd{fd, events, 0};
+        const int ready = ::poll(&pfd, 1, timeout_ms);
+        if (ready > 0) return true;
+        if (ready == 0) return false;
+        if (errno != EINTR) return false;
+    }
+}
+
+bool sendAll(int fd, const char* data, size_t size, Clock::time_point deadline) {
+    while (size > 0) {
+        if (!waitFor(fd, POLLOUT, deadline)) return false;
+        const ssize_t sent = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+bool recvAll(int fd, char* data, size_t size, Clock::time_point deadline) {
+    while (size > 0) {
+        if (!waitFor(fd, POLLIN, deadline)) return false;
+        const ssize_t received = ::recv(fd, data, size, 0);
+        if (received == 0) return false;  // 对端关闭
+        if (received < 0) {
+            if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) continue;
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+void appendBytes(std::vector<char>& out, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    out.insert(out.end(), p, p + size);
+}
+
+void appendU32(std::vector<char>& out, uint32_t value) { appendBytes(out, &value, sizeof(value)); }
+
+void appendString(std::vector<char>& out, const std::string& value) {
+    appendU32(out, static_cast<uint32_t>(value.size()));
+    appendBytes(out, value.data(), value.size());
+}
+
+// 魔数和正文长度填在前 8 个字节
+std::vector<char> beginMessage(uint32_t magic) {
+    std::vector<char> out;
+    appendU32(out, magic);
+    appendU32(out, 0);
+    return out;
+}
+
+void finishMessage(std::vector<char>& out) {
+    const uint32_t payload = static_cast<uint32_t>(out.size() - 2 * sizeof(uint32_t));
+    std::memcpy(out.data() + sizeof(uint32_t), &payload, sizeof(payload));
+}
+
+// 读取一条消息的正文；魔数不对、正文过长或读取失败时返回 false
+bool readMessage(int fd, uint32_t magic, std::vector<char>& payload, Clock::time_point deadline) {
+    uint32_t header[2];
+    if (!recvAll(fd, reinterpret_cast<char*>(header), sizeof(header), deadline)) return false;
+    if (header[0] != magic || header[1] > kMaxPayloadBytes) return false;
+    payload.resize(header[1]);
+    return header[1] == 0 || recvAll(fd, payload.data(), payload.size(), deadline);
+}
+
+// 按顺序解析正文，越界时之后的读取都失败
+class Reader {
+public:
+    explicit Reader(const std::vector<char>& data) : p_(data.data()), end_(data.data() + data.size()) {}
+
+    bool bytes(void* out, size_t size) {
+        if (static_cast<size_t>(end_ - p_) < size) return false;
+        std::memcpy(out, p_, size);
+        p_ += size;
+        return true;
+    }
+    bool u32(uint32_t& value) { return bytes(&value, sizeof(value)); }
+    bool f64(double& value) { return bytes(&value, sizeof(value)); }
+    bool str(std::string& value) {
+        uint32_t size = 0;
+        if (!u32(size) || static_cast<size_t>(end_ - p_) < size) return false;
+        value.assign(p_, size);
+        p_ += size;
+        return true;
+    }
+    size_t remaining() const { return static_cast<size_t>(end_ - p_); }
+
+private:
+    const char* p_;
+    const char* end_;
+};
+
+void setNoDelay(int fd) {
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+struct Address {
+    sockaddr_storage storage{};
+    socklen_t length = 0;
+};
+
+// 解析分片地址（可能有 IPv6 和 IPv4 两个），每次新建连接时解析，分片换了地址也能连上
+std::vector<Address> resolve(const ShardEndpoint& endpoint) {
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    std::vector<Address> result;
+    if (::getaddrinfo(endpoint.host.c_str(), std::to_string(endpoint.port).c_str(), &hints, &addresses) != 0) {
+        return result;
+    }
+    for (addrinfo* address = addresses; address; address = address->ai_next) {
+        Address entry;
+        std::memcpy(&entry.storage, address->ai_addr, address->ai_addrlen);
+        entry.length = address->ai_addrlen;
+        result.push_back(entry);
+    }
+    ::freeaddrinfo(addresses);
+    return result;
+}
+
+// 解析一条响应的正文：每个查询的命中列表
+bool parseResponse(const std::vector<char>& payload, size_t query_count,
+                   std::vector<std::vector<ShardMatch>>& results) {
+    Reader reader(payload);
+    uint32_t count = 0;
+    bool valid = reader.u32(count) && count == query_count;
+    results.assign(query_count, {});
+    for (size_t q = 0; q < query_count && valid; ++q) {
+        uint32_t hit_count = 0;
+        valid = reader.u32(hit_count);
+        for (uint32_t h = 0; h < hit_count && valid; ++h) {
+            ShardMatch match;
+            valid = reader.str(match.name) && reader.f64(match.distance);
+            results[q].push_back(std::move(match));
+        }
+    }
+    return valid;
+}
+} // namespace
+
+// ---------------- GalleryShardServer ----------------
+
+GalleryShardServer::GalleryShardServer(const FaceGallery& gallery, int port, const std::string& bind_address)
+    : gallery_(gallery) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(static_cast<uint16_t>(port));
+    if (::inet_pton(AF_INET, bind_address.c_str(), &address.sin_addr) != 1) {
+        throw std::runtime_error("Invalid shard bind address: " + bind_address);
+    }
+
+    listen_fd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listen_fd_ < 0) throw std::runtime_error("Cannot create shard socket");
+    int one = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        ::listen(listen_fd_, 64) != 0) {
+        const std::string error = std::strerror(errno);
+        ::close(listen_fd_);
+        throw std::runtime_error("Cannot listen on " + bind_address + ":" + std::to_string(port) + ": " + error);
+    }
+
+    socklen_t length = sizeof(address);
+    ::getsockname(listen_fd_, reinterpret_cast<sockaddr*>(&address), &length);
+    port_ = ntohs(address.sin_port);
+}
+
+GalleryShardServer::~GalleryShardServer() {
+    stopping_ = true;
+    {
+        // 唤醒阻塞在 recv 上的连接线程
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (int fd : connections_) ::shutdown(fd, SHUT_RDWR);
+    }
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+    if (listen_fd_ >= 0) ::close(listen_fd_);
+}
+
+void GalleryShardServer::serve() {
+    // 定期醒来检查 stop()，不依赖信号打断 poll
+    while (!stopping_) {
+        pollfd pfd{listen_fd_, POLLIN, 0};
+        if (::poll(&pfd, 1, 200) <= 0) continue;
+        const int fd = ::accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0) continue;
+        setNoDelay(fd);
+        std::lock_guard<std::mutex> lock(mutex_);
+        // 协调方重连时旧连接的线程已经结束，在这里回收，长时间运行时线程表不会一直增长
+        reapFinishedWorkers();
+        connections_.push_back(fd);
+        workers_.emplace_back(&GalleryShardServer::handleConnection, this, fd);
+    }
+}
+
+void GalleryShardServer::reapFinishedWorkers() {
+    for (const auto id : finished_) {
+        const auto it = std::find_if(workers_.begin(), workers_.end(),
+                                     [id](const std::thread& worker) { return worker.get_id() == id; });
+        if (it == workers_.end()) continue;
+        it->join();  // 线程已登记结束，只剩返回，不会阻塞
+        workers_.erase(it);
+    }
+    finished_.clear();
+}
+
+void GalleryShardServer::handleConnection(int fd) {
+    std::vector<char> request;
+    while (!stopping_ && readMessage(fd, kRequestMagic, request, Clock::time_point::max())) {
+        PM_SCOPED(分片检索);
+        Reader reader(request);
+        uint32_t query_count = 0, k = 0, dim = 0, watchlist_count = 0;
+        if (!reader.u32(query_count) || !reader.u32(k) || !reader.u32(dim) || !reader.u32(watchlist_count)) break;
+
+        // 分片上没有定义的名单没有成员，全部未定义时什么都匹配不到
+        uint64_t mask = watchlist_count == 0 ? FaceGallery::kAllWatchlists : 0;
+        bool valid = true;
+        for (uint32_t i = 0; i < watchlist_count && valid; ++i) {
+            std::string watchlist;
+            valid = reader.str(watchlist);
+            try {
+                mask |= gallery_.watchlistMask({watchlist});
+            } catch (const std::runtime_error&) {
+            }
+        }
+        if (!valid || reader.remaining() != static_cast<size_t>(query_count) * dim * sizeof(float)) break;
+
+        std::vector<char> response = beginMessage(kResponseMagic);
+        appendU32(response, query_count);
+        dlib::matrix<float,0,1> query(dim);
+        for (uint32_t q = 0; q < query_count; ++q) {
+            if (dim > 0) reader.bytes(&query(0), dim * sizeof(float));
+            const auto hits = gallery_.search(query, std::min(k, kMaxTopK), mask);
+            appendU32(response, static_cast<uint32_t>(hits.size()));
+            for (const auto& hit : hits) {
+                appendString(response, gallery_.name(hit.index));
+                appendBytes(response, &hit.distance, sizeof(hit.distance));
+            }
+        }
+        finishMessage(response);
+        if (!sendAll(fd, response.data(), response.size(), Clock::time_point::max())) break;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    connections_.erase(std::remove(connections_.begin(), connections_.end(), fd), connections_.end());
+    ::close(fd);
+    finished_.push_back(std::this_thread::get_id());
+}
+
+// ---------------- ShardedGallery ----------------
+
+ShardedGallery::ShardedGallery(std::vector<ShardEndpoint> shards, std::chrono::milliseconds timeout)
+    : timeout_(timeout) {
+    for (auto& endpoint : shards) {
+        auto shard = std::make_unique<Shard>();
+        shard->timeout = endpoint.timeout_ms > 0 ? std::chrono::milliseconds(endpoint.timeout_ms) : timeout;
+        shard->endpoint = std::move(endpoint);
+        shards_.push_back(std::move(shard));
+    }
+}
+
+ShardedGallery::~ShardedGallery() {
+    for (auto& shard : shards_) {
+        for (int fd : shard->idle) ::close(fd);
+    }
+}
+
+// 一次请求在一个分片上的进度。search() 在调用线程上用一个 poll() 同时推进所有分片的收发，
+// 不为每个分片开线程；每个分片有自己的截止时间
+struct ShardedGallery::Exchange {
+    enum class Stage { Connecting, Sending, Receiving, Done, Failed };
+
+    Shard* shard = nullptr;
+    Clock::time_point deadline;
+    Stage stage = Stage::Failed;
+    int fd = -1;
+    bool reused = false;                 // 连接来自空闲连接
+    std::vector<Address> addresses;      // 新建连接时依次尝试的地址
+    size_t next_address = 0;
+    size_t sent = 0;
+    std::vector<char> received;          // 消息头和正文
+    size_t expected = 0;                 // received 需要收满的字节数
+    std::vector<std::vector<ShardMatch>> results;
+};
+
+bool ShardedGallery::open(Exchange& exchange, bool reuse) {
+    exchange.fd = -1;
+    exchange.reused = false;
+    exchange.sent = 0;
+    exchange.received.clear();
+    exchange.expected = 2 * sizeof(uint32_t);
+    if (reuse) {
+        std::lock_guard<std::mutex> lock(exchange.shard->mutex);
+        if (!exchange.shard->idle.empty()) {
+            exchange.fd = exchange.shard->idle.back();
+            exchange.shard->idle.pop_back();
+        }
+    }
+    if (exchange.fd >= 0) {
+        exchange.reused = true;
+        exchange.stage = Exchange::Stage::Sending;
+        return true;
+    }
+    exchange.addresses = resolve(exchange.shard->endpoint);
+    exchange.next_address = 0;
+    return connectNext(exchange);
+}
+
+bool ShardedGallery::connectNext(Exchange& exchange) {
+    while (exchange.next_address < exchange.addresses.size()) {
+        const Address& address = exchange.addresses[exchange.next_address++];
+        const int fd = ::socket(address.storage.ss_family, SOCK_STREAM, 0);
+        if (fd < 0) continue;
+        ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+        setNoDelay(fd);
+        if (::connect(fd, reinterpret_cast<const sockaddr*>(&address.storage), address.length) == 0) {
+            exchange.fd = fd;
+            exchange.stage = Exchange::Stage::Sending;
+            return true;
+        }
+        if (errno == EINPROGRESS) {
+            exchange.fd = fd;
+            exchange.stage = Exchange::Stage::Connecting;
+            return true;
+        }
+        ::close(fd);
+    }
+    exchange.stage = Exchange::Stage::Failed;
+    return false;
+}
+
+void ShardedGallery::fail(Exchange& exchange) {
+    if (exchange.fd >= 0) ::close(exchange.fd);
+    exchange.fd = -1;
+    // 复用的空闲连接可能已被分片关闭（例如分片重启），此时换一个新连接重试一次
+    if (exchange.reused && Clock::now() < exchange.deadline) {
+        open(exchange, false);
+        return;
+    }
+    exchange.stage = Exchange::Stage::Failed;
+}
+
+void ShardedGallery::advance(Exchange& exchange, const std::vector<char>& request, size_t query_count) {
+    switch (exchange.stage) {
+    case Exchange::Stage::Connecting: {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        if (::getsockopt(exchange.fd, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+            // 这个地址连不上，换下一个地址
+            ::close(exchange.fd);
+            exchange.fd = -1;
+            connectNext(exchange);
+            return;
+        }
+        exchange.stage = Exchange::Stage::Sending;
+        return;
+    }
+    case Exchange::Stage::Sending: {
+        const ssize_t sent = ::send(exchange.fd, request.data() + exchange.sent, request.size() - exchange.sent,
+                                    MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) fail(exchange);
+            return;
+        }
+        exchange.sent += static_cast<size_t>(sent);
+        if (exchange.sent == request.size()) exchange.stage = Exchange::Stage::Receiving;
+        return;
+    }
+    case Exchange::Stage::Receiving: {
+        const size_t have = exchange.received.size();
+        exchange.received.resize(exchange.expected);
+        const ssize_t received = ::recv(exchange.fd, exchange.received.data() + have, exchange.expected - have, 0);
+        exchange.received.resize(have + static_cast<size_t>(std::max<ssize_t>(received, 0)));
+        if (received == 0) {  // 对端关闭
+            fail(exchange);
+            return;
+        }
+        if (received < 0) {
+            if (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) fail(exchange);
+            return;
+        }
+        if (exchange.received.size() < exchange.expected) return;
+
+        const size_t header_size = 2 * sizeof(uint32_t);
+        if (exchange.expected == header_size) {
+            uint32_t header[2];
+            std::memcpy(header, exchange.received.data(), sizeof(header));
+            if (header[0] != kResponseMagic || header[1] > kMaxPayloadBytes) {
+                ::close(exchange.fd);
+                exchange.fd = -1;
+                exchange.stage = Exchange::Stage::Failed;
+                return;
+            }
+            exchange.expected = header_size + header[1];
+            if (header[1] > 0) return;
+        }
+
+        const std::vector<char> payload(exchange.received.begin() + header_size, exchange.received.end());
+        if (!parseResponse(payload, query_count, exchange.results)) {
+            ::close(exchange.fd);
+            exchange.fd = -1;
+            exchange.stage = Exchange::Stage::Failed;
+            return;
+        }
+        std::lock_guard<std::mutex> lock(exchange.shard->mutex);
+        exchange.shard->idle.push_back(exchange.fd);
+        exchange.fd = -1;
+        exchange.stage = Exchange::Stage::Done;
+        return;
+    }
+    case Exchange::Stage::Done:
+    case Exchange::Stage::Failed:
+        return;
+    }
+}
+
+std::vector<std::vector<ShardMatch>> ShardedGallery::search(const std::vector<dlib::matrix<float,0,1>>& queries,
+                                                            size_t k, const std::vector<std::string>& watchlists) {
+    std::vector<std::vector<ShardMatch>> merged(queries.size());
+    if (queries.empty() || shards_.empty() || k == 0) return merged;
+
+    const uint32_t dim = static_cast<uint32_t>(queries.front().size());
+    std::vector<char> request = beginMessage(kRequestMagic);
+    appendU32(request, static_cast<uint32_t>(queries.size()));
+    appendU32(request, static_cast<uint32_t>(k));
+    appendU32(request, dim);
+    appendU32(request, static_cast<uint32_t>(watchlists.size()));
+    for (const auto& watchlist : watchlists) appendString(request, watchlist);
+    for (const auto& query : queries) {
+        if (query.size() == dim) {
+            if (dim > 0) appendBytes(request, &query(0), dim * sizeof(float));
+        } else {
+            request.resize(request.size() + dim * sizeof(float), 0);  // 维数不对的查询按零向量发送，结果丢弃
+        }
+    }
+    finishMessage(request);
+
+    // 所有分片的请求同时发出，在当前线程上用一个 poll() 等待；各分片的超时互不影响
+    std::vector<Exchange> exchanges(shards_.size());
+    const auto start = Clock::now();
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        exchanges[s].shard = shards_[s].get();
+        exchanges[s].deadline = start + shards_[s]->timeout;
+        open(exchanges[s], true);
+    }
+
+    std::vector<pollfd> fds;
+    std::vector<Exchange*> polled;
+    while (true) {
+        fds.clear();
+        polled.clear();
+        const auto now = Clock::now();
+        auto next_deadline = Clock::time_point::max();
+        for (auto& exchange : exchanges) {
+            if (exchange.stage == Exchange::Stage::Done || exchange.stage == Exchange::Stage::Failed) continue;
+            if (now >= exchange.deadline) {
+                ::close(exchange.fd);
+                exchange.fd = -1;
+                exchange.stage = Exchange::Stage::Failed;
+                continue;
+            }
+            next_deadline = std::min(next_deadline, exchange.deadline);
+            const short events = exchange.stage == Exchange::Stage::Receiving ? POLLIN : POLLOUT;
+            fds.push_back(pollfd{exchange.fd, events, 0});
+            polled.push_back(&exchange);
+        }
+        if (fds.empty()) break;
+
+        // 向上取整到毫秒，避免截止时间前空转
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_deadline - now).count() + 1;
+        const int ready = ::poll(fds.data(), fds.size(), static_cast<int>(wait));
+        if (ready < 0 && errno != EINTR) {
+            for (Exchange* exchange : polled) {
+                ::close(exchange->fd);
+                exchange->fd = -1;
+                exchange->stage = Exchange::Stage::Failed;
+            }
+            break;
+        }
+        for (size_t i = 0; i < fds.size() && ready > 0; ++i) {
+            if (fds[i].revents != 0) advance(*polled[i], request, queries.size());
+        }
+    }
+
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        Shard& shard = *shards_[s];
+        const bool healthy = exchanges[s].stage == Exchange::Stage::Done;
+        if (!healthy) ++failed_requests_;
+        // 只在分片状态变化时打日志，避免每帧刷屏
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (healthy != shard.healthy) {
+            shard.healthy = healthy;
+            std::cerr << "Gallery shard " << shard.endpoint.host << ":" << shard.endpoint.port
+                      << (healthy ? " is answering again." : " failed or timed out (" +
+                                                                 std::to_string(shard.timeout.count()) + " ms), skipping it.")
+                      << std::endl;
+        }
+    }
+
+    for (size_t q = 0; q < queries.size(); ++q) {
+        if (queries[q].size() != dim) continue;
+        for (size_t s = 0; s < shards_.size(); ++s) {
+            if (exchanges[s].stage != Exchange::Stage::Done) continue;
+            auto& hits = exchanges[s].results[q];
+            merged[q].insert(merged[q].end(), std::make_move_iterator(hits.begin()),
+                             std::make_move_iterator(hits.end()));
+        }
+        std::stable_sort(merged[q].begin(), merged[q].end(),
+                         [](const ShardMatch& a, const ShardMatch& b) { return a.distance < b.distance; });
+        if (merged[q].size() > k) merged[q].resize(k);
+    }
+    return merged;
+}
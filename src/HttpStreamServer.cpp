@@ -0,0 +1,180 @@
+#include "HttpStreamServer.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <chrono>
+#include <iostream>
+#include <sstream>
+
+namespace {
+std::string lower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+std::string trim(const std::string& text) {
+    const size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) return "";
+    const size_t end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+} // namespace
+
+const std::string& HttpStreamServer::Request::header(const std::string& name) const {
+    static const std::string empty;
+    const auto it = headers.find(lower(name));
+    return it == headers.end() ? empty : it->second;
+}
+
+bool HttpStreamServer::parseHead(const std::string& text, Request& request) {
+    std::istringstream iss(text);
+    std::string line;
+    if (!std::getline(iss, line)) return false;
+    std::istringstream request_line(line);
+    if (!(request_line >> request.method >> request.target >> request.version)) return false;
+    request.headers.clear();
+    while (std::getline(iss, line)) {
+        if (line == "\r" || line.empty()) return true;
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) return false;
+        request.headers[lower(trim(line.substr(0, colon)))] = trim(line.substr(colon + 1));
+    }
+    return false;
+}
+
+bool HttpStreamServer::parseContentLength(const std::string& text, size_t& length) {
+    length = 0;
+    if (text.empty()) return true;
+    // from_chars 对无符号类型不接受正负号，溢出时返回 result_out_of_range
+    const char* end = text.data() + text.size();
+    const auto parsed = std::from_chars(text.data(), end, length);
+    return parsed.ec == std::errc() && parsed.ptr == end;
+}
+
+HttpStreamServer::HttpStreamServer(size_t max_request_bytes) : max_request_bytes_(max_request_bytes) {}
+
+HttpStreamServer::~HttpStreamServer() { stop(); }
+
+void HttpStreamServer::route(const std::string& prefix, Handler handler) { routes_[prefix] = std::move(handler); }
+
+void HttpStreamServer::start(int port, int num_workers) {
+    publisher_.start(num_workers);
+    listener_
+        .withOnMessageCallback([this](const nadjieb::net::SocketFD& sockfd, const std::string& data) {
+            return onMessage(sockfd, data);
+        })
+        .withOnBeforeCloseCallback([this](const nadjieb::net::SocketFD& sockfd) { onClose(sockfd); })
+        .runAsync(port);
+    while (!isRunning()) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+void HttpStreamServer::stop() {
+    publisher_.stop();
+    listener_.stop();
+}
+
+void HttpStreamServer::publish(const std::string& topic, const std::string& buffer) {
+    publisher_.enqueue(topic, buffer);
+    // Publisher 为每个 topic 保留一份最新帧的副本，容量随最大的一帧增长、不会缩小，按最大帧计入内存报告
+    size_t& reported = topic_bytes_[topic];
+    if (buffer.size() > reported) {
+        reported = buffer.size();
+        MemoryTracker::getInstance().setComponentBytes("推流 topic 缓冲 (" + topic + ")", reported);
+    }
+}
+
+void HttpStreamServer::onClose(const nadjieb::net::SocketFD& sockfd) {
+    pending_.erase(sockfd);
+    publisher_.removeClient(sockfd);
+}
+
+void HttpStreamServer::send(const nadjieb::net::SocketFD& sockfd, const std::string& version,
+                            const Response& response) {
+    nadjieb::net::HTTPResponse res;
+    res.setVersion(version.empty() ? "HTTP/1.1" : version);
+    res.setStatusCode(response.status);
+    res.setStatusText(response.reason);
+    if (!response.content_type.empty()) res.setValue("Content-Type", response.content_type);
+    res.setValue("Content-Length", std::to_string(response.body.size()));
+    res.setValue("Connection", "close");
+    res.setBody(response.body);
+    const std::string text = res.serialize();
+    nadjieb::net::sendViaSocket(sockfd, text.c_str(), text.size(), 0);
+}
+
+nadjieb::net::OnMessageCallbackResponse HttpStreamServer::onMessage(const nadjieb::net::SocketFD& sockfd,
+                                                                    const std::string& data) {
+    nadjieb::net::OnMessageCallbackResponse result;
+    const auto reject = [&](int status, const std::string& reason, const std::string& version) {
+        pending_.erase(sockfd);
+        Response response;
+        response.status = status;
+        response.reason = reason;
+        response.content_type.clear();
+        send(sockfd, version, response);
+        result.close_conn = true;
+        return result;
+    };
+
+    // 一个请求可能分多次读到（上传的图片），收齐请求头和 Content-Length 字节的正文后再处理
+    std::string& buffered = pending_[sockfd];
+    buffered += data;
+    const size_t head_end = buffered.find("\r\n\r\n");
+    if (head_end == std::string::npos) {
+        if (buffered.size() > max_request_bytes_) return reject(413, "Payload Too Large", "");
+        return result;
+    }
+
+    Request request;
+    if (!parseHead(buffered.substr(0, head_end + 4), request)) return reject(400, "Bad Request", "");
+    size_t body_length = 0;
+    if (!parseContentLength(request.header("Content-Length"), body_length)) {
+        return reject(400, "Bad Request", request.version);
+    }
+    // 先比较再相加，很大的 Content-Length 不会让 head_end + 4 + body_length 回绕
+    if (head_end + 4 > max_request_bytes_ || body_length > max_request_bytes_ - (head_end + 4)) {
+        return reject(413, "Payload Too Large", request.version);
+    }
+    if (buffered.size() < head_end + 4 + body_length) return result;
+    request.body = buffered.substr(head_end + 4, body_length);
+    pending_.erase(sockfd);
+
+    for (const auto& route : routes_) {
+        if (request.target.compare(0, route.first.size(), route.first) != 0) continue;
+        Response response;
+        try {
+            response = route.second(request);
+        } catch (const std::exception& e) {
+            std::cerr << "HTTP handler for " << request.target << " failed: " << e.what() << std::endl;
+            response = Response();
+            response.status = 500;
+            response.reason = "Internal Server Error";
+            response.content_type.clear();
+        }
+        send(sockfd, request.version, response);
+        result.close_conn = true;
+        return result;
+    }
+
+    if (request.method != "GET") return reject(405, "Method Not Allowed", request.version);
+    if (!publisher_.pathExists(request.target)) return reject(404, "Not Found", request.version);
+
+    nadjieb::net::HTTPResponse init_res;
+    init_res.setVersion(request.version);
+    init_res.setStatusCode(200);
+    init_res.setStatusText("OK");
+    init_res.setValue("Connection", "close");
+    init_res.setValue("Cache-Control", "no-cache, no-store, must-revalidate, pre-check=0, post-check=0, max-age=0");
+    init_res.setValue("Pragma", "no-cache");
+    init_res.setValue("Content-Type", "multipart/x-mixed-replace; boundary=nadjiebmjpegstreamer");
+    const std::string init_text = init_res.serialize();
+    nadjieb::net::sendViaSocket(sockfd, init_text.c_str(), init_text.size(), 0);
+
+    publisher_.add(sockfd, request.target);
+    return result;
+}
@@ -0,0 +1,144 @@
+#include "InferenceContextPool.h"
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <iostream>
+
+InferenceContextPool::InferenceContextPool(anet_type& primary, size_t size)
+{
+    if (size == 0)
+        size = 1;
+
+    // 先清掉 primary 上一次前向留下的中间结果，避免把它们一起复制进副本
+    primary.clean();
+    all_.push_back(&primary);
+
+    // 每个上下文做一次预热前向，使中间结果缓存分配完毕，内存测量才有意义
+    dlib::matrix<dlib::rgb_pixel> warmup_chip(150, 150);
+    dlib::assign_all_pixels(warmup_chip, dlib::rgb_pixel(0, 0, 0));
+    primary(warmup_chip);
+
+    const size_t rss_before = MemoryTracker::residentBytes();
+    for (size_t i = 1; i < size; ++i)
+    {
+        primary.clean();
+        owned_.push_back(std::make_unique<anet_type>(primary));
+        (*owned_.back())(warmup_chip);
+        all_.push_back(owned_.back().get());
+    }
+    const size_t rss_after = MemoryTracker::residentBytes();
+
+    if (size > 1 && rss_after > rss_before)
+        bytes_per_extra_context_ = (rss_after - rss_before) / (size - 1);
+
+    idle_ = all_;
+    MemoryTracker::getInstance().setComponentBytes("额外推理上下文", bytes_per_extra_context_ * (size - 1));
+    std::cout << "Inference context pool: " << size << " context(s), ~"
+              << bytes_per_extra_context_ / (1024.0 * 1024.0) << " MB per extra context." << std::endl;
+
+    // 调用 parallelFor 的线程也参与计算，常驻线程比上下文少一个
+    for (size_t i = 1; i < size; ++i)
+        helpers_.emplace_back(&InferenceContextPool::helperLoop, this);
+}
+
+InferenceContextPool::~InferenceContextPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (auto& helper : helpers_)
+        helper.join();
+}
+
+InferenceContextPool::Lease InferenceContextPool::acquire()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    available_.wait(lock, [this] { return !idle_.empty(); });
+    anet_type* net = idle_.back();
+    idle_.pop_back();
+    return Lease(*this, net);
+}
+
+void InferenceContextPool::release(anet_type* net)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        idle_.push_back(net);
+    }
+    available_.notify_one();
+}
+
+void InferenceContextPool::parallelFor(size_t count, const std::function<void(size_t, anet_type&)>& job)
+{
+    if (count == 0)
+        return;
+    auto batch = std::make_shared<Batch>();
+    batch->count = count;
+    batch->job = &job;
+    if (count > 1 && !helpers_.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batches_.push_back(batch);
+        }
+        work_ready_.notify_all();
+    }
+
+    runJobs(*batch);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    batch_done_.wait(lock, [&batch] { return batch->done == batch->count; });
+    // 常驻线程可能还没来得及把领完的任务移出队列
+    const auto it = std::find(batches_.begin(), batches_.end(), batch);
+    if (it != batches_.end())
+        batches_.erase(it);
+    if (batch->error)
+        std::rethrow_exception(batch->error);
+}
+
+void InferenceContextPool::runJobs(Batch& batch)
+{
+    for (size_t i = batch.next++; i < batch.count; i = batch.next++)
+    {
+        std::exception_ptr error;
+        try
+        {
+            auto lease = acquire();
+            (*batch.job)(i, lease.net());
+        }
+        catch (...)
+        {
+            error = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (error && !batch.error)
+            batch.error = error;
+        if (++batch.done == batch.count)
+            batch_done_.notify_all();
+    }
+}
+
+void InferenceContextPool::helperLoop()
+{
+    while (true)
+    {
+        std::shared_ptr<Batch> batch;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_ready_.wait(lock, [this] { return stopping_ || !batches_.empty(); });
+            if (stopping_)
+                return;
+            batch = batches_.front();
+            if (batch->next >= batch->count)
+            {
+                // 任务已被领完，移出队列后看下一批
+                batches_.pop_front();
+                continue;
+            }
+        }
+        runJobs(*batch);
+    }
+}
@@ -0,0 +1,196 @@
+#include "MemoryTracker.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <unistd.h>
+
+MemoryTracker::StageCounters MemoryTracker::counters_[MemoryTracker::kMaxStages];
+thread_local int MemoryTracker::current_stage_ = MemoryTracker::kUntrackedStage;
+
+MemoryTracker& MemoryTracker::getInstance() {
+    static MemoryTracker instance;
+    return instance;
+}
+
+int MemoryTracker::registerStage(const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stage_ids_.find(name);
+    if (it != stage_ids_.end()) {
+        return it->second;
+    }
+    if (static_cast<int>(stage_names_.size()) >= kMaxStages) {
+        return kUntrackedStage;
+    }
+    int id = static_cast<int>(stage_names_.size());
+    stage_names_.push_back(name);
+    stage_ids_.emplace(name, id);
+    return id;
+}
+
+void MemoryTracker::recordAlloc(int stage, size_t bytes) {
+    counters_[stage].allocs.fetch_add(1, std::memory_order_relaxed);
+    counters_[stage].bytes_allocated.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::recordFree(int stage, size_t bytes) {
+    counters_[stage].frees.fetch_add(1, std::memory_order_relaxed);
+    counters_[stage].bytes_freed.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void MemoryTracker::setComponentBytes(const std::string& component, size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    components_[component] = bytes;
+}
+
+std::map<std::string, size_t> MemoryTracker::getComponents() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return components_;
+}
+
+std::vector<MemoryTracker::StageStats> MemoryTracker::getStageStats() const {
+    std::vector<StageStats> stats;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < stage_names_.size(); ++i) {
+        const StageCounters& c = counters_[i];
+        StageStats s;
+        s.name = stage_names_[i];
+        s.allocs = c.allocs.load(std::memory_order_relaxed);
+        s.frees = c.frees.load(std::memory_order_relaxed);
+        s.bytes_allocated = c.bytes_allocated.load(std::memory_order_relaxed);
+        s.live_bytes = static_cast<int64_t>(s.bytes_allocated)
+                     - static_cast<int64_t>(c.bytes_freed.load(std::memory_order_relaxed));
+        if (s.allocs > 0 || s.frees > 0) {
+            stats.push_back(s);
+        }
+    }
+    std::sort(stats.begin(), stats.end(), [](const StageStats& a, const StageStats& b) {
+        return a.bytes_allocated > b.bytes_allocated;
+    });
+    return stats;
+}
+
+size_t MemoryTracker::residentBytes() {
+    // /proc/self/statm 第二列是常驻页数
+    std::ifstream statm("/proc/self/statm");
+    size_t total_pages = 0;
+    size_t resident_pages = 0;
+    if (!(statm >> total_pages >> resident_pages)) {
+        return 0;
+    }
+    return resident_pages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+void MemoryTracker::printReport(const std::map<std::string, size_t>& extra_components) const {
+    const double mb = 1024.0 * 1024.0;
+    std::cout << "Memory:\n";
+    std::cout << "  Resident (RSS): " << residentBytes() / mb << " MB\n";
+
+    auto components = getComponents();
+    for (const auto& [name, bytes] : extra_components) {
+        components[name] = bytes;
+    }
+    if (!components.empty()) {
+        std::cout << "  Components:\n";
+        for (const auto& [name, bytes] : components) {
+            std::cout << "    " << std::setw(20) << std::left << name << ": " << bytes / mb << " MB\n";
+        }
+    }
+
+    if (!allocationTrackingEnabled()) {
+        return;
+    }
+    std::cout << "  Allocations by stage:\n";
+    for (const auto& s : getStageStats()) {
+        std::cout << "    " << std::setw(20) << std::left << s.name << ": "
+                  << "Allocs: " << std::setw(10) << s.allocs
+                  << " Bytes: " << std::setw(10) << s.bytes_allocated / mb << "MB"
+                  << " Live: " << std::setw(10) << s.live_bytes / mb << "MB\n";
+    }
+}
+
+void MemoryTracker::reset() {
+    // 只清计数；存活字节会随之失真，因此 reset 后的 Live 只反映 reset 之后的净变化
+    for (auto& c : counters_) {
+        c.allocs.store(0, std::memory_order_relaxed);
+        c.frees.store(0, std::memory_order_relaxed);
+        c.bytes_allocated.store(0, std::memory_order_relaxed);
+        c.bytes_freed.store(0, std::memory_order_relaxed);
+    }
+}
+
+#ifdef DDFG_ALLOC_TRACKING
+// ---------------------------------------------------------------------------
+// 全局 operator new/delete 替换
+// 每块内存前放一个 16 字节的头，记录大小、所属阶段和到原始指针的偏移，
+// 释放时据此把字节数记回分配时的阶段。
+// ---------------------------------------------------------------------------
+namespace {
+struct AllocHeader {
+    size_t size;
+    int32_t stage;
+    uint32_t offset;
+};
+static_assert(sizeof(AllocHeader) == 16, "AllocHeader must keep 16-byte alignment");
+
+void* trackedAlloc(size_t size, size_t alignment) {
+    size_t offset = alignment > sizeof(AllocHeader) ? alignment : sizeof(AllocHeader);
+    void* raw = nullptr;
+    if (alignment > alignof(std::max_align_t)) {
+        size_t total = (size + offset + alignment - 1) / alignment * alignment;
+        raw = std::aligned_alloc(alignment, total);
+    } else {
+        raw = std::malloc(size + offset);
+    }
+    if (raw == nullptr) {
+        return nullptr;
+    }
+
+    char* user = static_cast<char*>(raw) + offset;
+    AllocHeader* header = reinterpret_cast<AllocHeader*>(user) - 1;
+    header->size = size;
+    header->stage = MemoryTracker::currentStage();
+    header->offset = static_cast<uint32_t>(offset);
+    MemoryTracker::recordAlloc(header->stage, size);
+    return user;
+}
+
+void trackedFree(void* ptr) noexcept {
+    if (ptr == nullptr) {
+        return;
+    }
+    AllocHeader* header = static_cast<AllocHeader*>(ptr) - 1;
+    MemoryTracker::recordFree(header->stage, header->size);
+    std::free(static_cast<char*>(ptr) - header->offset);
+}
+
+void* allocOrThrow(size_t size, size_t alignment) {
+    void* ptr = trackedAlloc(size == 0 ? 1 : size, alignment);
+    if (ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+} // namespace
+
+void* operator new(size_t size) { return allocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new[](size_t size) { return allocOrThrow(size, alignof(std::max_align_t)); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size == 0 ? 1 : size, alignof(std::max_align_t)); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size == 0 ? 1 : size, alignof(std::max_align_t)); }
+void* operator new(size_t size, std::align_val_t al) { return allocOrThrow(size, static_cast<size_t>(al)); }
+void* operator new[](size_t size, std::align_val_t al) { return allocOrThrow(size, static_cast<size_t>(al)); }
+
+void operator delete(void* ptr) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { trackedFree(ptr); }
+#endif // DDFG_ALLOC_TRACKING
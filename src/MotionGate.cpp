@@ -0,0 +1,62 @@
+#include "MotionGate.h"
+#include "PerformanceMonitor.h"
+
+#include <algorithm>
+
+MotionGateOptions MotionGateOptions::fromJson(const json& node, const MotionGateOptions& defaults) {
+    MotionGateOptions options = defaults;
+    if (!node.is_object()) return options;
+    options.enabled = node.value("enabled", defaults.enabled);
+    options.thumbnail_width = std::max(8, node.value("thumbnail_width", defaults.thumbnail_width));
+    options.pixel_threshold = node.value("pixel_threshold", defaults.pixel_threshold);
+    options.min_changed_fraction = node.value("min_changed_fraction", defaults.min_changed_fraction);
+    options.hold_frames = node.value("hold_frames", defaults.hold_frames);
+    options.track_max_missed = node.value("track_max_missed", defaults.track_max_missed);
+    options.keyframe_interval = node.value("keyframe_interval", defaults.keyframe_interval);
+    return options;
+}
+
+MotionGate::MotionGate(const MotionGateOptions& options)
+    : options_(options), tracker_(options.track_max_missed) {}
+
+bool MotionGate::shouldDetect(const cv::Mat& frame) {
+    PM_SCOPED(运动检测);
+
+    // 先缩小再转灰度，只在几千个像素上计算
+    const int width = std::min(options_.thumbnail_width, frame.cols);
+    const int height = std::max(1, frame.rows * width / std::max(1, frame.cols));
+    cv::Mat small;
+    cv::resize(frame, small, cv::Size(width, height), 0, 0, cv::INTER_AREA);
+    if (small.channels() == 3) {
+        cv::cvtColor(small, thumbnail_, cv::COLOR_BGR2GRAY);
+    } else {
+        thumbnail_ = small;
+    }
+    cv::GaussianBlur(thumbnail_, thumbnail_, cv::Size(3, 3), 0);  // 压掉传感器噪声
+
+    bool changed = true;  // 第一帧没有参考，总是检测
+    if (!previous_.empty() && previous_.size() == thumbnail_.size()) {
+        cv::absdiff(thumbnail_, previous_, diff_);
+        const int changed_pixels = cv::countNonZero(diff_ > options_.pixel_threshold);
+        last_changed_fraction_ = static_cast<double>(changed_pixels) / diff_.total();
+        changed = last_changed_fraction_ > options_.min_changed_fraction;
+    }
+    cv::swap(previous_, thumbnail_);
+
+    if (changed) {
+        hold_remaining_ = options_.hold_frames;
+    }
+    const bool keyframe = options_.keyframe_interval > 0 && frames_since_detect_ + 1 >= options_.keyframe_interval;
+    const bool detect = changed || hold_remaining_ > 0 || trackActive() || keyframe;
+
+    if (hold_remaining_ > 0) --hold_remaining_;
+    frames_since_detect_ = detect ? 0 : frames_since_detect_ + 1;
+    return detect;
+}
+
+void MotionGate::observe(const std::vector<FaceResult>& faces) {
+    std::vector<dlib::rectangle> boxes;
+    boxes.reserve(faces.size());
+    for (const auto& face : faces) boxes.push_back(face.rect);
+    tracker_.update(boxes);
+}
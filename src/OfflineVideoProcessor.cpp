@@ -0,0 +1,219 @@
+#include "OfflineVideoProcessor.h"
+#include "ConfigParser.h"
+#include "FaceRecognition.hpp"
+#include "FramePipeline.h"
+#include "PerformanceMonitor.h"
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+// 解码出的一帧
+struct DecodedFrame {
+    size_t index = 0;
+    double timestamp_ms = 0.0;
+    cv::Mat image;
+};
+
+// 一帧的识别结果，等待按顺序写入日志
+struct FrameRecord {
+    double timestamp_ms = 0.0;
+    std::vector<FaceResult> faces;
+};
+} // namespace
+
+OfflineOptions OfflineOptions::fromConfig(const ConfigParser& config) {
+    OfflineOptions options;
+    options.video_path = config.settings().video_path;
+    options.log_path = config.get<std::string>("offline.log_path", options.log_path);
+    options.workers = static_cast<size_t>(std::max(0, config.get<int>("offline.workers", 0)));
+    options.queue_capacity = static_cast<size_t>(std::max(0, config.get<int>("offline.queue_capacity", 0)));
+    options.pipeline = PipelineOptions::fromConfig(config);
+    return options;
+}
+
+OfflineVideoProcessor::OfflineVideoProcessor(FaceRecognition& recognizer, const OfflineOptions& options)
+    : recognizer_(recognizer), options_(options) {
+    if (options_.workers == 0) {
+        options_.workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (options_.queue_capacity == 0) {
+        options_.queue_capacity = options_.workers * 4;
+    }
+    // 多个工作线程时每条流水线拿到的帧不连续，不能沿轨迹传递识别结果
+    options_.pipeline.sequential_frames = options_.workers == 1;
+    // 每个工作线程各有一个检测器；检测线程总数不超过 CPU 核数，多余的线程只会互相抢占
+    const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+    const size_t per_worker = std::max<size_t>(1, cores / options_.workers);
+    size_t& detection_threads = options_.pipeline.detection.threads;
+    if (detection_threads == 0 || detection_threads > per_worker) {
+        detection_threads = per_worker;
+    }
+}
+
+bool OfflineVideoProcessor::run() {
+    cv::VideoCapture cap(options_.video_path);
+    if (!cap.isOpened()) {
+        std::cerr << "Error: Failed to open video file: " << options_.video_path << std::endl;
+        return false;
+    }
+    std::ofstream log(options_.log_path, std::ios::trunc);
+    if (!log.is_open()) {
+        std::cerr << "Error: Failed to open recognition log: " << options_.log_path << std::endl;
+        return false;
+    }
+    log << "frame,timestamp_ms,name,left,top,right,bottom\n";
+
+    // 检测器有内部状态，每个工作线程一条流水线。在当前线程上创建，检测后端名写错、模型文件缺失时
+    // 异常直接抛给调用方，而不是在工作线程里终止进程
+    std::vector<std::unique_ptr<FramePipeline>> pipelines;
+    for (size_t w = 0; w < options_.workers; ++w) {
+        pipelines.push_back(std::make_unique<FramePipeline>(recognizer_, options_.pipeline));
+    }
+
+    const double video_fps = cap.get(cv::CAP_PROP_FPS);
+    std::cout << "Offline processing " << options_.video_path << " with " << options_.workers
+              << " worker(s) x " << options_.pipeline.detection.threads << " detection thread(s), log -> "
+              << options_.log_path << std::endl;
+
+    // 解码线程 -> 工作线程：有界队列，限制解码超前占用的内存
+    std::mutex queue_mutex;
+    std::condition_variable queue_not_empty;
+    std::condition_variable queue_not_full;
+    std::deque<DecodedFrame> queue;
+    bool decode_done = false;
+    std::exception_ptr worker_error;  // 第一个出错的工作线程的异常，出错后解码和其余工作线程尽快停下
+
+    // 工作线程 -> 写日志（当前线程）：按帧号重排
+    std::mutex result_mutex;
+    std::condition_variable result_ready;
+    std::map<size_t, FrameRecord> results;
+    size_t workers_done = 0;
+
+    const auto start_time = PerformanceMonitor::Clock::now();
+
+    std::thread decoder([&] {
+        size_t index = 0;
+        while (true) {
+            DecodedFrame frame;
+            {
+                PM_SCOPED(视频解码);
+                if (!cap.read(frame.image) || frame.image.empty()) break;
+            }
+            frame.index = index++;
+            frame.timestamp_ms = cap.get(cv::CAP_PROP_POS_MSEC);
+
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_not_full.wait(lock, [&] { return decode_done || queue.size() < options_.queue_capacity; });
+            if (decode_done) break;
+            queue.push_back(std::move(frame));
+            lock.unlock();
+            queue_not_empty.notify_one();
+        }
+        {
+            std::lock_guard<std::mutex> lock(queue_mutex);
+            decode_done = true;
+        }
+        queue_not_empty.notify_all();
+    });
+
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < options_.workers; ++w) {
+        workers.emplace_back([&, w] {
+            FramePipeline& pipeline = *pipelines[w];
+            auto& monitor = PerformanceMonitor::getInstance();
+            try {
+                while (true) {
+                    DecodedFrame frame;
+                    {
+                        std::unique_lock<std::mutex> lock(queue_mutex);
+                        queue_not_empty.wait(lock, [&] { return decode_done || !queue.empty(); });
+                        if (queue.empty()) break;
+                        frame = std::move(queue.front());
+                        queue.pop_front();
+                    }
+                    queue_not_full.notify_one();
+
+                    FrameRecord record;
+                    record.timestamp_ms = frame.timestamp_ms;
+                    monitor.startFrame();
+                    record.faces = pipeline.analyze(frame.image);
+                    monitor.stopFrame();
+
+                    {
+                        std::lock_guard<std::mutex> lock(result_mutex);
+                        results.emplace(frame.index, std::move(record));
+                    }
+                    result_ready.notify_one();
+                }
+            } catch (...) {
+                // 记下异常，丢弃排队的帧并让解码线程停止，由 run() 在所有线程结束后重新抛出
+                {
+                    std::lock_guard<std::mutex> lock(queue_mutex);
+                    if (!worker_error) worker_error = std::current_exception();
+                    decode_done = true;
+                    queue.clear();
+                }
+                queue_not_full.notify_all();
+                queue_not_empty.notify_all();
+            }
+            {
+                std::lock_guard<std::mutex> lock(result_mutex);
+                ++workers_done;
+            }
+            result_ready.notify_one();
+        });
+    }
+
+    // 按帧号顺序写日志
+    size_t next_frame = 0;
+    size_t face_count = 0;
+    while (true) {
+        FrameRecord record;
+        {
+            std::unique_lock<std::mutex> lock(result_mutex);
+            // 工作线程全部结束后仍缺的帧号即为结尾（出错时之后的结果不再写入）
+            result_ready.wait(lock, [&] { return results.count(next_frame) > 0 || workers_done == workers.size(); });
+            auto it = results.find(next_frame);
+            if (it == results.end()) break;
+            record = std::move(it->second);
+            results.erase(it);
+        }
+        for (const auto& face : record.faces) {
+            log << next_frame << ',' << record.timestamp_ms << ',' << face.name << ','
+                << face.rect.left() << ',' << face.rect.top() << ','
+                << face.rect.right() << ',' << face.rect.bottom() << '\n';
+        }
+        face_count += record.faces.size();
+        ++next_frame;
+    }
+
+    decoder.join();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    log.flush();
+    if (worker_error) {
+        std::rethrow_exception(worker_error);
+    }
+
+    const double elapsed_s = std::chrono::duration<double>(PerformanceMonitor::Clock::now() - start_time).count();
+    const double throughput = elapsed_s > 0 ? next_frame / elapsed_s : 0.0;
+    std::cout << "Offline processing finished: " << next_frame << " frames, " << face_count << " faces in "
+              << elapsed_s << " s (" << throughput << " FPS";
+    if (video_fps > 0) {
+        std::cout << ", " << throughput / video_fps << "x real time";
+    }
+    std::cout << ")." << std::endl;
+    return true;
+}
@@ -2,6 +2,25 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm> // For std::sort
+#include <fstream>
+#include "nlohmann/json.hpp"
+
+namespace {
+// 启动时间线的零点：静态初始化时刻，近似为进程启动时间
+const PerformanceMonitor::TimePoint kProcessStart = PerformanceMonitor::Clock::now();
+
+// 每个线程各自的计时起点
+thread_local std::unordered_map<std::string, PerformanceMonitor::TimePoint> t_running_tasks;
+thread_local PerformanceMonitor::TimePoint t_frame_start_time;
+
+// 计算分位数（最近秩法），q 取 0~1
+double percentileMs(std::vector<long long> samples, double q) {
+    if (samples.empty()) return 0.0;
+    size_t rank = static_cast<size_t>(q * (samples.size() - 1) + 0.5);
+    std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+    return static_cast<double>(samples[rank]) / 1000000.0;
+}
+} // namespace
 
 PerformanceMonitor& PerformanceMonitor::getInstance() {
     static PerformanceMonitor instance;
@@ -9,39 +28,50 @@ PerformanceMonitor& PerformanceMonitor::getInstance() {
 }
 
 void PerformanceMonitor::startTask(const std::string& task_name) {
-    TaskStats& stats = task_data_[task_name];
-    if (stats.is_running) {
+    auto inserted = t_running_tasks.emplace(task_name, Clock::now());
+    if (!inserted.second) {
         // std::cerr << "[WARN] Task '" << task_name << "' already started. Ignoring consecutive start." << std::endl;
         return; // 防止重复开始导致错误
     }
-    stats.current_start_time = Clock::now();
-    stats.is_running = true;
 }
 
 void PerformanceMonitor::stopTask(const std::string& task_name) {
-    TaskStats& stats = task_data_[task_name];
-    if (!stats.is_running) {
+    TimePoint end_time = Clock::now();
+    auto it = t_running_tasks.find(task_name);
+    if (it == t_running_tasks.end()) {
         // std::cerr << "[WARN] Task '" << task_name << "' not started. Ignoring stop." << std::endl;
         return; // 防止停止未开始的任务
     }
-    TimePoint end_time = Clock::now();
-    DurationNs duration = std::chrono::duration_cast<DurationNs>(end_time - stats.current_start_time);
-    stats.addDuration(duration.count());
-    stats.is_running = false;
+    DurationNs duration = std::chrono::duration_cast<DurationNs>(end_time - it->second);
+    t_running_tasks.erase(it);
+    recordDuration(task_name, duration);
+}
+
+void PerformanceMonitor::recordDuration(const std::string& task_name, DurationNs duration) {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    task_data_[task_name].addDuration(duration.count());
+}
+
+void PerformanceMonitor::recordValue(const std::string& metric_name, double value) {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    metric_data_[metric_name].push_back(value);
 }
 
 void PerformanceMonitor::startFrame() {
-    frame_start_time_ = Clock::now();
+    t_frame_start_time = Clock::now();
 }
 
 void PerformanceMonitor::stopFrame() {
     TimePoint end_time = Clock::now();
-    DurationNs duration = std::chrono::duration_cast<DurationNs>(end_time - frame_start_time_);
+    DurationNs duration = std::chrono::duration_cast<DurationNs>(end_time - t_frame_start_time);
+    std::lock_guard<std::mutex> lock(data_mutex_);
     frame_durations_ns_.push_back(duration.count());
 }
 
 void PerformanceMonitor::printReport() const {
-    if (frame_durations_ns_.empty() && task_data_.empty()) {
+    FrameSummary frame = getFrameSummary();
+    std::vector<TaskSummary> tasks = getTaskSummaries();
+    if (frame.frames == 0 && tasks.empty() && getMetricSummaries().empty()) {
         std::cout << "No performance data to report." << std::endl;
         return;
     }
@@ -49,60 +79,204 @@ void PerformanceMonitor::printReport() const {
     std::cout << "\n--- Performance Report ---\n";
     std::cout << std::fixed << std::setprecision(2);
 
-    if (!frame_durations_ns_.empty()) {
-        long long total_frame_ns = 0;
-        long long min_frame_ns = -1;
-        long long max_frame_ns = -1;
-        for (long long ns : frame_durations_ns_) {
-            total_frame_ns += ns;
-            if (min_frame_ns == -1 || ns < min_frame_ns) {
-                min_frame_ns = ns;
-            }
-            if (ns > max_frame_ns) {
-                max_frame_ns = ns;
-            }
-        }
+    if (frame.frames > 0) {
+        std::cout << "Total Frames Processed: " << frame.frames << " frames\n";
+        std::cout << "Overall Frame Processing:\n";
+        std::cout << "  Min: " << frame.min_ms << " ms\n";
+        std::cout << "  Max: " << frame.max_ms << " ms\n";
+        std::cout << "  Avg: " << frame.avg_ms << " ms\n";
+        std::cout << "  P50: " << frame.p50_ms << " ms\n";
+        std::cout << "  P99: " << frame.p99_ms << " ms\n";
+        std::cout << "  FPS: " << frame.fps << " FPS\n\n";
+    }
 
-        double avg_frame_ms = static_cast<double>(total_frame_ns) / frame_durations_ns_.size() / 1000000.0;
-        double min_frame_ms = static_cast<double>(min_frame_ns) / 1000000.0;
-        double max_frame_ms = static_cast<double>(max_frame_ns) / 1000000.0;
-        double fps = (avg_frame_ms > 0) ? (1000.0 / avg_frame_ms) : 0.0;
+    std::cout << "Task Breakdown:\n";
+    for (const auto& task : tasks) {
+        std::cout << "  " << std::setw(20) << std::left << task.name << ": "
+                  << "Runs: " << std::setw(6) << task.runs
+                  << " Avg: " << std::setw(8) << task.avg_ms << "ms"
+                  << " P50: " << std::setw(8) << task.p50_ms << "ms"
+                  << " P99: " << std::setw(8) << task.p99_ms << "ms"
+                  << " Min: " << std::setw(8) << task.min_ms << "ms"
+                  << " Max: " << std::setw(8) << task.max_ms << "ms\n";
+    }
 
-        std::cout << "Total Frames Processed: " << frame_durations_ns_.size() << " frames\n";
-        std::cout << "Overall Frame Processing:\n";
-        std::cout << "  Min: " << min_frame_ms << " ms\n";
-        std::cout << "  Max: " << max_frame_ms << " ms\n";
-        std::cout << "  Avg: " << avg_frame_ms << " ms\n";
-        std::cout << "  FPS: " << fps << " FPS\n\n";
+    std::vector<MetricSummary> metrics = getMetricSummaries();
+    if (!metrics.empty()) {
+        std::cout << "\nMetrics:\n";
+        for (const auto& metric : metrics) {
+            std::cout << "  " << std::setw(20) << std::left << metric.name << ": "
+                      << "Count: " << std::setw(6) << metric.count
+                      << " Avg: " << std::setw(8) << metric.avg
+                      << " P50: " << std::setw(8) << metric.p50
+                      << " P99: " << std::setw(8) << metric.p99
+                      << " Max: " << std::setw(8) << metric.max << "\n";
+        }
     }
+    std::cout << "\n";
+    MemoryTracker::getInstance().printReport({{"性能统计数据", memoryBytes()}});
+    std::cout << "---------------------------\n";
+}
 
-    std::vector<std::pair<std::string, const TaskStats*>> sorted_tasks;
+std::vector<PerformanceMonitor::TaskSummary> PerformanceMonitor::getTaskSummaries() const {
+    std::vector<TaskSummary> summaries;
+    std::lock_guard<std::mutex> lock(data_mutex_);
     for (const auto& pair : task_data_) {
-        sorted_tasks.push_back({pair.first, &pair.second});
+        const TaskStats& stats = pair.second;
+        if (stats.num_runs == 0) continue;
+
+        TaskSummary summary;
+        summary.name = pair.first;
+        summary.runs = stats.num_runs;
+        summary.avg_ms = stats.getAverageMs();
+        summary.min_ms = static_cast<double>(stats.min_ns) / 1000000.0;
+        summary.max_ms = static_cast<double>(stats.max_ns) / 1000000.0;
+        summary.p50_ms = percentileMs(stats.durations_ns, 0.50);
+        summary.p99_ms = percentileMs(stats.durations_ns, 0.99);
+        summaries.push_back(summary);
     }
 
     // 按平均耗时降序排序，找出最耗时的任务
-    std::sort(sorted_tasks.begin(), sorted_tasks.end(), [](const auto& a, const auto& b) {
-        return a.second->getAverageMs() > b.second->getAverageMs();
+    std::sort(summaries.begin(), summaries.end(), [](const TaskSummary& a, const TaskSummary& b) {
+        return a.avg_ms > b.avg_ms;
     });
+    return summaries;
+}
 
-    std::cout << "Task Breakdown:\n";
-    for (const auto& pair : sorted_tasks) {
-        const std::string& task_name = pair.first;
-        const TaskStats& stats = *pair.second;
-        if (stats.num_runs > 0) {
-            std::cout << "  " << std::setw(20) << std::left << task_name << ": "
-                      << "Runs: " << std::setw(6) << stats.num_runs
-                      << " Avg: " << std::setw(8) << stats.getAverageMs() << "ms"
-                      << " Min: " << std::setw(8) << (double)stats.min_ns / 1000000.0 << "ms"
-                      << " Max: " << std::setw(8) << (double)stats.max_ns / 1000000.0 << "ms\n";
+PerformanceMonitor::FrameSummary PerformanceMonitor::getFrameSummary() const {
+    FrameSummary summary;
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    if (frame_durations_ns_.empty()) return summary;
+
+    long long total_frame_ns = std::accumulate(frame_durations_ns_.begin(), frame_durations_ns_.end(), 0LL);
+    summary.frames = static_cast<long long>(frame_durations_ns_.size());
+    summary.avg_ms = static_cast<double>(total_frame_ns) / frame_durations_ns_.size() / 1000000.0;
+    summary.min_ms = static_cast<double>(*std::min_element(frame_durations_ns_.begin(), frame_durations_ns_.end())) / 1000000.0;
+    summary.max_ms = static_cast<double>(*std::max_element(frame_durations_ns_.begin(), frame_durations_ns_.end())) / 1000000.0;
+    summary.p50_ms = percentileMs(frame_durations_ns_, 0.50);
+    summary.p99_ms = percentileMs(frame_durations_ns_, 0.99);
+    summary.fps = (summary.avg_ms > 0) ? (1000.0 / summary.avg_ms) : 0.0;
+    return summary;
+}
+
+std::vector<PerformanceMonitor::MetricSummary> PerformanceMonitor::getMetricSummaries() const {
+    std::vector<MetricSummary> summaries;
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    for (const auto& pair : metric_data_) {
+        std::vector<double> values = pair.second;
+        if (values.empty()) continue;
+        std::sort(values.begin(), values.end());
+
+        MetricSummary summary;
+        summary.name = pair.first;
+        summary.count = static_cast<long long>(values.size());
+        summary.avg = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+        summary.p50 = values[static_cast<size_t>(0.50 * (values.size() - 1) + 0.5)];
+        summary.p99 = values[static_cast<size_t>(0.99 * (values.size() - 1) + 0.5)];
+        summary.max = values.back();
+        summaries.push_back(summary);
+    }
+    std::sort(summaries.begin(), summaries.end(), [](const MetricSummary& a, const MetricSummary& b) {
+        return a.name < b.name;
+    });
+    return summaries;
+}
+
+bool PerformanceMonitor::writeJson(const std::string& path) const {
+    nlohmann::json report;
+    FrameSummary frame = getFrameSummary();
+    report["frames"] = {
+        {"count", frame.frames}, {"avg_ms", frame.avg_ms},
+        {"p50_ms", frame.p50_ms}, {"p99_ms", frame.p99_ms}, {"fps", frame.fps}};
+    for (const auto& task : getTaskSummaries()) {
+        report["tasks"][task.name] = {
+            {"runs", task.runs}, {"avg_ms", task.avg_ms}, {"min_ms", task.min_ms},
+            {"max_ms", task.max_ms}, {"p50_ms", task.p50_ms}, {"p99_ms", task.p99_ms}};
+    }
+    for (const auto& metric : getMetricSummaries()) {
+        report["metrics"][metric.name] = {
+            {"count", metric.count}, {"avg", metric.avg}, {"p50", metric.p50},
+            {"p99", metric.p99}, {"max", metric.max}};
+    }
+
+    // 统计数据自身的占用只并入本次报告，不写回 MemoryTracker
+    const auto& memory = MemoryTracker::getInstance();
+    auto components = memory.getComponents();
+    components["性能统计数据"] = memoryBytes();
+    report["memory"]["resident_bytes"] = MemoryTracker::residentBytes();
+    report["memory"]["components"] = components;
+    if (MemoryTracker::allocationTrackingEnabled()) {
+        for (const auto& stage : memory.getStageStats()) {
+            report["memory"]["stages"][stage.name] = {
+                {"allocs", stage.allocs}, {"frees", stage.frees},
+                {"bytes_allocated", stage.bytes_allocated}, {"live_bytes", stage.live_bytes}};
         }
     }
-    std::cout << "---------------------------\n";
+
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Error: Failed to write performance report: " << path << std::endl;
+        return false;
+    }
+    out << report.dump(4) << std::endl;
+    return true;
+}
+
+void PerformanceMonitor::recordStartupPhase(const std::string& phase, TimePoint start, TimePoint end) {
+    std::lock_guard<std::mutex> lock(startup_mutex_);
+    startup_phases_.push_back({phase, start, end});
+}
+
+void PerformanceMonitor::printStartupTimeline() const {
+    std::vector<StartupPhase> phases;
+    {
+        std::lock_guard<std::mutex> lock(startup_mutex_);
+        phases = startup_phases_;
+    }
+    if (phases.empty()) {
+        return;
+    }
+    std::sort(phases.begin(), phases.end(), [](const StartupPhase& a, const StartupPhase& b) {
+        return a.start < b.start;
+    });
+
+    auto offsetMs = [](TimePoint t) {
+        return std::chrono::duration<double, std::milli>(t - kProcessStart).count();
+    };
+    TimePoint last_end = phases.front().end;
+
+    std::cout << "\n--- Startup Timeline ---\n";
+    std::cout << std::fixed << std::setprecision(1);
+    for (const auto& phase : phases) {
+        last_end = std::max(last_end, phase.end);
+        std::cout << "  [" << std::setw(8) << std::right << offsetMs(phase.start) << " ms -> "
+                  << std::setw(8) << offsetMs(phase.end) << " ms] "
+                  << std::setw(8) << offsetMs(phase.end) - offsetMs(phase.start) << " ms  "
+                  << phase.name << "\n";
+    }
+    std::cout << "  Total: " << offsetMs(last_end) << " ms since process start\n";
+    std::cout << "------------------------\n";
+}
+
+size_t PerformanceMonitor::memoryBytes() const {
+    std::lock_guard<std::mutex> lock(data_mutex_);
+    size_t bytes = frame_durations_ns_.capacity() * sizeof(long long);
+    for (const auto& pair : task_data_) {
+        bytes += sizeof(pair) + pair.first.capacity() + pair.second.durations_ns.capacity() * sizeof(long long);
+    }
+    for (const auto& pair : metric_data_) {
+        bytes += sizeof(pair) + pair.first.capacity() + pair.second.capacity() * sizeof(double);
+    }
+    return bytes;
 }
 
 void PerformanceMonitor::reset() {
-    task_data_.clear();
-    frame_durations_ns_.clear();
+    {
+        std::lock_guard<std::mutex> lock(data_mutex_);
+        task_data_.clear();
+        metric_data_.clear();
+        frame_durations_ns_.clear();
+    }
+    MemoryTracker::getInstance().reset();
     std::cout << "Performance data reset.\n";
 }
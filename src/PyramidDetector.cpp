@@ -0,0 +1,222 @@
+#include "PyramidDetector.h"
+#include "PerformanceMonitor.h"
+
+#include <dlib/opencv.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+// fhog 的单元大小；条带起点必须按单元对齐，才能与整层扫描得到相同的特征
+const int kCellSize = 8;
+// 条带上下各多留的行数，覆盖梯度和块归一化用到的相邻单元
+const int kStripMargin = 3 * kCellSize;
+} // namespace
+
+PyramidDetector::PyramidDetector(const DetectionOptions& options) : options_(options) {
+    if (options_.threads == 0) {
+        options_.threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const dlib::frontal_face_detector base = dlib::get_frontal_face_detector();
+
+    // 复用 dlib 自带的 HOG 滤波器，只是让扫描器只看传入的那一层；
+    // 单层内不做去重 (重叠阈值 1.0 永远不成立)，所有层的结果统一在 suppress() 中去重，
+    // 与 dlib 在整个金字塔上做一次贪心抑制的结果一致
+    auto scanner = base.get_scanner();
+    scanner.set_max_pyramid_levels(1);
+    const dlib::test_box_overlap no_suppression(1.0, 1.0);
+    std::vector<dlib::frontal_face_detector> parts;
+    for (unsigned long i = 0; i < base.num_detectors(); ++i) {
+        parts.emplace_back(scanner, no_suppression, base.get_w(i));
+    }
+    // 检测器扫描时会修改内部状态，每个线程一份
+    level_detectors_.assign(options_.threads, dlib::frontal_face_detector(parts));
+    overlap_tester_ = base.get_overlap_tester();
+
+    min_level_width_ = scanner.get_detection_window_width();
+    min_level_height_ = scanner.get_detection_window_height();
+
+    partial_.resize(options_.threads);
+    for (size_t worker = 1; worker < options_.threads; ++worker) {
+        helpers_.emplace_back(&PyramidDetector::helperLoop, this, worker);
+    }
+}
+
+PyramidDetector::~PyramidDetector() {
+    {
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        stopping_ = true;
+    }
+    work_ready_.notify_all();
+    for (auto& helper : helpers_) helper.join();
+}
+
+void PyramidDetector::helperLoop(size_t worker) {
+    size_t seen = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(pool_mutex_);
+            work_ready_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_) return;
+            seen = generation_;
+            // 任务比线程少时只用前 active_workers_ 个
+            if (worker >= active_workers_) continue;
+        }
+        scanJobs(worker);
+        std::lock_guard<std::mutex> lock(pool_mutex_);
+        if (--busy_helpers_ == 0) work_done_.notify_one();
+    }
+}
+
+void PyramidDetector::scanJobs(size_t worker) {
+    for (size_t i = next_job_++; i < jobs_.size(); i = next_job_++) {
+        runJob(worker, jobs_[i], input_size_, partial_[worker]);
+    }
+}
+
+void PyramidDetector::buildPyramid(const cv::Mat& bgr) {
+    PM_SCOPED(构建检测金字塔);
+
+    // 先缩放再转灰度：缩放的数据量是三通道，但 scale<1 时转灰度的像素更少，总体更省
+    if (options_.scale < 1.0) {
+        cv::Mat scaled;
+        cv::resize(bgr, scaled, cv::Size(), options_.scale, options_.scale, cv::INTER_AREA);
+        cv::cvtColor(scaled, gray_, cv::COLOR_BGR2GRAY);
+    } else {
+        cv::cvtColor(bgr, gray_, cv::COLOR_BGR2GRAY);
+    }
+
+    // 与 dlib::pyramid_down<6> 相同的 5/6 缩放步长
+    // 比检测窗口还小的层不再生成；各层缓冲区跨帧复用
+    level_count_ = 0;
+    cv::Size size = gray_.size();
+    while (static_cast<unsigned long>(size.width) >= min_level_width_ &&
+           static_cast<unsigned long>(size.height) >= min_level_height_) {
+        if (level_count_ == levels_.size()) levels_.emplace_back();
+        if (level_count_ == 0) {
+            levels_[0] = gray_;
+        } else {
+            cv::resize(levels_[level_count_ - 1], levels_[level_count_], size, 0, 0, cv::INTER_LINEAR);
+        }
+        ++level_count_;
+        size = cv::Size(size.width * 5 / 6, size.height * 5 / 6);
+    }
+}
+
+void PyramidDetector::planJobs() {
+    jobs_.clear();
+    const int unbounded_low = std::numeric_limits<int>::min();
+    const int unbounded_high = std::numeric_limits<int>::max();
+
+    double total_area = 0.0;
+    for (size_t level = 0; level < level_count_; ++level) {
+        total_area += levels_[level].total();
+    }
+    // 每个线程大约分到的面积；单线程时每层一个任务，不切条带
+    const double target_area = total_area / options_.threads;
+    const int window_height = static_cast<int>(min_level_height_);
+
+    for (size_t level = 0; level < level_count_; ++level) {
+        const cv::Mat& image = levels_[level];
+        int strips = options_.threads > 1 ? static_cast<int>(std::ceil(image.total() / target_area)) : 1;
+        // 条带太窄时重叠部分占比过大，不值得再切
+        strips = std::max(1, std::min(strips, image.rows / (2 * window_height)));
+
+        const int own_height = (image.rows / strips + kCellSize - 1) / kCellSize * kCellSize;
+        for (int s = 0; s < strips; ++s) {
+            ScanJob job;
+            job.level = level;
+            job.own_begin = (s == 0) ? unbounded_low : s * own_height;
+            job.own_end = (s == strips - 1) ? unbounded_high : (s + 1) * own_height;
+            job.row_begin = (s == 0) ? 0 : (job.own_begin - window_height - kStripMargin) / kCellSize * kCellSize;
+            job.row_end = (s == strips - 1) ? image.rows
+                                            : std::min(image.rows, job.own_end + window_height + kStripMargin);
+            job.row_begin = std::max(0, job.row_begin);
+            jobs_.push_back(job);
+        }
+    }
+
+    // 大任务先分配，缩短最慢线程的完成时间
+    std::stable_sort(jobs_.begin(), jobs_.end(), [this](const ScanJob& a, const ScanJob& b) {
+        return static_cast<long>(a.row_end - a.row_begin) * levels_[a.level].cols >
+               static_cast<long>(b.row_end - b.row_begin) * levels_[b.level].cols;
+    });
+}
+
+void PyramidDetector::runJob(size_t worker, const ScanJob& job, const cv::Size& input_size, Detections& out) {
+    const cv::Mat& image = levels_[job.level];
+    const cv::Mat strip = image.rowRange(job.row_begin, job.row_end);
+    Detections detections;
+    level_detectors_[worker](dlib::cv_image<unsigned char>(strip), detections, options_.adjust_threshold);
+
+    const double sx = static_cast<double>(input_size.width) / image.cols;
+    const double sy = static_cast<double>(input_size.height) / image.rows;
+    for (auto& det : detections) {
+        const dlib::rectangle r = dlib::translate_rect(det.rect, 0, job.row_begin);
+        if (r.top() < job.own_begin || r.top() >= job.own_end) continue;  // 由相邻条带负责
+        det.rect = dlib::rectangle(std::lround(r.left() * sx), std::lround(r.top() * sy),
+                                   std::lround((r.right() + 1) * sx) - 1, std::lround((r.bottom() + 1) * sy) - 1);
+        out.push_back(det);
+    }
+}
+
+std::vector<dlib::rectangle> PyramidDetector::suppress(Detections& detections) const {
+    // 得分相同时按位置排序，保证结果与任务的执行顺序无关
+    std::sort(detections.begin(), detections.end(), [](const dlib::rect_detection& a, const dlib::rect_detection& b) {
+        if (a.detection_confidence != b.detection_confidence) return a.detection_confidence > b.detection_confidence;
+        if (a.rect.top() != b.rect.top()) return a.rect.top() < b.rect.top();
+        if (a.rect.left() != b.rect.left()) return a.rect.left() < b.rect.left();
+        return a.rect.area() < b.rect.area();
+    });
+
+    std::vector<dlib::rectangle> faces;
+    for (const auto& det : detections) {
+        bool overlapped = false;
+        for (const auto& kept : faces) {
+            if (overlap_tester_(det.rect, kept)) {
+                overlapped = true;
+                break;
+            }
+        }
+        if (!overlapped) faces.push_back(det.rect);
+    }
+    return faces;
+}
+
+std::vector<dlib::rectangle> PyramidDetector::detect(const cv::Mat& bgr) {
+    buildPyramid(bgr);
+
+    planJobs();
+
+    Detections detections;
+    {
+        PM_SCOPED(HOG金字塔扫描);
+        const size_t workers = std::min(options_.threads, jobs_.size());
+        if (workers <= 1) {
+            for (const auto& job : jobs_) {
+                runJob(0, job, bgr.size(), detections);
+            }
+        } else {
+            // 唤醒常驻线程，各线程从共享计数器领取任务，当前线程也参与扫描
+            for (size_t worker = 0; worker < workers; ++worker) partial_[worker].clear();
+            {
+                std::lock_guard<std::mutex> lock(pool_mutex_);
+                next_job_ = 0;
+                input_size_ = bgr.size();
+                active_workers_ = workers;
+                busy_helpers_ = workers - 1;
+                ++generation_;
+            }
+            work_ready_.notify_all();
+            scanJobs(0);
+            {
+                std::unique_lock<std::mutex> lock(pool_mutex_);
+                work_done_.wait(lock, [this] { return busy_helpers_ == 0; });
+            }
+            for (size_t worker = 0; worker < workers; ++worker) {
+                detections.insert(detections.end(), partial_[worker].begin(), partial_[worker].end());
+            }
+        }
+    }
+    return suppress(detections);
+}
@@ -0,0 +1,124 @@
+#include "StrangerClusters.h"
+#include "FaceGallery.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+// 聚类中心按滑动平均更新，权重封顶后中心能跟上光照、发型等缓慢变化
+constexpr uint32_t kMaxCentroidWeight = 32;
+} // namespace
+
+StrangerOptions StrangerOptions::fromConfig(const ConfigParser& config) {
+    StrangerOptions options;
+    options.enabled = config.get<bool>("strangers.enabled", options.enabled);
+    options.threshold = config.get<double>("strangers.threshold", options.threshold);
+    options.max_clusters = static_cast<size_t>(std::max(1, config.get<int>("strangers.max_clusters", 1000)));
+    options.max_age_s = config.get<double>("strangers.max_age_s", options.max_age_s);
+    options.min_sightings = std::max(1, config.get<int>("strangers.min_sightings", options.min_sightings));
+    return options;
+}
+
+StrangerClusters::StrangerClusters(const StrangerOptions& options) : options_(options) {
+    options_.max_clusters = std::max<size_t>(1, options_.max_clusters);
+    clusters_.reserve(options_.max_clusters);
+}
+
+std::string StrangerClusters::assign(const dlib::matrix<float,0,1>& descriptor, Clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (dim_ == 0) {
+        dim_ = descriptor.size();
+        centroids_.reserve(options_.max_clusters * static_cast<size_t>(dim_));
+    } else if (descriptor.size() != dim_) {
+        throw std::invalid_argument("Stranger descriptor has " + std::to_string(descriptor.size()) +
+                                    " dimensions, expected " + std::to_string(dim_));
+    }
+    const size_t n = static_cast<size_t>(dim_);
+    const float* values = &descriptor(0);
+
+    // 最近的聚类中心（平方距离比较，省去开方）
+    size_t best = clusters_.size();
+    float best_sq = static_cast<float>(options_.threshold * options_.threshold);
+    for (size_t c = 0; c < clusters_.size(); ++c) {
+        const float* centroid = centroids_.data() + c * n;
+        float sq = 0.f;
+        for (size_t k = 0; k < n && sq <= best_sq; ++k) {
+            const float diff = values[k] - centroid[k];
+            sq += diff * diff;
+        }
+        if (sq <= best_sq) {
+            best_sq = sq;
+            best = c;
+        }
+    }
+
+    if (best == clusters_.size()) {
+        evict(now);
+        best = clusters_.size();
+        centroids_.insert(centroids_.end(), values, values + n);
+        Cluster cluster;
+        cluster.id = next_id_++;
+        clusters_.push_back(cluster);
+    } else {
+        const float weight = 1.f / static_cast<float>(std::min(clusters_[best].sightings + 1, kMaxCentroidWeight));
+        float* centroid = centroids_.data() + best * n;
+        for (size_t k = 0; k < n; ++k) centroid[k] += weight * (values[k] - centroid[k]);
+    }
+
+    Cluster& cluster = clusters_[best];
+    cluster.last_seen = now;
+    if (++cluster.sightings == static_cast<uint32_t>(options_.min_sightings)) ++visitors_;
+    return std::string(labelPrefix()) + "-" + std::to_string(cluster.id);
+}
+
+void StrangerClusters::labelUnmatched(const std::vector<dlib::matrix<float,0,1>>& descriptors,
+                                      std::vector<std::string>& names, uint64_t watchlists) {
+    if (watchlists != FaceGallery::kAllWatchlists) return;
+    for (size_t i = 0; i < names.size() && i < descriptors.size(); ++i) {
+        if (names[i] == labelPrefix()) names[i] = assign(descriptors[i]);
+    }
+}
+
+bool StrangerClusters::isStrangerLabel(const std::string& name) {
+    const std::string prefix = labelPrefix();
+    if (name == prefix) return true;
+    if (name.size() <= prefix.size() + 1 || name.compare(0, prefix.size(), prefix) != 0 || name[prefix.size()] != '-') {
+        return false;
+    }
+    return std::all_of(name.begin() + prefix.size() + 1, name.end(),
+                       [](char c) { return c >= '0' && c <= '9'; });
+}
+
+void StrangerClusters::evict(Clock::time_point now) {
+    const auto max_age = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options_.max_age_s));
+    for (size_t c = clusters_.size(); c-- > 0;) {
+        if (now - clusters_[c].last_seen > max_age) erase(c);
+    }
+    if (clusters_.size() < options_.max_clusters) return;
+    const auto oldest = std::min_element(clusters_.begin(), clusters_.end(), [](const Cluster& a, const Cluster& b) {
+        return a.last_seen < b.last_seen;
+    });
+    erase(static_cast<size_t>(oldest - clusters_.begin()));
+}
+
+void StrangerClusters::erase(size_t slot) {
+    const size_t n = static_cast<size_t>(dim_);
+    const size_t last = clusters_.size() - 1;
+    if (slot != last) {
+        clusters_[slot] = clusters_[last];
+        std::copy(centroids_.begin() + last * n, centroids_.begin() + (last + 1) * n, centroids_.begin() + slot * n);
+    }
+    clusters_.pop_back();
+    centroids_.resize(last * n);
+}
+
+size_t StrangerClusters::uniqueVisitors() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return visitors_;
+}
+
+size_t StrangerClusters::activeClusters() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return clusters_.size();
+}
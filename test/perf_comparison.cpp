@@ -0,0 +1,65 @@
+#include "perf_comparison.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+size_t PerfCheck::failures() const {
+    return static_cast<size_t>(
+        std::count_if(rows.begin(), rows.end(), [](const PerfComparison& row) { return row.failed(); }));
+}
+
+PerfCheck comparePerformance(const nlohmann::json& baseline, const std::vector<PerfStage>& stages, double fps) {
+    const nlohmann::json tolerance = baseline.value("tolerance", nlohmann::json::object());
+    const double p50_tol = tolerance.value("p50", 0.15);
+    const double p99_tol = tolerance.value("p99", 0.30);
+    const double fps_tol = tolerance.value("throughput", 0.10);
+
+    PerfCheck check;
+    const nlohmann::json baseline_stages = baseline.value("stages", nlohmann::json::object());
+    for (const auto& [stage, expected] : baseline_stages.items()) {
+        auto it = std::find_if(stages.begin(), stages.end(), [&](const PerfStage& s) { return s.name == stage; });
+        if (it == stages.end()) {
+            // 没跑到的阶段无从比较，可能是被改名或被意外跳过，按失败处理
+            check.missing_stages.push_back(stage);
+            continue;
+        }
+        const nlohmann::json stage_tol = expected.value("tolerance", nlohmann::json::object());
+        const double base_p50 = expected.value("p50_ms", 0.0);
+        const double base_p99 = expected.value("p99_ms", 0.0);
+        check.rows.push_back({stage, "p50_ms", base_p50, it->p50_ms,
+                              base_p50 * (1.0 + stage_tol.value("p50", p50_tol)), false});
+        check.rows.push_back({stage, "p99_ms", base_p99, it->p99_ms,
+                              base_p99 * (1.0 + stage_tol.value("p99", p99_tol)), false});
+    }
+    const double base_fps = baseline.value("throughput_fps", 0.0);
+    if (base_fps > 0) {
+        check.rows.push_back({"(whole frame)", "fps", base_fps, fps, base_fps * (1.0 - fps_tol), true});
+    }
+    return check;
+}
+
+void printPerfCheck(std::ostream& out, const PerfCheck& check) {
+    const auto flags = out.flags();
+    const auto precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+    out << "  " << std::setw(24) << std::left << "Stage" << std::setw(12) << "Metric"
+        << std::setw(12) << "Baseline" << std::setw(12) << "Current"
+        << std::setw(12) << "Change" << std::setw(12) << "Limit" << "Status\n";
+    for (const auto& row : check.rows) {
+        std::ostringstream change;
+        change << std::fixed << std::setprecision(1) << std::showpos << row.changePercent() << "%";
+        out << "  " << std::setw(24) << std::left << row.stage << std::setw(12) << row.metric
+            << std::setw(12) << row.baseline << std::setw(12) << row.current
+            << std::setw(12) << change.str() << std::setw(12) << row.limit
+            << (row.failed() ? "REGRESSED" : "ok") << "\n";
+    }
+    for (const auto& stage : check.missing_stages) {
+        out << "FAILED: baseline stage '" << stage << "' was not exercised in this run.\n";
+    }
+    if (check.failures() > 0) {
+        out << check.failures() << " metric(s) regressed beyond tolerance.\n";
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
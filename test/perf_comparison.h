@@ -0,0 +1,52 @@
+#ifndef PERF_COMPARISON_H
+#define PERF_COMPARISON_H
+
+// 性能回归测试的比较部分：把一次运行的各阶段 p50/p99 和吞吐量与基线 JSON 比较。
+// 与录像回放分开，不依赖模型和 OpenCV，test_perf_comparison 用构造的基线和结果直接测试它
+
+#include "nlohmann/json.hpp"
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+// 本次运行测得的一个阶段
+struct PerfStage {
+    std::string name;
+    double p50_ms = 0.0;
+    double p99_ms = 0.0;
+};
+
+// 对比表中的一行
+struct PerfComparison {
+    std::string stage;
+    std::string metric;
+    double baseline = 0.0;
+    double current = 0.0;
+    double limit = 0.0;
+    bool higher_is_better = false;
+
+    double changePercent() const {
+        return baseline > 0 ? (current - baseline) / baseline * 100.0 : 0.0;
+    }
+    bool failed() const {
+        return higher_is_better ? current < limit : current > limit;
+    }
+};
+
+struct PerfCheck {
+    std::vector<PerfComparison> rows;
+    std::vector<std::string> missing_stages;  // 基线中有、本次没有跑到的阶段
+
+    size_t failures() const;
+    // 没有超出容差的指标，也没有缺失的阶段
+    bool passed() const { return failures() == 0 && missing_stages.empty(); }
+};
+
+// 容差为相对比例：基线顶层的 tolerance.{p50,p99,throughput}，可在 stages.<阶段>.tolerance 中覆盖
+PerfCheck comparePerformance(const nlohmann::json& baseline, const std::vector<PerfStage>& stages, double fps);
+
+// 打印对比表（超出容差的行标为 REGRESSED），以及缺失阶段和失败数
+void printPerfCheck(std::ostream& out, const PerfCheck& check);
+
+#endif // PERF_COMPARISON_H
@@ -42,5 +42,66 @@ int main() {
     }
      std::cout << "--- Verification finished ---" << std::endl;
 
+    // 3. 类型化配置：load() 时解析一次，config.json 中的值都是正确的 JSON 类型
+    std::cout << "--- Typed settings ---" << std::endl;
+    bool ok = true;
+    auto expect = [&ok](bool condition, const std::string& message) {
+        if (!condition) std::cerr << "FAILED: " << message << std::endl;
+        ok = ok && condition;
+    };
+    expect(config.errors().empty(), "config.json must validate without errors");
+    expect(config.settings().use_camera == config.get<bool>("use_camera", !config.settings().use_camera),
+           "settings must match get<bool>(\"use_camera\")");
+    expect(config.settings().frame_sample_interval >= 1, "frame_sample_interval must be positive");
+
+    // 4. 类型不符和未知的键在 load 时逐条报错，而不是读取时悄悄退回默认值
+    std::cout << "--- Validation errors ---" << std::endl;
+    {
+        ConfigParser bad;
+        const bool loaded = bad.loadFromString(R"({
+            "use_camera": "true",
+            "frame_sample_interval": "2",
+            "gallery": {"storge": "int8", "rerank": 1.5},
+            "sources": [{"name": "a", "device": "0", "watchlists": ["vip", 3]}]
+        })");
+        for (const auto& error : bad.errors()) std::cout << "  " << error << std::endl;
+        auto reported = [&bad](const std::string& text) {
+            for (const auto& error : bad.errors()) {
+                if (error.find(text) != std::string::npos) return true;
+            }
+            return false;
+        };
+        expect(!loaded, "invalid config must not load");
+        expect(bad.errors().size() == 6, "every problem must be reported");
+        expect(reported("use_camera: expected bool, got string \"true\" (write true without quotes)"),
+               "string boolean must be reported");
+        expect(reported("frame_sample_interval: expected integer"), "string number must be reported");
+        expect(reported("gallery.storge: unknown key (did you mean 'storage'?)"), "typo must be reported");
+        expect(reported("gallery.rerank: expected integer, got number 1.5"), "fraction must be reported");
+        expect(reported("sources[0].device: expected integer"), "source fields must be validated");
+        expect(reported("sources[0].watchlists: expected array of strings"), "watchlists must be strings");
+    }
+    {
+        ConfigParser good;
+        expect(good.loadFromString(R"({"gallery": {"storage": "int8", "watchlists": {"vip": ["a"]}}, "debug_mode": true})"),
+               "valid config must load");
+        expect(good.get<std::string>("gallery.storage", "float") == "int8", "nested value lookup");
+        expect(good.get<json>("gallery.watchlists", json()).contains("vip"), "free-form objects are kept as JSON");
+        expect(good.get<int>("gallery.rerank", 8) == 8, "missing key falls back to the default");
+        expect(good.get<bool>("gallery.storage", true), "wrong requested type falls back to the default");
+        expect(good.settings().debug_mode && good.settings().use_camera, "settings use defaults for missing keys");
+    }
+    {
+        // 分片列表：每项必须是对象，timeout_ms 按分片设置
+        ConfigParser shards;
+        expect(shards.loadFromString(R"({"gallery": {"shards": [{"host": "a", "port": 1, "timeout_ms": 80}]}})"),
+               "per-shard timeout must be accepted");
+        ConfigParser bad_shards;
+        expect(!bad_shards.loadFromString(R"({"gallery": {"shards": ["a:1", {"port": 2, "timeout_ms": "80"}]}})"),
+               "non-object shard entries must not load");
+        for (const auto& error : bad_shards.errors()) std::cout << "  " << error << std::endl;
+    }
+
+    if (!ok) return -1;
     return 0;
 }
@@ -0,0 +1,96 @@
+#include "EnrollmentService.h"
+#include "HttpStreamServer.h"
+#include "test_utils.h"
+
+#include <iostream>
+#include <string>
+
+using test_utils::expect;
+
+namespace {
+// 解析一个请求，返回错误回复的状态码；合法请求返回 0
+int parseStatus(const std::string& method, const std::string& target, const std::string& content_type,
+                const std::string& body, EnrollmentService::Request* parsed = nullptr) {
+    EnrollmentOptions options;
+    EnrollmentService::Request request;
+    EnrollmentService::Reply failure;
+    const bool ok = EnrollmentService::parseRequest(options, method, target, content_type, body, request, failure);
+    if (parsed) *parsed = request;
+    return ok ? 0 : failure.status;
+}
+} // namespace
+
+int main() {
+    bool ok = true;
+    const std::string json_type = "application/json";
+
+    // 1. 合法请求
+    std::cout << "--- Valid requests ---" << std::endl;
+    {
+        EnrollmentService::Request request;
+        ok &= expect(parseStatus("POST", "/enroll", json_type, R"({"name": "张三", "descriptor": [0.1, -2, 3e-1]})",
+                                 &request) == 0 &&
+                     request.kind == EnrollmentService::Request::Kind::Descriptor && request.name == "张三" &&
+                     request.descriptor.size() == 3 && !request.replace, "JSON descriptor request");
+        ok &= expect(parseStatus("PUT", "/enroll?name=%E5%BC%A0+%E4%B8%89", "image/jpeg", "jpegbytes", &request) == 0 &&
+                     request.kind == EnrollmentService::Request::Kind::Image && request.name == "张 三" &&
+                     request.replace, "URL-encoded name on an image request");
+        ok &= expect(parseStatus("DELETE", "/enroll?name=a", "", "", &request) == 0 &&
+                     request.kind == EnrollmentService::Request::Kind::Remove, "delete request");
+        ok &= expect(parseStatus("GET", "/enroll?job=12", "", "", &request) == 0 && request.job == 12,
+                     "status request");
+    }
+
+    // 2. 字段类型不对的 JSON 只得到 400，不能抛出异常（处理函数在推流监听线程上，异常会结束进程）
+    std::cout << "--- Malformed field types ---" << std::endl;
+    const char* const malformed[] = {
+        R"({"name": 5, "descriptor": [0.1]})",
+        R"({"name": null, "descriptor": [0.1]})",
+        R"({"name": ["a"], "descriptor": [0.1]})",
+        R"({"name": "a", "descriptor": "0.1"})",
+        R"({"name": "a", "descriptor": {"x": 1}})",
+        R"({"name": "a", "descriptor": [0.1, "x"]})",
+        R"({"name": "a", "descriptor": [[0.1]]})",
+        R"({"name": "a"})",
+        R"([1, 2, 3])",
+        R"("text")",
+        R"({"name": "a", "descriptor": [0.1)",
+    };
+    for (const char* body : malformed) {
+        int status = 0;
+        try {
+            status = parseStatus("POST", "/enroll", json_type, body);
+        } catch (const std::exception& e) {
+            ok &= expect(false, std::string("parseRequest threw for ") + body + ": " + e.what());
+            continue;
+        }
+        ok &= expect(status == 400, std::string("malformed body must be rejected with 400: ") + body);
+    }
+
+    // 3. 其他错误
+    std::cout << "--- Other errors ---" << std::endl;
+    ok &= expect(parseStatus("POST", "/other?name=a", "image/jpeg", "x") == 404, "wrong path");
+    ok &= expect(parseStatus("PATCH", "/enroll?name=a", "", "") == 405, "unsupported method");
+    ok &= expect(parseStatus("POST", "/enroll", "image/jpeg", "x") == 400, "missing name");
+    ok &= expect(parseStatus("POST", "/enroll?name=a", "image/jpeg", "") == 400, "missing image");
+    ok &= expect(parseStatus("GET", "/enroll?job=-1", "", "") == 400, "negative job");
+    ok &= expect(parseStatus("GET", "/enroll?job=99999999999999999999999", "", "") == 400, "job out of range");
+    ok &= expect(parseStatus("POST", "/enroll?name=a", "image/jpeg", std::string((8u << 20) + 1, 'x')) == 413,
+                 "body over max_body_bytes");
+
+    // 4. 上传请求的 Content-Length：只接受十进制数字，负数、符号、杂字符和溢出都拒绝
+    std::cout << "--- Content-Length ---" << std::endl;
+    {
+        size_t length = 1;
+        ok &= expect(HttpStreamServer::parseContentLength("", length) && length == 0, "missing length is 0");
+        ok &= expect(HttpStreamServer::parseContentLength("1024", length) && length == 1024, "plain length");
+        for (const char* bad : {"-1", "+5", "12abc", "0x10", " 7", "99999999999999999999999"}) {
+            ok &= expect(!HttpStreamServer::parseContentLength(bad, length),
+                         std::string("Content-Length '") + bad + "' must be rejected");
+        }
+    }
+
+    if (!ok) return -1;
+    std::cout << "Enrollment request test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,118 @@
+#include "FaceChipBatch.h"
+#include <dlib/opencv.h>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+namespace {
+// 平滑的合成图像：各通道不同的渐变加正弦纹理
+cv::Mat syntheticFrame(int rows, int cols) {
+    cv::Mat frame(rows, cols, CV_8UC3);
+    for (int r = 0; r < frame.rows; ++r) {
+        for (int c = 0; c < frame.cols; ++c) {
+            frame.at<cv::Vec3b>(r, c) = cv::Vec3b(
+                static_cast<uchar>((c * 255) / frame.cols),
+                static_cast<uchar>((r * 255) / frame.rows),
+                static_cast<uchar>(128 + 100 * std::sin(r * 0.05) * std::cos(c * 0.03)));
+        }
+    }
+    return frame;
+}
+
+// 两个芯片逐通道差值的最大值和平均值
+void channelDifference(const dlib::matrix<dlib::rgb_pixel>& expected, const dlib::matrix<dlib::rgb_pixel>& actual,
+                       int& max_diff, double& mean_diff) {
+    max_diff = 0;
+    long total = 0;
+    for (long r = 0; r < expected.nr(); ++r) {
+        for (long c = 0; c < expected.nc(); ++c) {
+            for (const int d : {std::abs(expected(r, c).red - actual(r, c).red),
+                                std::abs(expected(r, c).green - actual(r, c).green),
+                                std::abs(expected(r, c).blue - actual(r, c).blue)}) {
+                max_diff = std::max(max_diff, d);
+                total += d;
+            }
+        }
+    }
+    mean_diff = static_cast<double>(total) / (3.0 * expected.size());
+}
+} // namespace
+
+// 融合的芯片提取必须与 dlib::extract_image_chip 的结果在舍入误差内一致
+int main() {
+    cv::Mat frame = syntheticFrame(480, 640);
+    dlib::cv_image<dlib::bgr_pixel> dlib_img(frame);
+
+    FaceChipBatch::Means means;
+    means.red = 122.782f;
+    means.green = 117.001f;
+    means.blue = 104.298f;
+    FaceChipBatch batch(means);
+
+    // 正脸、旋转、以及部分超出图像边界的芯片
+    const std::vector<dlib::chip_details> cases = {
+        dlib::chip_details(dlib::drectangle(200, 100, 400, 300), dlib::chip_dims(150, 150)),
+        dlib::chip_details(dlib::drectangle(250, 150, 430, 330), dlib::chip_dims(150, 150), 0.4),
+        dlib::chip_details(dlib::drectangle(540, 380, 700, 540), dlib::chip_dims(150, 150), -0.2),
+    };
+    batch.reset(cases.size());
+    for (size_t i = 0; i < cases.size(); ++i) {
+        batch.write(i, frame, cases[i]);
+    }
+
+    for (size_t i = 0; i < cases.size(); ++i) {
+        dlib::matrix<dlib::rgb_pixel> expected;
+        dlib::extract_image_chip(dlib_img, cases[i], expected);
+        const dlib::matrix<dlib::rgb_pixel> actual = batch.chip(i);
+
+        int max_diff = 0;
+        double mean_diff = 0.0;
+        channelDifference(expected, actual, max_diff, mean_diff);
+        std::cout << "Case " << i << ": max channel difference " << max_diff << std::endl;
+        if (max_diff > 2) {
+            std::cerr << "Fused chip differs from extract_image_chip" << std::endl;
+            return -1;
+        }
+    }
+
+    // 近距离的大脸：源区域是芯片的 2 倍以上，先按 2 的幂做 INTER_AREA 缩小再采样。
+    // dlib 用 pyramid_down<2> 逐级缩小，滤波器不同，只要求在小的容差内一致
+    {
+        cv::Mat large_frame = syntheticFrame(1080, 1920);
+        dlib::cv_image<dlib::bgr_pixel> large_img(large_frame);
+        const std::vector<dlib::chip_details> large_cases = {
+            dlib::chip_details(dlib::drectangle(600, 200, 1000, 600), dlib::chip_dims(150, 150)),        // 缩小 2 倍
+            dlib::chip_details(dlib::drectangle(500, 150, 1250, 900), dlib::chip_dims(150, 150)),        // 缩小 4 倍
+            dlib::chip_details(dlib::drectangle(700, 250, 1300, 850), dlib::chip_dims(150, 150), 0.3),  // 旋转
+        };
+        FaceChipBatch large_batch(means);
+        large_batch.reset(large_cases.size());
+        for (size_t i = 0; i < large_cases.size(); ++i) {
+            large_batch.write(i, large_frame, large_cases[i]);
+        }
+        for (size_t i = 0; i < large_cases.size(); ++i) {
+            dlib::matrix<dlib::rgb_pixel> expected;
+            dlib::extract_image_chip(large_img, large_cases[i], expected);
+            int max_diff = 0;
+            double mean_diff = 0.0;
+            channelDifference(expected, large_batch.chip(i), max_diff, mean_diff);
+            std::cout << "Large case " << i << ": max channel difference " << max_diff << ", mean " << mean_diff
+                      << std::endl;
+            if (max_diff > 8 || mean_diff > 1.5) {
+                std::cerr << "Pre-shrunk chip differs from extract_image_chip" << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    // 丢弃中间一个样本后，其余样本保持不变
+    const auto last = batch.chip(2);
+    batch.keep({0, 2});
+    if (batch.size() != 2 || !(batch.chip(1) == last)) {
+        std::cerr << "keep() did not compact the batch correctly" << std::endl;
+        return -1;
+    }
+
+    std::cout << "Face chip test passed." << std::endl;
+    return 0;
+}
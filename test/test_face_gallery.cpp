@@ -0,0 +1,310 @@
+#include "FaceGallery.h"
+#include "test_utils.h"
+
+#include <cmath>
+#include <filesystem>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+using test_utils::expect;
+using test_utils::randomDescriptor;
+
+int main() {
+    const long dim = 128;
+    const size_t count = 2000;
+    std::mt19937 rng(42);
+    std::normal_distribution<float> noise(0.f, 0.02f);
+
+    std::vector<dlib::matrix<float,0,1>> library;
+    for (size_t i = 0; i < count; ++i) library.push_back(randomDescriptor(rng, dim));
+    std::vector<dlib::matrix<float,0,1>> queries;
+    for (size_t i = 0; i < count; i += 10) {
+        dlib::matrix<float,0,1> query = library[i];
+        for (long k = 0; k < dim; ++k) query(k) += noise(rng);
+        queries.push_back(query);
+    }
+
+    bool ok = true;
+    GalleryOptions float_options;
+    FaceGallery reference(float_options);
+    for (size_t i = 0; i < count; ++i) reference.add("person_" + std::to_string(i), library[i]);
+
+    // 1. float 存储与逐个计算 dlib::length 的结果一致
+    std::cout << "--- Float storage ---" << std::endl;
+    for (size_t q = 0; q < queries.size(); ++q) {
+        const auto hit = reference.nearest(queries[q]);
+        ok &= expect(hit.index == q * 10, "float nearest for query " + std::to_string(q));
+        ok &= expect(std::abs(hit.distance - dlib::length(library[q * 10] - queries[q])) < 1e-5,
+                     "float distance for query " + std::to_string(q));
+    }
+
+    // 2. 量化存储：精排时与 float 完全一致，不精排时最近邻相同、距离误差很小
+    for (const std::string storage : {"int8", "fp16"}) {
+        for (int rerank : {8, 0}) {
+            std::cout << "--- " << storage << ", rerank " << rerank << " ---" << std::endl;
+            GalleryOptions options;
+            options.storage = storage;
+            options.rerank = rerank;
+            FaceGallery gallery(options);
+            for (size_t i = 0; i < count; ++i) gallery.add("person_" + std::to_string(i), library[i]);
+
+            for (size_t q = 0; q < queries.size(); ++q) {
+                const auto expected = reference.nearest(queries[q]);
+                const auto hit = gallery.nearest(queries[q]);
+                const double tolerance = rerank > 0 ? 1e-6 : 0.02;
+                ok &= expect(hit.index == expected.index, storage + " nearest for query " + std::to_string(q));
+                ok &= expect(std::abs(hit.distance - expected.distance) < tolerance,
+                             storage + " distance for query " + std::to_string(q));
+            }
+            if (rerank == 0) {
+                // 名称和身份索引的开销相同，只比较整体占用
+                const double limit = storage == "int8" ? 0.5 : 0.7;
+                ok &= expect(gallery.memoryBytes() < reference.memoryBytes() * limit,
+                             storage + " storage must be smaller than float");
+            }
+        }
+    }
+
+    // 3. 批量检索（矩阵乘法）与逐个检索一致
+    std::cout << "--- Batch search ---" << std::endl;
+    const auto batch_hits = reference.nearestBatch(queries);
+    ok &= expect(batch_hits.size() == queries.size(), "batch must return one hit per query");
+    for (size_t q = 0; q < queries.size() && q < batch_hits.size(); ++q) {
+        const auto hit = reference.nearest(queries[q]);
+        ok &= expect(batch_hits[q].index == hit.index && std::abs(batch_hits[q].distance - hit.distance) < 1e-6,
+                     "batch hit for query " + std::to_string(q));
+    }
+    {
+        // 同一个人的几张几乎相同的参考特征：展开式的相消误差与它们之间的距离差同一量级，
+        // 候选精确重算后仍要选出与 nearest 相同的条目。每人多张参考时默认开启身份剪枝，
+        // nearest 走剪枝路径，nearestBatch 仍走矩阵乘法，两者必须一致
+        FaceGallery near_duplicates;
+        std::normal_distribution<float> tiny(0.f, 1e-4f);
+        std::vector<dlib::matrix<float,0,1>> close_queries;
+        for (size_t i = 0; i < 20; ++i) {
+            const auto base = library[i];
+            for (int copy = 0; copy < 4; ++copy) {
+                dlib::matrix<float,0,1> desc = base;
+                for (long k = 0; k < dim; ++k) desc(k) += tiny(rng);
+                near_duplicates.add("person_" + std::to_string(i), desc);
+            }
+            dlib::matrix<float,0,1> query = base;
+            for (long k = 0; k < dim; ++k) query(k) += tiny(rng);
+            close_queries.push_back(query);
+        }
+        const auto close_hits = near_duplicates.nearestBatch(close_queries);
+        for (size_t q = 0; q < close_queries.size(); ++q) {
+            const auto hit = near_duplicates.nearest(close_queries[q]);
+            ok &= expect(close_hits[q].index == hit.index && close_hits[q].distance == hit.distance,
+                         "batch hit among near-duplicate references for query " + std::to_string(q));
+        }
+    }
+
+    // 4. PCA 粗筛：在各方向方差不同的特征上（与真实特征类似）召回接近 1；索引可保存后复用
+    std::cout << "--- PCA prefilter ---" << std::endl;
+    {
+        std::vector<dlib::matrix<float,0,1>> skewed = library;
+        for (auto& desc : skewed) {
+            for (long k = 0; k < dim; ++k) desc(k) *= std::exp(-k / 16.0f);
+        }
+        GalleryOptions pca_options;
+        pca_options.pca_dims = 32;
+        pca_options.pca_candidates = 100;
+        FaceGallery exact, pca(pca_options);
+        for (size_t i = 0; i < count; ++i) {
+            exact.add("person_" + std::to_string(i), skewed[i]);
+            pca.add("person_" + std::to_string(i), skewed[i]);
+        }
+        pca.buildIndex();
+        ok &= expect(pca.hasIndex(), "PCA index must be built");
+
+        size_t found = 0;
+        std::vector<dlib::matrix<float,0,1>> pca_queries;
+        for (size_t i = 0; i < count; i += 10) {
+            dlib::matrix<float,0,1> query = skewed[i];
+            for (long k = 0; k < dim; ++k) query(k) += noise(rng) * std::exp(-k / 16.0f);
+            pca_queries.push_back(query);
+            found += pca.nearest(query).index == exact.nearest(query).index;
+        }
+        const double recall = static_cast<double>(found) / pca_queries.size();
+        std::cout << "PCA recall: " << recall << std::endl;
+        ok &= expect(recall >= 0.95, "PCA prefilter recall too low");
+
+        const std::string index_path = (std::filesystem::temp_directory_path() / "test_face_gallery.pca").string();
+        ok &= expect(pca.saveIndex(index_path), "PCA index must be saved");
+        FaceGallery reloaded(pca_options);
+        for (size_t i = 0; i < count; ++i) reloaded.add("person_" + std::to_string(i), skewed[i]);
+        ok &= expect(reloaded.loadIndex(index_path), "PCA index must load for the same gallery");
+        for (const auto& query : pca_queries) {
+            ok &= expect(reloaded.nearest(query).index == pca.nearest(query).index, "reloaded index must match");
+        }
+        FaceGallery changed(pca_options);
+        for (size_t i = 1; i < count; ++i) changed.add("person_" + std::to_string(i), skewed[i]);
+        ok &= expect(!changed.loadIndex(index_path), "PCA index must be rejected for a different gallery");
+        // 姓名、顺序和模长都不变，只是特征重新提取过（换了模型）
+        FaceGallery reextracted(pca_options);
+        for (size_t i = 0; i < count; ++i) {
+            dlib::matrix<float,0,1> desc = skewed[i];
+            if (i == count / 2) desc = randomDescriptor(rng, dim) * dlib::length(skewed[i]);
+            reextracted.add("person_" + std::to_string(i), desc);
+        }
+        ok &= expect(!reextracted.loadIndex(index_path), "PCA index must be rejected when descriptors change");
+        std::filesystem::remove(index_path);
+    }
+
+    // 5. 每人多张参考特征：按身份质心剪枝的结果与全量扫描完全相同
+    std::cout << "--- Multiple references per identity ---" << std::endl;
+    {
+        GalleryOptions pruned_options;
+        GalleryOptions flat_options;
+        flat_options.identity_prefilter = false;
+        FaceGallery pruned(pruned_options), flat(flat_options);
+        std::normal_distribution<float> spread(0.f, 0.03f);
+        std::vector<dlib::matrix<float,0,1>> probes;
+        for (size_t person = 0; person < 200; ++person) {
+            const auto center = library[person];
+            for (int k = 0; k < 5; ++k) {
+                dlib::matrix<float,0,1> reference_desc = center;
+                for (long d = 0; d < dim; ++d) reference_desc(d) += spread(rng);
+                pruned.add("person_" + std::to_string(person), reference_desc);
+                flat.add("person_" + std::to_string(person), reference_desc);
+            }
+            dlib::matrix<float,0,1> probe = center;
+            for (long d = 0; d < dim; ++d) probe(d) += spread(rng);
+            probes.push_back(probe);
+            probes.push_back(library[count - 1 - person]);  // 库外的人
+        }
+        pruned.buildIndex();
+        flat.buildIndex();
+        ok &= expect(pruned.size() == 1000 && pruned.identityCount() == 200 && pruned.referenceCount(0) == 5,
+                     "references must be grouped by name");
+        for (size_t q = 0; q < probes.size(); ++q) {
+            const auto expected = flat.nearest(probes[q]);
+            const auto hit = pruned.nearest(probes[q]);
+            ok &= expect(hit.index == expected.index && std::abs(hit.distance - expected.distance) < 1e-6,
+                         "pruned search must match full scan for probe " + std::to_string(q));
+        }
+
+        // 建好索引后继续加入的参考特征也能被检索到
+        pruned.add("late_person", library[count - 1]);
+        pruned.add("late_person", library[count - 2]);
+        ok &= expect(pruned.name(pruned.nearest(library[count - 2]).index) == "late_person",
+                     "references added after buildIndex must be searchable");
+    }
+
+    // 6. 同名再加入是新的参考特征、维数不一致时报错
+    std::cout << "--- Add and dimension checks ---" << std::endl;
+    reference.add("person_0", library[1]);
+    ok &= expect(reference.size() == count + 1 && reference.identityCount() == count &&
+                 reference.referenceCount(0) == 2, "re-adding a name must add a reference to the same identity");
+    ok &= expect(reference.nearest(library[1]).distance < 1e-5, "added reference must be searchable");
+    bool threw = false;
+    try {
+        reference.add("short", dlib::matrix<float,0,1>(dlib::zeros_matrix<float>(64, 1)));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    ok &= expect(threw, "dimension mismatch must throw");
+
+    // 7. 关注名单：只在所选名单的人中检索，结果等于只含这些人的人脸库上的检索
+    std::cout << "--- Watchlists ---" << std::endl;
+    for (const bool with_index : {false, true}) {
+        for (const std::string storage : {"float", "int8"}) {
+            GalleryOptions options;
+            options.storage = storage;
+            options.pca_dims = with_index ? 32 : 0;
+            options.pca_candidates = static_cast<int>(count);  // 粗筛保留全部候选，结果可以精确比较
+            FaceGallery tagged(options), subset(options);
+            for (size_t i = 0; i < count; ++i) {
+                tagged.add("person_" + std::to_string(i), library[i]);
+                if (i % 3 == 0) subset.add("person_" + std::to_string(i), library[i]);
+            }
+            for (size_t i = 0; i < count; i += 3) tagged.addToWatchlist("person_" + std::to_string(i), "vip");
+            tagged.watchlistBit("empty");
+            tagged.buildIndex();
+            subset.buildIndex();
+            const uint64_t vip = tagged.watchlistMask({"vip"});
+
+            const std::string label = storage + (with_index ? " with index" : "");
+            const auto batch = tagged.nearestBatch(queries, vip);
+            for (size_t q = 0; q < queries.size(); ++q) {
+                const auto expected = subset.nearest(queries[q]);
+                const auto hit = tagged.nearest(queries[q], vip);
+                ok &= expect(tagged.name(hit.index) == subset.name(expected.index) &&
+                             std::abs(hit.distance - expected.distance) < 1e-6,
+                             label + " watchlist search for query " + std::to_string(q));
+                ok &= expect(batch[q].index == hit.index, label + " watchlist batch for query " + std::to_string(q));
+                ok &= expect(tagged.nearest(queries[q]).index == q * 10, label + " unrestricted search");
+            }
+            ok &= expect(std::isinf(tagged.nearest(queries[0], tagged.watchlistMask({"empty"})).distance),
+                         label + " empty watchlist must match nobody");
+        }
+    }
+    {
+        FaceGallery gallery;
+        gallery.add("a", library[0]);
+        ok &= expect(!gallery.addToWatchlist("nobody", "vip"), "unknown person must not be tagged");
+        bool unknown_threw = false;
+        try {
+            gallery.watchlistMask({"missing"});
+        } catch (const std::runtime_error&) {
+            unknown_threw = true;
+        }
+        ok &= expect(unknown_threw, "unknown watchlist must throw");
+        ok &= expect(gallery.watchlistMask({}) == FaceGallery::kAllWatchlists, "no watchlist selects everyone");
+    }
+
+    // 8. 在线删除：墓碑不再被检索到，压缩前后结果相同，结果等于不含被删者的人脸库
+    std::cout << "--- Remove and compact ---" << std::endl;
+    for (const bool with_index : {false, true}) {
+        GalleryOptions options;
+        options.pca_dims = with_index ? 32 : 0;
+        options.pca_candidates = static_cast<int>(count);
+        FaceGallery live(options), survivors(options);
+        for (size_t i = 0; i < count; ++i) {
+            live.add("person_" + std::to_string(i), library[i]);
+            if (i % 4 != 0) survivors.add("person_" + std::to_string(i), library[i]);
+        }
+        live.add("person_4", library[count - 1]);  // 两张参考，删除时一起成为墓碑
+        live.buildIndex();
+        survivors.buildIndex();
+
+        size_t removed = 0;
+        for (size_t i = 0; i < count; i += 4) removed += live.remove("person_" + std::to_string(i));
+        const std::string label = with_index ? "with index" : "flat";
+        ok &= expect(removed == count / 4 + 1 && live.tombstoneCount() == removed, label + " tombstone count");
+        ok &= expect(live.remove("person_0") == 0 && live.remove("nobody") == 0, label + " removing twice is a no-op");
+
+        for (const bool compacted : {false, true}) {
+            if (compacted) {
+                live.compact();
+                ok &= expect(live.tombstoneCount() == 0 && live.size() == count - count / 4 &&
+                             live.identityCount() == count - count / 4, label + " compact must drop tombstones");
+            }
+            const std::string stage = label + (compacted ? " after compact" : " before compact");
+            const auto batch = live.nearestBatch(queries);
+            for (size_t q = 0; q < queries.size(); ++q) {
+                const auto expected = survivors.nearest(queries[q]);
+                const auto hit = live.nearest(queries[q]);
+                ok &= expect(live.name(hit.index) == survivors.name(expected.index) &&
+                             std::abs(hit.distance - expected.distance) < 1e-6,
+                             stage + " search for query " + std::to_string(q));
+                ok &= expect(batch[q].index == hit.index, stage + " batch for query " + std::to_string(q));
+                for (const auto& top : live.search(queries[q], 5)) {
+                    ok &= expect(std::stoul(live.name(top.index).substr(7)) % 4 != 0,
+                                 stage + " top-k must skip removed people");
+                }
+            }
+        }
+
+        // 删除后重新登记：同名是新的身份，只有新的参考特征
+        live.add("person_0", library[1]);
+        ok &= expect(live.search(library[1], 2).back().distance < 1e-5, label + " re-enrolled person must be searchable");
+        ok &= expect(live.nearest(library[0]).distance > 0.1, label + " old references must stay removed");
+    }
+
+    if (!ok) return -1;
+    std::cout << "Face gallery test passed." << std::endl;
+    return 0;
+}
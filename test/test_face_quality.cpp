@@ -0,0 +1,82 @@
+#include "FaceQuality.h"
+#include "test_utils.h"
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+using test_utils::expect;
+
+namespace {
+// 5 点关键点：两只眼睛各两个眼角，外加鼻尖；scale 缩放整张脸，nose_dx 让鼻尖水平偏移（转头）
+dlib::full_object_detection fivePointShape(double scale, long nose_dx = 0) {
+    auto at = [scale](long x, long y) {
+        return dlib::point(static_cast<long>(x * scale), static_cast<long>(y * scale));
+    };
+    std::vector<dlib::point> parts = {at(40, 50), at(60, 50), at(90, 50), at(110, 50), at(75 + nose_dx, 90)};
+    return dlib::full_object_detection(dlib::rectangle(at(20, 20), at(130, 130)), parts);
+}
+
+dlib::matrix<dlib::rgb_pixel> chipPattern(bool checkerboard) {
+    dlib::matrix<dlib::rgb_pixel> chip(150, 150);
+    for (long r = 0; r < chip.nr(); ++r) {
+        for (long c = 0; c < chip.nc(); ++c) {
+            const unsigned char v = checkerboard && ((r / 2 + c / 2) % 2) ? 220 : 40;
+            chip(r, c) = dlib::rgb_pixel(v, v, v);
+        }
+    }
+    return chip;
+}
+} // namespace
+
+int main() {
+    bool ok = true;
+    QualityOptions options;
+    options.enabled = true;
+
+    // 1. 形状预测之前按人脸框短边筛掉太小的脸
+    std::cout << "--- Face size ---" << std::endl;
+    ok &= expect(faceLargeEnough(dlib::rectangle(0, 0, 59, 59), options), "60 px face must pass");
+    ok &= expect(!faceLargeEnough(dlib::rectangle(0, 0, 200, 58), options), "short side below 60 px must fail");
+
+    // 2. 关键点几何：正脸通过，眼距过小、侧脸过大分别给出原因
+    std::cout << "--- Landmark geometry ---" << std::endl;
+    {
+        const QualityScore frontal = assessFaceQuality(fivePointShape(1.0), 100.0, options);
+        ok &= expect(frontal.passed, "frontal face must pass");
+        ok &= expect(std::abs(frontal.eye_distance - 50.0) < 1e-9 && frontal.yaw < 1e-9, "frontal eye distance and yaw");
+
+        const QualityScore small = assessFaceQuality(fivePointShape(0.3), 100.0, options);
+        ok &= expect(!small.passed && std::string(small.reason) == "eyes", "small eye distance must fail with 'eyes'");
+
+        // 鼻尖偏移 20 px、眼距 50 px：yaw = 20 * 50 / 50^2 = 0.4 > 0.35
+        const QualityScore turned = assessFaceQuality(fivePointShape(1.0, 20), 100.0, options);
+        ok &= expect(!turned.passed && std::string(turned.reason) == "yaw", "turned face must fail with 'yaw'");
+        ok &= expect(std::abs(turned.yaw - 0.4) < 1e-9, "yaw is the nose offset over the eye distance");
+        ok &= expect(assessFaceQuality(fivePointShape(1.0, 15), 100.0, options).passed, "slight turn must pass");
+    }
+
+    // 3. 清晰度：纯色芯片的拉普拉斯方差为 0，细格子芯片远高于阈值
+    std::cout << "--- Sharpness ---" << std::endl;
+    {
+        ok &= expect(grayLaplacianVariance(std::vector<float>(4, 1.f), 2, 2) == 0.0, "images under 3x3 have no sharpness");
+        const QualityScore blurred = assessFaceQuality(fivePointShape(1.0), chipPattern(false), options);
+        ok &= expect(!blurred.passed && std::string(blurred.reason) == "blur" && blurred.sharpness < 1e-9,
+                     "flat chip must fail with 'blur'");
+        const QualityScore sharp = assessFaceQuality(fivePointShape(1.0), chipPattern(true), options);
+        ok &= expect(sharp.passed && sharp.sharpness > options.min_sharpness, "detailed chip must pass");
+        ok &= expect(!assessFaceQuality(fivePointShape(1.0), options.min_sharpness - 1, options).passed,
+                     "sharpness just below the threshold must fail");
+    }
+
+    // 4. 不是 5 点模型时只看清晰度
+    std::cout << "--- Other landmark models ---" << std::endl;
+    {
+        const dlib::full_object_detection no_parts(dlib::rectangle(0, 0, 99, 99));
+        ok &= expect(assessFaceQuality(no_parts, 100.0, options).passed, "shape without 5 parts skips geometry");
+    }
+
+    if (!ok) return -1;
+    std::cout << "Face quality test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,61 @@
+#include "FaceTracker.h"
+#include "test_utils.h"
+
+#include <iostream>
+#include <string>
+
+using test_utils::expect;
+
+namespace {
+dlib::rectangle box(long left, long top, long size = 100) {
+    return dlib::rectangle(left, top, left + size - 1, top + size - 1);
+}
+} // namespace
+
+int main() {
+    bool ok = true;
+
+    // 1. 新出现的框各自开启轨迹，编号不重复
+    std::cout << "--- New tracks ---" << std::endl;
+    FaceTracker tracker(2);
+    auto tracks = tracker.update({box(0, 0), box(300, 0)});
+    ok &= expect(tracks.size() == 2 && tracker.size() == 2, "two faces open two tracks");
+    const uint64_t left_id = tracker.track(tracks[0]).id;
+    const uint64_t right_id = tracker.track(tracks[1]).id;
+    ok &= expect(left_id != right_id, "track ids must be unique");
+    tracker.track(tracks[0]).label = "alice";
+
+    // 2. 移动不大的框关联到原轨迹，结果沿轨迹保留；输入顺序不影响关联
+    std::cout << "--- Association ---" << std::endl;
+    tracks = tracker.update({box(310, 5), box(10, 5)});
+    ok &= expect(tracker.size() == 2, "moved faces must not open new tracks");
+    ok &= expect(tracker.track(tracks[1]).id == left_id && tracker.track(tracks[1]).label == "alice",
+                 "label must follow the track");
+    ok &= expect(tracker.track(tracks[0]).id == right_id, "second face keeps its track");
+
+    // 3. 不重叠的框不会被关联（IoU 低于阈值）
+    std::cout << "--- No overlap ---" << std::endl;
+    tracks = tracker.update({box(10, 5), box(310, 5), box(600, 300)});
+    ok &= expect(tracker.size() == 3 && tracker.track(tracks[2]).label.empty(), "distant face opens a new track");
+
+    // 4. 连续 max_missed 次没有检测到仍然保留，再多一次被删除；之后同一位置是新轨迹
+    std::cout << "--- Expiry ---" << std::endl;
+    tracker.update({box(310, 5), box(600, 300)});
+    tracks = tracker.update({box(310, 5), box(600, 300)});
+    ok &= expect(tracker.size() == 3, "track missed twice must be kept");
+    tracks = tracker.update({box(310, 5), box(600, 300)});
+    ok &= expect(tracker.size() == 2, "track missed three times must be dropped");
+    ok &= expect(tracker.track(tracks[0]).id == right_id, "indices must stay valid after dropping a track");
+    tracks = tracker.update({box(10, 5), box(310, 5), box(600, 300)});
+    ok &= expect(tracker.track(tracks[0]).id != left_id && tracker.track(tracks[0]).label.empty(),
+                 "a face returning after expiry starts a fresh track");
+
+    // 5. 没有人脸时所有轨迹逐渐过期
+    std::cout << "--- Empty frames ---" << std::endl;
+    for (int i = 0; i < 3; ++i) tracker.update({});
+    ok &= expect(tracker.empty(), "all tracks expire without detections");
+
+    if (!ok) return -1;
+    std::cout << "Face tracker test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,59 @@
+#include "FrameRecorder.h"
+#include <iostream>
+#include <filesystem>
+#include <vector>
+
+int main() {
+    const std::string path = "test_frame_recorder.ddfgrec";
+    const int frame_num = 5;
+    const long long interval_ns = 40'000'000; // 25 FPS
+
+    // 1. 录制几帧合成图像
+    std::cout << "--- Recording synthetic frames ---" << std::endl;
+    {
+        FrameRecorder recorder(path, 95);
+        if (!recorder.isOpened()) {
+            return -1;
+        }
+        for (int i = 0; i < frame_num; ++i) {
+            cv::Mat frame(120, 160, CV_8UC3, cv::Scalar(i * 40, 100, 200 - i * 30));
+            if (!recorder.write(frame, 1000 + i * interval_ns)) {
+                std::cerr << "Failed to write frame " << i << std::endl;
+                return -1;
+            }
+        }
+    }
+
+    // 2. 尽可能快地回放，检查帧数、尺寸和时间间隔
+    std::cout << "--- Replaying recording ---" << std::endl;
+    FrameReplaySource source(path, false);
+    if (!source.isOpened()) {
+        return -1;
+    }
+
+    cv::Mat frame;
+    long long timestamp_ns = 0;
+    std::vector<long long> timestamps;
+    while (source.read(frame, timestamp_ns)) {
+        if (frame.cols != 160 || frame.rows != 120) {
+            std::cerr << "Unexpected frame size " << frame.cols << "x" << frame.rows << std::endl;
+            return -1;
+        }
+        timestamps.push_back(timestamp_ns);
+    }
+
+    if (static_cast<int>(timestamps.size()) != frame_num) {
+        std::cerr << "Expected " << frame_num << " frames, got " << timestamps.size() << std::endl;
+        return -1;
+    }
+    for (size_t i = 1; i < timestamps.size(); ++i) {
+        if (timestamps[i] - timestamps[i - 1] != interval_ns) {
+            std::cerr << "Timestamp gap mismatch at frame " << i << std::endl;
+            return -1;
+        }
+    }
+
+    std::filesystem::remove(path);
+    std::cout << "Replay PASSED: " << timestamps.size() << " frames." << std::endl;
+    return 0;
+}
@@ -0,0 +1,158 @@
+#include "FaceGallery.h"
+#include "GalleryShard.h"
+#include "test_utils.h"
+
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+
+using test_utils::expect;
+using test_utils::randomDescriptor;
+
+namespace {
+// 在子进程中启动一个分片服务，持有 person % shard_count == shard 的身份；返回子进程 pid，port 为实际端口
+pid_t startShard(const std::vector<dlib::matrix<float,0,1>>& library, size_t shard, size_t shard_count,
+                 int& port) {
+    int pipe_fds[2];
+    if (::pipe(pipe_fds) != 0) return -1;
+    const pid_t pid = ::fork();
+    if (pid == 0) {
+        ::close(pipe_fds[0]);
+        FaceGallery gallery;
+        for (size_t person = shard; person < library.size(); person += shard_count) {
+            gallery.add("person_" + std::to_string(person), library[person]);
+            if (person % 4 == 0) gallery.addToWatchlist("person_" + std::to_string(person), "vip");
+        }
+        gallery.buildIndex();
+        GalleryShardServer server(gallery, 0);
+        const int actual = server.port();
+        if (::write(pipe_fds[1], &actual, sizeof(actual)) != sizeof(actual)) ::_exit(1);
+        ::close(pipe_fds[1]);
+        server.serve();  // 由父进程 SIGKILL 结束
+        ::_exit(0);
+    }
+    ::close(pipe_fds[1]);
+    port = 0;
+    const bool ok = pid > 0 && ::read(pipe_fds[0], &port, sizeof(port)) == sizeof(port);
+    ::close(pipe_fds[0]);
+    return ok ? pid : -1;
+}
+} // namespace
+
+int main() {
+    const long dim = 128;
+    const size_t count = 900;
+    const size_t shard_count = 3;
+    std::mt19937 rng(7);
+    std::normal_distribution<float> noise(0.f, 0.02f);
+
+    std::vector<dlib::matrix<float,0,1>> library;
+    for (size_t i = 0; i < count; ++i) library.push_back(randomDescriptor(rng, dim));
+    std::vector<dlib::matrix<float,0,1>> queries;
+    for (size_t i = 0; i < count; i += 15) {
+        dlib::matrix<float,0,1> query = library[i];
+        for (long k = 0; k < dim; ++k) query(k) += noise(rng);
+        queries.push_back(query);
+    }
+
+    // 单进程的完整人脸库作为参照
+    FaceGallery reference;
+    for (size_t i = 0; i < count; ++i) {
+        reference.add("person_" + std::to_string(i), library[i]);
+        if (i % 4 == 0) reference.addToWatchlist("person_" + std::to_string(i), "vip");
+    }
+
+    std::vector<pid_t> children;
+    std::vector<ShardEndpoint> endpoints;
+    for (size_t shard = 0; shard < shard_count; ++shard) {
+        ShardEndpoint endpoint;
+        const pid_t pid = startShard(library, shard, shard_count, endpoint.port);
+        if (pid < 0) {
+            std::cerr << "Cannot start shard process, skipping." << std::endl;
+            for (pid_t child : children) ::kill(child, SIGKILL);
+            return 77;
+        }
+        children.push_back(pid);
+        endpoints.push_back(endpoint);
+    }
+
+    bool ok = true;
+
+    // 1. 三个分片进程合并的 top-k 与完整人脸库的检索一致
+    std::cout << "--- Fan-out and merge ---" << std::endl;
+    {
+        ShardedGallery sharded(endpoints, std::chrono::milliseconds(2000));
+        const size_t k = 5;
+        const auto merged = sharded.search(queries, k);
+        ok &= expect(merged.size() == queries.size(), "one result list per query");
+        for (size_t q = 0; q < queries.size() && q < merged.size(); ++q) {
+            const auto expected = reference.search(queries[q], k);
+            ok &= expect(merged[q].size() == expected.size(), "top-k size for query " + std::to_string(q));
+            for (size_t i = 0; i < expected.size() && i < merged[q].size(); ++i) {
+                ok &= expect(merged[q][i].name == reference.name(expected[i].index) &&
+                             std::abs(merged[q][i].distance - expected[i].distance) < 1e-6,
+                             "rank " + std::to_string(i) + " for query " + std::to_string(q));
+            }
+        }
+
+        // 名单按名字传给各分片
+        const auto vip = sharded.search(queries, 1, {"vip"});
+        for (size_t q = 0; q < queries.size(); ++q) {
+            const auto expected = reference.nearest(queries[q], reference.watchlistMask({"vip"}));
+            ok &= expect(!vip[q].empty() && vip[q].front().name == reference.name(expected.index),
+                         "watchlist search for query " + std::to_string(q));
+        }
+        const auto nobody = sharded.search(queries, 1, {"undefined"});
+        ok &= expect(nobody.front().empty(), "undefined watchlist must match nobody");
+        ok &= expect(sharded.failedRequests() == 0, "no shard may fail");
+    }
+
+    // 2. 不回答的分片（只监听、从不 accept）在超时后被跳过，其余分片的结果照常返回
+    std::cout << "--- Per-shard timeout ---" << std::endl;
+    {
+        const int silent = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t length = sizeof(address);
+        ::bind(silent, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        ::listen(silent, 4);
+        ::getsockname(silent, reinterpret_cast<sockaddr*>(&address), &length);
+
+        auto with_silent = endpoints;
+        ShardEndpoint stalled;
+        stalled.port = ntohs(address.sin_port);
+        with_silent.push_back(stalled);
+        ShardedGallery sharded(with_silent, std::chrono::milliseconds(100));
+
+        const auto start = std::chrono::steady_clock::now();
+        const auto merged = sharded.search(queries, 1);
+        const double elapsed_ms =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::cout << "Search with a silent shard took " << elapsed_ms << " ms" << std::endl;
+        ok &= expect(elapsed_ms < 1000, "silent shard must not block beyond its timeout");
+        ok &= expect(sharded.failedRequests() == 1, "silent shard must be counted as failed");
+        for (size_t q = 0; q < queries.size(); ++q) {
+            ok &= expect(!merged[q].empty() && merged[q].front().name == "person_" + std::to_string(q * 15),
+                         "live shards must still answer query " + std::to_string(q));
+        }
+        ::close(silent);
+    }
+
+    for (pid_t child : children) {
+        ::kill(child, SIGKILL);
+        ::waitpid(child, nullptr, 0);
+    }
+
+    if (!ok) return -1;
+    std::cout << "Gallery shard test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "MotionGate.h"
+#include "test_utils.h"
+#include <iostream>
+
+using test_utils::expect;
+
+int main() {
+    MotionGateOptions options;
+    options.enabled = true;
+    options.hold_frames = 2;
+    options.track_max_missed = 1;
+    options.keyframe_interval = 0;
+
+    bool ok = true;
+    MotionGate gate(options);
+    cv::Mat background(240, 320, CV_8UC3, cv::Scalar(90, 90, 90));
+
+    // 1. 第一帧总是检测，之后静止画面在保持帧数用完后被跳过
+    std::cout << "--- Static scene ---" << std::endl;
+    ok &= expect(gate.shouldDetect(background), "first frame must be detected");
+    gate.observe({});
+    ok &= expect(gate.shouldDetect(background), "hold frame 1");
+    ok &= expect(!gate.shouldDetect(background), "static frame after hold must be skipped");
+    ok &= expect(!gate.shouldDetect(background), "static frame must stay skipped");
+
+    // 2. 画面中出现明显变化时放行
+    std::cout << "--- Scene change ---" << std::endl;
+    cv::Mat moved = background.clone();
+    cv::rectangle(moved, cv::Rect(100, 60, 80, 100), cv::Scalar(220, 200, 180), cv::FILLED);
+    ok &= expect(gate.shouldDetect(moved), "changed frame must be detected");
+
+    // 3. 有活动跟踪时即使画面静止也继续检测，目标丢失后恢复跳过
+    std::cout << "--- Active track ---" << std::endl;
+    FaceResult face;
+    face.rect = dlib::rectangle(100, 60, 180, 160);
+    gate.observe({face});
+    ok &= expect(gate.trackActive(), "track should be active after a detection");
+    for (int i = 0; i < 3; ++i) {
+        ok &= expect(gate.shouldDetect(moved), "static frame with active track must be detected");
+        gate.observe({face});
+    }
+    gate.observe({});
+    gate.observe({});
+    ok &= expect(!gate.trackActive(), "track should expire after missed detections");
+    ok &= expect(!gate.shouldDetect(moved), "static frame without track must be skipped");
+
+    if (!ok) return -1;
+    std::cout << "Motion gate test passed." << std::endl;
+    return 0;
+}
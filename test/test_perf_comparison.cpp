@@ -0,0 +1,79 @@
+#include "perf_comparison.h"
+#include "test_utils.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+
+using test_utils::expect;
+
+namespace {
+const char* kBaseline = R"({
+    "tolerance": {"p50": 0.15, "p99": 0.30, "throughput": 0.10},
+    "throughput_fps": 20.0,
+    "stages": {
+        "人脸检测": {"p50_ms": 10.0, "p99_ms": 20.0},
+        "核心人脸识别": {"p50_ms": 5.0, "p99_ms": 8.0, "tolerance": {"p50": 1.0}}
+    }
+})";
+
+std::string printed(const PerfCheck& check) {
+    std::ostringstream out;
+    printPerfCheck(out, check);
+    return out.str();
+}
+} // namespace
+
+// 性能回归的比较逻辑：容差内通过，超出容差标为 REGRESSED，基线中的阶段没跑到也失败
+int main() {
+    const auto baseline = nlohmann::json::parse(kBaseline);
+    bool ok = true;
+
+    // 1. 都在容差内（识别阶段的 p50 用了单独放宽的容差）
+    std::cout << "--- Within tolerance ---" << std::endl;
+    {
+        const PerfCheck check = comparePerformance(
+            baseline, {{"人脸检测", 11.0, 25.0}, {"核心人脸识别", 9.0, 8.0}, {"图像编码", 3.0, 4.0}}, 19.0);
+        ok &= expect(check.rows.size() == 5, "two rows per baseline stage plus throughput");
+        ok &= expect(check.passed(), "numbers within tolerance must pass");
+        const std::string text = printed(check);
+        ok &= expect(text.find("REGRESSED") == std::string::npos && text.find("FAILED") == std::string::npos,
+                     "a passing run must not print failures");
+    }
+
+    // 2. 超出容差的指标标为 REGRESSED，吞吐量越低越差
+    std::cout << "--- Regression ---" << std::endl;
+    {
+        const PerfCheck check =
+            comparePerformance(baseline, {{"人脸检测", 12.0, 20.0}, {"核心人脸识别", 5.0, 8.0}}, 17.0);
+        ok &= expect(!check.passed(), "a slower p50 must fail");
+        ok &= expect(check.failures() == 2, "detection p50 and throughput regressed");
+        const std::string text = printed(check);
+        ok &= expect(text.find("REGRESSED") != std::string::npos, "the table must mark regressed rows");
+        ok &= expect(text.find("+20.0%") != std::string::npos, "the table must show the relative change");
+        ok &= expect(text.find("2 metric(s) regressed") != std::string::npos, "the failure count must be printed");
+    }
+
+    // 3. 基线中的阶段在本次运行中缺失
+    std::cout << "--- Missing stage ---" << std::endl;
+    {
+        const PerfCheck check = comparePerformance(baseline, {{"人脸检测", 10.0, 20.0}}, 20.0);
+        ok &= expect(check.failures() == 0, "the exercised stage is within tolerance");
+        ok &= expect(!check.passed(), "a missing stage must fail");
+        ok &= expect(printed(check).find("baseline stage '核心人脸识别' was not exercised") != std::string::npos,
+                     "the missing stage must be named");
+    }
+
+    // 4. 没有吞吐量基线时不比较吞吐量
+    {
+        auto no_fps = baseline;
+        no_fps["throughput_fps"] = 0;
+        const PerfCheck check =
+            comparePerformance(no_fps, {{"人脸检测", 10.0, 20.0}, {"核心人脸识别", 5.0, 8.0}}, 1.0);
+        ok &= expect(check.rows.size() == 4 && check.passed(), "throughput is skipped without a baseline value");
+    }
+
+    if (!ok) return -1;
+    std::cout << "Performance comparison test passed." << std::endl;
+    return 0;
+}
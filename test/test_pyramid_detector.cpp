@@ -0,0 +1,46 @@
+#include "PyramidDetector.h"
+#include <iostream>
+#include <vector>
+
+// 并行扫描（多层并行 + 大层切条带）必须与单线程扫描得到完全相同的人脸框
+int main() {
+    const std::vector<std::string> paths = {"../facelib/Elon_Musk/1.jpg", "../test/stranger_face.jpg"};
+
+    DetectionOptions sequential_options;
+    sequential_options.threads = 1;
+    DetectionOptions parallel_options;
+    parallel_options.threads = 4;
+    PyramidDetector sequential(sequential_options);
+    PyramidDetector parallel(parallel_options);
+
+    int checked = 0;
+    for (const auto& path : paths) {
+        cv::Mat image = cv::imread(path);
+        if (image.empty()) {
+            std::cout << "Skipping missing image " << path << std::endl;
+            continue;
+        }
+        // 放大一倍，保证大层会被切成多个条带
+        cv::Mat enlarged;
+        cv::resize(image, enlarged, cv::Size(), 2.0, 2.0, cv::INTER_LINEAR);
+
+        for (const cv::Mat* input : {&image, &enlarged}) {
+            const auto expected = sequential.detect(*input);
+            const auto actual = parallel.detect(*input);
+            std::cout << path << " (" << input->cols << "x" << input->rows << "): " << expected.size()
+                      << " face(s)" << std::endl;
+            if (expected != actual) {
+                std::cerr << "Parallel detection differs from sequential detection: " << actual.size()
+                          << " vs " << expected.size() << " face(s)" << std::endl;
+                return -1;
+            }
+            ++checked;
+        }
+    }
+
+    if (checked == 0) {
+        return 77;  // 没有测试图片，记为跳过
+    }
+    std::cout << "Pyramid detector test passed." << std::endl;
+    return 0;
+}
@@ -0,0 +1,121 @@
+#include "FaceGallery.h"
+#include "StrangerClusters.h"
+#include "test_utils.h"
+
+#include <iostream>
+#include <random>
+#include <set>
+
+using test_utils::expect;
+using test_utils::randomDescriptor;
+
+namespace {
+dlib::matrix<float,0,1> sighting(std::mt19937& rng, const dlib::matrix<float,0,1>& person) {
+    std::normal_distribution<float> noise(0.f, 0.01f);  // 每维 0.01，128 维时离中心约 0.11
+    dlib::matrix<float,0,1> desc = person;
+    for (long i = 0; i < desc.size(); ++i) desc(i) += noise(rng);
+    return desc;
+}
+} // namespace
+
+int main() {
+    const long dim = 128;
+    std::mt19937 rng(11);
+    std::vector<dlib::matrix<float,0,1>> people;
+    for (int i = 0; i < 6; ++i) people.push_back(randomDescriptor(rng, dim));
+    const auto start = StrangerClusters::Clock::now();
+    const auto at = [start](double seconds) {
+        return start + std::chrono::duration_cast<StrangerClusters::Clock::duration>(std::chrono::duration<double>(seconds));
+    };
+
+    bool ok = true;
+
+    // 1. 反复出现的陌生人得到稳定的编号，不同的人编号不同
+    std::cout << "--- Stable labels ---" << std::endl;
+    {
+        StrangerOptions options;
+        options.min_sightings = 3;
+        StrangerClusters clusters(options);
+        std::vector<std::string> labels(3);
+        for (int round = 0; round < 10; ++round) {
+            for (size_t person = 0; person < 3; ++person) {
+                const std::string label = clusters.assign(sighting(rng, people[person]), at(round));
+                if (round == 0) labels[person] = label;
+                ok &= expect(label == labels[person], "person " + std::to_string(person) + " must keep its label");
+            }
+        }
+        ok &= expect(std::set<std::string>(labels.begin(), labels.end()).size() == 3, "labels must be distinct");
+        ok &= expect(labels[0].rfind(StrangerClusters::labelPrefix(), 0) == 0, "labels must start with the prefix");
+        ok &= expect(clusters.activeClusters() == 3 && clusters.uniqueVisitors() == 3, "three clusters, three visitors");
+
+        // 只出现一次的人不计入访客数
+        clusters.assign(sighting(rng, people[3]), at(10));
+        ok &= expect(clusters.activeClusters() == 4 && clusters.uniqueVisitors() == 3,
+                     "a single sighting must not count as a visitor");
+    }
+
+    // 2. 超过 max_age_s 没出现的聚类被丢弃，再来时是新编号
+    std::cout << "--- Age cap ---" << std::endl;
+    {
+        StrangerOptions options;
+        options.max_age_s = 60;
+        StrangerClusters clusters(options);
+        const std::string first = clusters.assign(sighting(rng, people[0]), at(0));
+        clusters.assign(sighting(rng, people[1]), at(50));
+        ok &= expect(clusters.assign(sighting(rng, people[0]), at(55)) == first, "recent visitor keeps its label");
+        clusters.assign(sighting(rng, people[2]), at(200));  // 新聚类触发淘汰
+        ok &= expect(clusters.activeClusters() == 1, "expired clusters must be dropped");
+        ok &= expect(clusters.assign(sighting(rng, people[0]), at(201)) != first,
+                     "a visitor returning after max_age_s gets a new label");
+    }
+
+    // 3. 聚类数达到上限时淘汰最久未出现的一个，内存不随陌生人数增长
+    std::cout << "--- Cluster cap ---" << std::endl;
+    {
+        StrangerOptions options;
+        options.max_clusters = 2;
+        StrangerClusters clusters(options);
+        const std::string a = clusters.assign(sighting(rng, people[0]), at(0));
+        const std::string b = clusters.assign(sighting(rng, people[1]), at(1));
+        clusters.assign(sighting(rng, people[0]), at(2));  // a 比 b 更近出现过
+        clusters.assign(sighting(rng, people[2]), at(3));  // 满员，淘汰 b
+        ok &= expect(clusters.activeClusters() == 2, "cluster count must stay at the cap");
+        ok &= expect(clusters.assign(sighting(rng, people[0]), at(4)) == a, "recently seen cluster must survive");
+        ok &= expect(clusters.assign(sighting(rng, people[1]), at(5)) != b, "least recently seen cluster is evicted");
+    }
+
+    // 4. 识别结果的改写（recognize / recognizeAll / recognizeBatch 共用）：只有不限名单时
+    //    未匹配的 "Stranger" 换成聚类标签，熟人和限定名单的结果不变
+    std::cout << "--- Labelling recognition results ---" << std::endl;
+    {
+        StrangerClusters clusters;
+        const std::vector<dlib::matrix<float,0,1>> descriptors = {
+            sighting(rng, people[0]), sighting(rng, people[1]), sighting(rng, people[0])};
+        std::vector<std::string> names = {"Stranger", "Alice", "Stranger"};
+
+        clusters.labelUnmatched(descriptors, names, uint64_t{1});
+        ok &= expect(names == std::vector<std::string>({"Stranger", "Alice", "Stranger"}),
+                     "a watchlist-restricted search must not label strangers");
+        ok &= expect(clusters.activeClusters() == 0, "a watchlist-restricted search must not create clusters");
+
+        clusters.labelUnmatched(descriptors, names, FaceGallery::kAllWatchlists);
+        ok &= expect(names[1] == "Alice", "matched names must be kept");
+        ok &= expect(names[0] != "Stranger" && StrangerClusters::isStrangerLabel(names[0]),
+                     "unmatched faces must get a Stranger-N label");
+        ok &= expect(names[2] == names[0], "the same stranger twice in one batch must share a label");
+        ok &= expect(clusters.activeClusters() == 1, "only unmatched faces are clustered");
+    }
+
+    // 5. 陌生人判定只认 "Stranger" 和 "Stranger-<数字>"，不误伤以 Stranger 开头的登记姓名
+    std::cout << "--- Stranger labels ---" << std::endl;
+    ok &= expect(StrangerClusters::isStrangerLabel("Stranger"), "plain Stranger");
+    ok &= expect(StrangerClusters::isStrangerLabel("Stranger-17"), "clustered Stranger-N");
+    ok &= expect(!StrangerClusters::isStrangerLabel("Strangerfield"), "enrolled name with the prefix");
+    ok &= expect(!StrangerClusters::isStrangerLabel("Stranger-Things"), "non-numeric suffix");
+    ok &= expect(!StrangerClusters::isStrangerLabel("Stranger-"), "empty suffix");
+    ok &= expect(!StrangerClusters::isStrangerLabel("Unknown"), "low-quality placeholder");
+
+    if (!ok) return -1;
+    std::cout << "Stranger clustering test passed." << std::endl;
+    return 0;
+}
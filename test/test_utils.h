@@ -0,0 +1,29 @@
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+// 各测试程序共用的小工具，只在 test/ 下使用
+
+#include <dlib/matrix.h>
+#include <iostream>
+#include <random>
+#include <string>
+
+namespace test_utils {
+
+// 条件不成立时打印说明；返回条件本身，用法 ok &= expect(...)
+inline bool expect(bool condition, const std::string& message) {
+    if (!condition) std::cerr << "FAILED: " << message << std::endl;
+    return condition;
+}
+
+// 随机方向的单位向量，代替真实的人脸特征
+inline dlib::matrix<float,0,1> randomDescriptor(std::mt19937& rng, long dim) {
+    std::normal_distribution<float> normal(0.f, 1.f);
+    dlib::matrix<float,0,1> desc(dim);
+    for (long i = 0; i < dim; ++i) desc(i) = normal(rng);
+    return desc / dlib::length(desc);
+}
+
+} // namespace test_utils
+
+#endif // TEST_UTILS_H
@@ -12,23 +12,34 @@
 #include <string>
 #include <fstream>
 #include <filesystem> // C++17 filesystem，用于遍历人脸库目录
+#include <atomic>
 #include <csignal> // For signal handling
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
 
 // 项目自定义头文件
 #include "ConfigParser.h"    // 位于 include/
 #include "FaceRecognition.hpp" // 位于 include/
 #include "PerformanceMonitor.h" // <-- 添加这一行
+#include "CaptureWorker.h"
+#include "EnrollmentService.h"
+#include "HttpStreamServer.h"      // MJPEG 推流 + 在线登记路由
+#include "StrangerClusters.h"
+#include "OfflineVideoProcessor.h"
 
 // MJPEG Streamer 的头文件路径
-#include <nadjieb/mjpeg_streamer.hpp> // 确保这个路径和文件存在
 
 namespace fs = std::filesystem; // 使用 std::filesystem 命名空间
 
-// 定义一个信号处理函数，以便在程序退出时打印报告
+// Ctrl+C 只设置标志，由主循环退出并走正常的收尾流程（停止采集、刷新录像、打印最终报告）。
+// 处理函数里不能做 I/O 或调用 exit()；再按一次 Ctrl+C 按默认方式立即终止
+std::atomic<bool> g_stop_requested{false};
+
 void signalHandler(int signum) {
-    std::cout << "\n收到中断信号 (" << signum << ")。\n";
-    PerformanceMonitor::getInstance().printReport(); // 打印性能报告
-    exit(signum); // 正常退出
+    g_stop_requested = true;
+    std::signal(signum, SIG_DFL);
 }
 
 int main() {
@@ -37,15 +48,52 @@ int main() {
 
     // --- 初始化 ConfigParser ---
     ConfigParser config; // 默认构造
-    // 尝试加载配置文件
-    if (!config.load("config/config.json")) { // 调用 load 方法
-        std::cerr << "错误: 无法加载配置文件 config/config.json" << std::endl;
+    {
+        ScopedStartupPhase phase("解析配置");
+        // 尝试加载配置文件
+        if (!config.load("config/config.json")) { // 调用 load 方法
+            std::cerr << "错误: 无法加载配置文件 config/config.json" << std::endl;
+            return 1;
+        }
+    }
+    if (config.settings().debug_mode) {
+        config.printAll(); // 打印所有配置，方便调试
+    }
+
+    // --- 离线模式：use_camera 为 false 时处理 video_path 指定的录像文件，不推流 ---
+    if (!config.settings().use_camera) {
+        try {
+            FaceRecognition face_recognizer(config);
+            OfflineVideoProcessor processor(face_recognizer, OfflineOptions::fromConfig(config));
+            bool ok = processor.run();
+            PerformanceMonitor::getInstance().printReport();
+            return ok ? 0 : 1;
+        } catch (const std::exception& e) {
+            std::cerr << "离线处理失败: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+
+    // --- 帧来源：config.json 中的 sources 列表，未配置时为默认摄像头 ---
+    // 打开摄像头较慢且不依赖模型，放到后台与模型加载并行
+    std::vector<SourceConfig> source_configs;
+    try {
+        source_configs = loadSourceConfigs(config);
+    } catch (const std::exception& e) {
+        std::cerr << "错误: 视频源配置无效: " << e.what() << std::endl;
         return 1;
     }
-    config.printAll(); // 打印所有配置，方便调试
+    std::vector<std::future<std::unique_ptr<FrameSource>>> sources_opened;
+    for (const auto& source_config : source_configs) {
+        sources_opened.push_back(std::async(std::launch::async, [source_config]() {
+            ScopedStartupPhase phase("打开帧来源 (" + source_config.name + ")");
+            return openFrameSource(source_config);
+        }));
+    }
 
     // --- 初始化 FaceRecognition 对象 ---
     // 将已加载的 config 对象传递给 FaceRecognition 构造函数
+    // 所有视频源共享这一个实例（模型、人脸库、推理池都只有一份）
     FaceRecognition face_recognizer(config);
 
     try {
@@ -56,97 +104,104 @@ int main() {
         return 1;
     }
 
-    cv::VideoCapture cap(0); // 打开默认摄像头
-    if (!cap.isOpened()) {
-        std::cerr << "无法打开摄像头" << std::endl;
-        return -1;
+    // 在线登记（enrollment.enabled）：与视频流共用 8080 端口，须在 streamer 之前构造、之后析构
+    const EnrollmentOptions enrollment_options = EnrollmentOptions::fromConfig(config);
+    std::unique_ptr<EnrollmentService> enrollment;
+    if (enrollment_options.enabled) {
+        enrollment = std::make_unique<EnrollmentService>(face_recognizer, enrollment_options);
     }
 
-    // 初始化 MJPEG Streamer
-    nadjieb::MJPEGStreamer streamer;
+    // 初始化 MJPEG 推流服务；开启登记时请求上限为图片上限再加 64KB 请求头
+    HttpStreamServer streamer(enrollment ? enrollment_options.max_body_bytes + (64u << 10) : (1u << 20));
+    if (enrollment) {
+        streamer.route(enrollment_options.path, [&enrollment](const HttpStreamServer::Request& req) {
+            const auto reply = enrollment->handle(req.method, req.target, req.header("Content-Type"), req.body);
+            HttpStreamServer::Response res;
+            res.status = reply.status;
+            res.reason = reply.reason();
+            res.body = reply.body;
+            return res;
+        });
+        std::cout << "在线登记: http://<host>:8080" << enrollment_options.path << "?name=<姓名>" << std::endl;
+    }
     streamer.start(8080); // 在 8080 端口启动流
 
-    // Dlib 人脸检测器
-    dlib::frontal_face_detector detector = dlib::get_frontal_face_detector();
+    // Publisher 的 topic 表没有加锁，多路视频源的发布需要串行化
+    std::mutex publish_mutex;
+    auto publish = [&streamer, &publish_mutex](const std::string& topic, const std::vector<uchar>& jpeg) {
+        std::string payload(jpeg.begin(), jpeg.end());
+        std::lock_guard<std::mutex> lock(publish_mutex);
+        streamer.publish(topic, payload);
+    };
+
+    std::vector<std::unique_ptr<CaptureWorker>> workers;
+    for (size_t i = 0; i < source_configs.size(); ++i) {
+        std::unique_ptr<FrameSource> source = sources_opened[i].get();
+        if (!source->isOpened()) {
+            std::cerr << "无法打开帧来源: " << source->describe() << std::endl;
+            return -1;
+        }
+        std::cout << "视频源 " << source_configs[i].name << ": " << source->describe()
+                  << " -> http://<host>:8080" << source_configs[i].topic << std::endl;
+        try {
+            workers.push_back(std::make_unique<CaptureWorker>(source_configs[i], std::move(source),
+                                                              face_recognizer, publish));
+        } catch (const std::exception& e) {
+            std::cerr << "无法启动视频源 " << source_configs[i].name << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    for (auto& worker : workers) {
+        worker->start();
+    }
 
-    cv::Mat frame;
-    long long frame_counter = 0; // 用于统计处理了多少帧
-    const int REPORT_INTERVAL_FRAMES = 5; // <-- 调整为5帧，方便调试时快速看到报告
+    size_t reported_frames = 0;
+    const size_t REPORT_INTERVAL_FRAMES = 5; // <-- 调整为5帧，方便调试时快速看到报告
+    bool timeline_printed = false;
 
+    // 主线程只负责汇总报告，等待所有视频源结束（或 Ctrl+C）
     while (true) {
-        // 统计一帧的总处理时间
-        PM_START("总帧处理");
-        PerformanceMonitor::getInstance().startFrame(); // 统计总帧率
-
-        cap >> frame;
-        if (frame.empty()) {
-            std::cerr << "帧为空。退出程序。" << std::endl;
-            break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+        bool all_published = true;
+        bool all_finished = true;
+        size_t frame_counter = 0; // 所有视频源一共处理了多少帧
+        for (const auto& worker : workers) {
+            all_published = all_published && (worker->hasPublished() || worker->finished());
+            all_finished = all_finished && worker->finished();
+            frame_counter += worker->framesProcessed();
         }
 
-        // --- 人脸检测 ---
-        PM_SCOPED(人脸检测); // 使用 RAII 宏，自动开始和结束计时
-        dlib::cv_image<dlib::bgr_pixel> dlib_img(frame);
-        std::vector<dlib::rectangle> faces = detector(dlib_img);
-
-        // --- 人脸处理与识别 ---
-        PM_START("人脸处理与识别（总）"); // 手动开始/停止
-        for (const auto& face_rect : faces) {
-            PM_SCOPED(形状预测);
-            dlib::full_object_detection shape = face_recognizer.getShapePredictor()(dlib_img, face_rect);
-
-            PM_SCOPED(人脸芯片提取);
-            dlib::matrix<dlib::rgb_pixel> face_chip;
-            dlib::extract_image_chip(dlib_img, dlib::get_face_chip_details(shape, 150, 0.25), face_chip);
-
-            PM_SCOPED(核心人脸识别);
-            std::string recognized_name = face_recognizer.recognize(face_chip);
-
-            // --- 在图像上绘制人脸信息 ---
-            PM_SCOPED(绘制覆盖物);
-            cv::Scalar color = (recognized_name == "Stranger") ? cv::Scalar(0, 0, 255) : cv::Scalar(0, 255, 0); // 陌生人红色，已知人脸绿色
-            int baseline = 0;
-            cv::Size textSize = cv::getTextSize(recognized_name, cv::FONT_HERSHEY_SIMPLEX, 0.9, 2, &baseline);
-            // 显式转换为 int
-            cv::Point textOrg(static_cast<int>(face_rect.tl_corner().x()), static_cast<int>(face_rect.tl_corner().y()) - 10);
-
-            // 绘制背景矩形以提高文本可读性
-            cv::rectangle(frame, textOrg + cv::Point(0, baseline), textOrg + cv::Point(textSize.width, -textSize.height), color, cv::FILLED);
-            cv::putText(frame, recognized_name, textOrg, cv::FONT_HERSHEY_SIMPLEX, 0.9, cv::Scalar(255, 255, 255), 2);
-
-            // --- 最后绘制人脸矩形，以免干扰识别输入 ---
-            // 显式转换为 int
-            cv::rectangle(frame, cv::Point(static_cast<int>(face_rect.tl_corner().x()), static_cast<int>(face_rect.tl_corner().y())),
-                                  cv::Point(static_cast<int>(face_rect.br_corner().x()), static_cast<int>(face_rect.br_corner().y())), color, 2);
+        if (!timeline_printed && all_published) {
+            PerformanceMonitor::getInstance().printStartupTimeline();
+            timeline_printed = true;
         }
-        PM_STOP("人脸处理与识别（总）"); // 停止手动开始的任务
-
-        // --- 图像编码和发布 ---
-        PM_SCOPED(图像编码与发布);
-        std::vector<uchar> buffer;
-        cv::imencode(".jpg", frame, buffer, {cv::IMWRITE_JPEG_QUALITY, 80});
-        streamer.publish("/webcam", std::string(buffer.begin(), buffer.end()));
-
-        PerformanceMonitor::getInstance().stopFrame(); // 停止总帧率统计
-        PM_STOP("总帧处理"); // 停止一帧的总处理时间
-
-        frame_counter++;
-        if (frame_counter % REPORT_INTERVAL_FRAMES == 0) {
+        if (frame_counter / REPORT_INTERVAL_FRAMES > reported_frames / REPORT_INTERVAL_FRAMES) {
             std::cout << "\n已处理 " << frame_counter << " 帧。生成报告...\n";
+            for (const auto& worker : workers) {
+                std::cout << "  " << worker->name() << ": " << worker->framesProcessed() << " 帧，丢弃 "
+                          << worker->framesDropped() << " 帧，静止跳过检测 " << worker->framesSkipped() << " 帧\n";
+            }
+            if (const StrangerClusters* strangers = face_recognizer.strangers()) {
+                std::cout << "  陌生访客（去重）: " << strangers->uniqueVisitors() << " 人，当前保留聚类 "
+                          << strangers->activeClusters() << " 个\n";
+            }
             PerformanceMonitor::getInstance().printReport();
             // PerformanceMonitor::getInstance().reset(); // 如果需要，可以重置统计数据
+            reported_frames = frame_counter;
+        }
+        if (all_finished) {
+            std::cerr << "所有视频源均已结束。退出程序。" << std::endl;
+            break;
+        }
+        if (g_stop_requested) {
+            std::cout << "\n收到中断信号，正在停止视频源..." << std::endl;
+            break;
         }
-
-        // （可选）在本地显示
-        // cv::imshow("Webcam Stream", frame); // <--- 重新注释掉此行
-        // if (cv::waitKey(1) == 27) { // 按 ESC 退出
-        //     break;
-        // }
     }
 
+    workers.clear();
     streamer.stop();
-    cap.release();
-    cv::destroyAllWindows(); // <-- 尽管不再显示窗口，但保留此行通常无害
 
     // 在程序正常退出前打印最终报告
     PerformanceMonitor::getInstance().printReport();